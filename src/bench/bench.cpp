@@ -0,0 +1,25 @@
+#include "bench.hpp"
+
+namespace Bench
+{
+void Section(const std::string &title) { fmt::println("\n{}{}{}", fmtx::CYAN, title, fmtx::RESET); }
+
+void Report(const std::string &name, double milliseconds, const std::string &note)
+{
+    fmt::println("  {:<44} {:>12.3f} ms  {}", name, milliseconds, note);
+}
+
+void Speedup(const std::string &name, double before, double after)
+{
+    fmt::println("  {:<44} {:>12.2f} x", name, after > 0 ? before / after : 0.0);
+}
+
+bool Expect(bool condition, const std::string &what)
+{
+    if (condition)
+        fmtx::Success(what);
+    else
+        fmtx::Error(what);
+    return condition;
+}
+}; // namespace Bench
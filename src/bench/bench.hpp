@@ -0,0 +1,45 @@
+#pragma once
+
+#include "../core/all.hpp"
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <string>
+
+// Minimal benchmark harness, suites are listed in main.cpp.
+// Times are best of several runs so a busy machine skews them as little as possible, every benchmark prints
+// something derived from its results so the measured work cannot be optimized away.
+namespace Bench
+{
+using Clock = std::chrono::steady_clock;
+
+struct Suite
+{
+    const char *Name;
+    // prints timings
+    void (*Run)();
+    // correctness checks run by ctest, nullptr when the suite has none
+    bool (*Check)();
+};
+
+// milliseconds of the fastest run, one extra untimed run warms caches up first
+template <typename Fn> double Measure(uint32 runs, Fn &&fn)
+{
+    fn();
+    double best = std::numeric_limits<double>::max();
+    for (uint32 i = 0; i < runs; ++i)
+    {
+        auto start = Clock::now();
+        fn();
+        best = std::min(best, std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+    }
+    return best;
+}
+
+void Section(const std::string &title);
+void Report(const std::string &name, double milliseconds, const std::string &note = "");
+// old / new ratio of two measurements
+void Speedup(const std::string &name, double before, double after);
+// logs failed condition, returns it so checks can be chained with &=
+bool Expect(bool condition, const std::string &what);
+}; // namespace Bench
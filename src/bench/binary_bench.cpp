@@ -0,0 +1,169 @@
+#include "../io/binary.hpp"
+#include "bench.hpp"
+#include "suites.hpp"
+#include <cstdio>
+#include <filesystem>
+
+namespace
+{
+// pseudo random bytes so a chunk delivered at the wrong offset cannot go unnoticed
+std::string writeFile(const std::string &name, size_t size, std::vector<char> &bytes)
+{
+    auto path = (std::filesystem::temp_directory_path() / name).string();
+
+    bytes.resize(size);
+    uint32 state = 0x9E3779B9u;
+    for (auto &byte : bytes)
+    {
+        state = state * 1664525u + 1013904223u;
+        byte  = char(state >> 24);
+    }
+    return io::BinaryFile::Save(path, bytes.data(), bytes.size()) ? path : "";
+}
+
+// one byte of every cache line, chunks of a multiple of 64 bytes sum up to the sum of the whole file
+uint64 checksum(io::ByteView bytes)
+{
+    uint64 sum = 0;
+    for (size_t i = 0; i < bytes.Size(); i += 64) sum += uint8_t(bytes.Data()[i]);
+    return sum;
+}
+
+std::string throughput(double milliseconds, size_t size)
+{
+    return fmt::format("{:.0f} MB/s", milliseconds > 0 ? size / (1024.0 * 1024.0) / (milliseconds / 1000) : 0.0);
+}
+
+bool ready(const std::future<bool> &future)
+{
+    return future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+} // namespace
+
+namespace Bench
+{
+// the file was just written so it is read from the OS cache, what is left is copying and the reader's overhead
+void AsyncReader()
+{
+    const size_t size = size_t(128) << 20;
+    Section(fmt::format("file reads, {} MB", size >> 20));
+
+    std::vector<char> bytes;
+    auto path = writeFile("diye_async_reader.bin", size, bytes);
+    std::vector<char>().swap(bytes);
+    if (path.empty())
+    {
+        fmtx::Error("Failed to write test file");
+        return;
+    }
+
+    uint64 sum    = 0;
+    auto load     = Measure(3, [&]() { sum = checksum(io::BinaryFile::Load(path)->View()); });
+    auto mapped   = Measure(3, [&]() { sum = checksum(io::MappedFile::Open(path)->View()); });
+    auto expected = sum;
+
+    io::AsyncReader reader;
+    bool same    = true;
+    auto chunked = Measure(
+        3,
+        [&]()
+        {
+            uint64 chunkSum = 0;
+            auto onChunk    = [&](io::ByteView chunk, size_t, size_t)
+            {
+                chunkSum += checksum(chunk);
+                return true;
+            };
+            same &= reader.Read(path, onChunk).get() && chunkSum == expected;
+        }
+    );
+    auto loaded = Measure(3, [&]() { same &= checksum(reader.Load(path).get()->View()) == expected; });
+    std::remove(path.c_str());
+
+    Report("BinaryFile::Load", load, fmt::format("{}, {} MB in memory", throughput(load, size), size >> 20));
+    Report("MappedFile::Open", mapped, fmt::format("{}, pages shared with the OS cache", throughput(mapped, size)));
+    Report(
+        "AsyncReader::Read",
+        chunked,
+        fmt::format("{}, {} MB in memory", throughput(chunked, size), io::AsyncReader::DefaultChunkSize >> 20)
+    );
+    Report("AsyncReader::Load", loaded, fmt::format("{}, whole file on the I/O thread", throughput(loaded, size)));
+    if (!same) fmtx::Error("AsyncReader read different bytes");
+    Speedup("chunked vs BinaryFile::Load", load, chunked);
+}
+
+bool CheckAsyncReader()
+{
+    // neither the file nor the chunks are a multiple of each other
+    const size_t chunkSize = (size_t(1) << 20) + 7;
+    std::vector<char> bytes;
+    auto path = writeFile("diye_async_reader_check.bin", size_t(10) << 20 | 123, bytes);
+    if (!Expect(!path.empty(), "test file written")) return false;
+
+    io::AsyncReader reader;
+    bool ok = true;
+
+    std::vector<char> received;
+    bool inOrder = true, done = false;
+    size_t doneBytes = 0;
+    auto read        = reader.Read(
+        path,
+        [&](io::ByteView chunk, size_t offset, size_t fileSize)
+        {
+            inOrder &= offset == received.size() && fileSize == bytes.size() && chunk.Size() <= chunkSize;
+            received.insert(received.end(), chunk.begin(), chunk.end());
+            return true;
+        },
+        [&](bool readOk, size_t bytesRead)
+        {
+            done      = readOk;
+            doneBytes = bytesRead;
+        },
+        chunkSize
+    );
+    ok &= Expect(read.get() && done && doneBytes == bytes.size(), "chunked read completes with every byte");
+    ok &= Expect(inOrder, "chunks arrive in order at their offsets");
+    ok &= Expect(received == bytes, "chunks hold the file contents");
+
+    uint32 chunks = 0;
+    done          = true;
+    auto stopped  = reader.Read(
+        path,
+        [&](io::ByteView, size_t, size_t) { return ++chunks < 2; },
+        [&](bool readOk, size_t bytesRead)
+        {
+            done      = readOk;
+            doneBytes = bytesRead;
+        },
+        chunkSize
+    );
+    ok &= Expect(!stopped.get() && !done, "read stopped by its consumer fails");
+    ok &= Expect(chunks == 2 && doneBytes == 2 * chunkSize, "no chunk is read after the stop");
+
+    done         = true;
+    auto missing = reader.Read(
+        path + ".missing",
+        [&](io::ByteView, size_t, size_t) { return true; },
+        [&](bool readOk, size_t) { done = readOk; }
+    );
+    ok &= Expect(!missing.get() && !done, "missing file fails");
+
+    // completes in submission order, Wait returns once the queue is empty
+    std::vector<int> order;
+    std::vector<std::future<bool>> reads;
+    for (int i = 0; i < 3; ++i)
+    {
+        reads.push_back(reader.Read(
+            path, [](io::ByteView, size_t, size_t) { return true; }, [&, i](bool, size_t) { order.push_back(i); }
+        ));
+    }
+    auto loaded = reader.Load(path);
+    reader.Wait();
+    ok &= Expect(std::all_of(reads.begin(), reads.end(), ready), "Wait returns after every queued read");
+    ok &= Expect(order == std::vector<int>{0, 1, 2}, "reads complete in submission order");
+    ok &= Expect(loaded.get()->Bytes() == bytes, "Load reads the whole file");
+
+    std::remove(path.c_str());
+    return ok;
+}
+}; // namespace Bench
@@ -0,0 +1,135 @@
+#include "../geometry/bvh.hpp"
+#include "../geometry/half_edge_mesh.hpp"
+#include "bench.hpp"
+#include "suites.hpp"
+#include <random>
+
+namespace
+{
+// size x size quads on a bumpy plane, two triangles per quad
+HalfEdgeMesh::Ptr terrain(uint32 size)
+{
+    std::vector<Vec3> positions;
+    std::vector<uint32> indices;
+    std::vector<uint32> faceSizes;
+    for (uint32 y = 0; y <= size; ++y)
+        for (uint32 x = 0; x <= size; ++x) positions.emplace_back(x, std::sin(x * 0.05f) * std::cos(y * 0.05f) * 8, y);
+
+    for (uint32 y = 0; y < size; ++y)
+    {
+        for (uint32 x = 0; x < size; ++x)
+        {
+            const uint32 v = y * (size + 1) + x;
+            indices.insert(indices.end(), {v, v + size + 1, v + size + 2, v + 1});
+            faceSizes.emplace_back(4);
+        }
+    }
+    return HalfEdgeMesh::FromIndexed(positions, indices, faceSizes);
+}
+
+// rays from above aimed at random points of the terrain
+std::vector<Ray> rays(uint32 size, uint32 count)
+{
+    std::mt19937 random(7);
+    std::uniform_real_distribution<float> coordinate(0, float(size));
+    std::vector<Ray> rays(count);
+    for (auto &ray : rays)
+    {
+        auto target   = Vec3(coordinate(random), 0, coordinate(random));
+        ray.Origin    = target + Vec3(3, 40, -2);
+        ray.Direction = Mathf::Normalize(target - ray.Origin);
+    }
+    return rays;
+}
+} // namespace
+
+namespace Bench
+{
+void BVH()
+{
+    const uint32 size = 708;
+    auto mesh         = terrain(size);
+    const auto probes = rays(size, 10000);
+
+    Section(fmt::format("picking, {} triangles", size_t(size) * size * 2));
+
+    std::vector<uint32> triangles;
+    for (uint32 f = 0; f < mesh->FaceCount(); ++f)
+    {
+        mesh->EachTriangle(
+            HalfEdge::Face(f),
+            [&](HalfEdge::Vertex a, HalfEdge::Vertex b, HalfEdge::Vertex c)
+            { triangles.insert(triangles.end(), {a.Value, b.Value, c.Value}); }
+        );
+    }
+    std::vector<Vec3> positions(mesh->VertexCount());
+    for (uint32 v = 0; v < mesh->VertexCount(); ++v) positions[v] = mesh->Position(HalfEdge::Vertex(v));
+
+    ::BVH tree;
+    auto build = Measure(3, [&]() { tree.Build(positions, triangles); });
+    Report("BVH::Build", build, fmt::format("depth {}", tree.Depth()));
+
+    uint32 hits = 0;
+    auto query  = Measure(
+        3,
+        [&]()
+        {
+            hits = 0;
+            for (const auto &ray : probes) hits += mesh->Raycast(ray).Hit();
+        }
+    );
+    Report(
+        fmt::format("HalfEdgeMesh::Raycast x {}", probes.size()),
+        query,
+        fmt::format("{:.2f} us per ray, {} hits", query * 1000 / probes.size(), hits)
+    );
+
+    auto refit = Measure(
+        3,
+        [&]()
+        {
+            mesh->SetPosition(HalfEdge::Vertex(0), Vec3(0, 1, 0));
+            mesh->Raycast(probes[0]);
+        }
+    );
+    Report("refit after SetPosition", refit);
+}
+
+bool CheckBVH()
+{
+    // centroids spread exponentially along every axis give lopsided SAH splits, the tree must stay within
+    // MaxDepth so the fixed traversal stack never drops a subtree
+    std::vector<Vec3> positions;
+    std::vector<uint32> indices;
+    std::vector<Ray> probes;
+    for (uint32 axis = 0; axis < 3; ++axis)
+    {
+        for (float x = 1; x < 1e36f; x *= 2)
+        {
+            Vec3 corner(0), u(0), v(0), direction(0);
+            corner[axis]       = x;
+            u[(axis + 1) % 3]  = 0.5f;
+            v[(axis + 2) % 3]  = 0.5f;
+            direction[axis]    = -1;
+            const uint32 first = uint32(positions.size());
+            positions.insert(positions.end(), {corner, corner + u, corner + v});
+            indices.insert(indices.end(), {first, first + 1, first + 2});
+
+            Ray ray;
+            ray.Origin    = corner + (u + v) * 0.25f - direction * (x * 0.01f + 0.01f);
+            ray.Direction = direction;
+            probes.emplace_back(ray);
+        }
+    }
+
+    ::BVH tree;
+    tree.Build(positions, indices);
+
+    uint32 found = 0;
+    for (uint32 t = 0; t < probes.size(); ++t) found += tree.Raycast(probes[t]).Triangle == t;
+
+    bool ok = Expect(tree.Depth() <= ::BVH::MaxDepth, fmt::format("BVH depth {} is within limit", tree.Depth()));
+    ok &= Expect(found == probes.size(), fmt::format("BVH finds {} of {} triangles", found, probes.size()));
+    return ok;
+}
+}; // namespace Bench
@@ -0,0 +1,165 @@
+#include "../gl/app.hpp"
+#include "../gl/debug_renderer.hpp"
+#include "bench.hpp"
+#include "suites.hpp"
+#include <random>
+
+namespace
+{
+constexpr Dimension Size{640, 400};
+
+// headless app with a ready debug renderer, nothing to measure on machines without a Vulkan device
+struct Renderer
+{
+    gl::App App;
+    gl::DebugRenderer Debug;
+    Camera View;
+    // headless Vulkan came up, shut down on destruction
+    bool Available = false;
+
+    bool Init()
+    {
+        if (!App.InitHeadless(Size))
+        {
+            fmtx::Warn("No Vulkan device, debug_draw skipped");
+            return false;
+        }
+        Available = true;
+        if (!Debug.Init(App.device, App.physicalDevice, App.renderPass, App.pipelineCompiler) ||
+            !App.pipelineCompiler.Wait())
+        {
+            fmtx::Error("Failed to init debug renderer");
+            return false;
+        }
+
+        View.SetPosition(Vec3(0, 30, 60));
+        View.LookAt(ZERO);
+        View.UpdatePerspective(Size);
+        return true;
+    }
+
+    ~Renderer()
+    {
+        Debug.Shutdown();
+        if (Available) App.Shutdown();
+    }
+};
+
+// milliseconds spent recording shapes and in DebugRenderer::End, which emits their vertices and copies them
+struct FrameTime
+{
+    double Record = 0;
+    double Update = 0;
+};
+
+// mix the app uses, instanced boxes and spheres plus lines and cones expanded into vertices on the CPU
+void shapes(const gl::DebugRenderer &debug, uint32 count)
+{
+    std::mt19937 random(9);
+    std::uniform_real_distribution<float> unit(-20, 20);
+    auto point = [&]() { return Vec3(unit(random), unit(random), unit(random)); };
+
+    for (uint32 i = 0; i < count; ++i)
+    {
+        auto p = point();
+        switch (i % 4)
+        {
+        case 0: debug.Box(p, Vec3(0.2f)); break;
+        case 1: debug.Sphere(p, 0.1f); break;
+        case 2: debug.Line(p, p + Vec3(0, 0.5f, 0)); break;
+        default: debug.Cone(p, UP, MAGENTA, 0.1f, 0.3f); break;
+        }
+    }
+}
+
+// one full headless frame, false when any Vulkan call fails
+bool frame(Renderer &renderer, uint32 shapeCount, FrameTime &time)
+{
+    auto &app = renderer.App;
+    if (app.BeginFrame() == gl::App::State::Error) return false;
+
+    auto index = app.Frame();
+    app.commandBuffers.Reset(index);
+    if (app.commandBuffers.Begin(index) != VK_SUCCESS) return false;
+    app.commandBuffers.ClearColor({0.0f, 0.0f, 0.0f, 1.0f});
+    app.commandBuffers.ClearDepthStencil();
+
+    auto start = Bench::Clock::now();
+    renderer.Debug.Begin();
+    shapes(renderer.Debug, shapeCount);
+    auto recorded = Bench::Clock::now();
+    renderer.Debug.End(app.commandBuffers.handles[index]);
+    auto updated = Bench::Clock::now();
+
+    time.Record = std::chrono::duration<double, std::milli>(recorded - start).count();
+    time.Update = std::chrono::duration<double, std::milli>(updated - recorded).count();
+
+    app.commandBuffers.CmdBeginRenderPass(
+        index, app.renderPass, app.swapChainFramebuffers[app.ImageIndex()], app.swapChain.extent
+    );
+    app.commandBuffers.CmdViewport(index, {0, 0}, app.swapChain.extent);
+    app.commandBuffers.CmdScissor(index, {0, 0}, app.swapChain.extent);
+    renderer.Debug.CmdDraw(renderer.View, app.commandBuffers.handles[index]);
+    app.commandBuffers.CmdEndRenderPass(index);
+    if (app.commandBuffers.End(index) != VK_SUCCESS) return false;
+
+    return app.EndFrame() != gl::App::State::Error;
+}
+} // namespace
+
+namespace Bench
+{
+void DebugDraw()
+{
+    Renderer renderer;
+    if (!renderer.Init()) return;
+
+    for (uint32 count : {10000u, 100000u})
+    {
+        Section(fmt::format("debug draw, {} backend, {} shapes per frame", gl::DebugRenderer::Backend(), count));
+
+        // first frames grow the GPU buffers, best of the rest is reported
+        FrameTime best{std::numeric_limits<double>::max(), std::numeric_limits<double>::max()};
+        for (uint32 i = 0; i < 20; ++i)
+        {
+            FrameTime time;
+            if (!frame(renderer, count, time))
+            {
+                fmtx::Error("Headless frame failed");
+                return;
+            }
+            if (i < 4) continue;
+            best.Record = std::min(best.Record, time.Record);
+            best.Update = std::min(best.Update, time.Update);
+        }
+
+        auto perShape = [&](double ms) { return fmt::format("{:.1f} ns per shape", ms * 1e6 / count); };
+        Report("record shapes", best.Record, perShape(best.Record));
+        Report("End, emit and copy", best.Update, perShape(best.Update));
+        fmtx::Info(fmt::format(
+            "High water mark {} shapes, capacity {}", renderer.Debug.HighWaterMark(), renderer.Debug.Capacity()
+        ));
+    }
+}
+
+bool CheckDebugDraw()
+{
+    Renderer renderer;
+    // a machine without a GPU cannot run it, which is not a failure of the renderer
+    if (!renderer.Init()) return !renderer.Available;
+
+    bool ok = true;
+    FrameTime time;
+    for (uint32 i = 0; i < 3 && ok; ++i) ok &= Expect(frame(renderer, 5000, time), "headless frame renders");
+    ok &= Expect(renderer.Debug.HighWaterMark() == 5000, "every recorded shape is counted");
+    ok &= Expect(renderer.Debug.Capacity() >= 5000, "GPU buffers hold every recorded shape");
+
+    // one whole window without shapes releases store blocks, recording afterwards has to reuse the kept ones
+    bool empty = ok;
+    for (uint32 i = 0; i < 2 * gl::DebugRenderer::ShrinkFrameCount && empty; ++i) empty = frame(renderer, 0, time);
+    ok &= Expect(empty && renderer.Debug.HighWaterMark() == 0, "empty window renders and resets the high water mark");
+    for (uint32 i = 0; i < 3 && ok; ++i) ok &= Expect(frame(renderer, 5000, time), "headless frame renders after it");
+    ok &= Expect(renderer.Debug.HighWaterMark() == 5000, "shapes recorded after an empty window are counted");
+    return ok;
+}
+}; // namespace Bench
@@ -0,0 +1,388 @@
+#include "../gl/app.hpp"
+#include "bench.hpp"
+#include "suites.hpp"
+#include <atomic>
+#include <cstdio>
+#include <filesystem>
+
+namespace
+{
+constexpr Dimension Size{640, 400};
+// kept apart from the app's pipeline_cache.bin so a run of the app is not slowed down by the bench
+constexpr const char *CacheFile = "bench_pipeline_cache.bin";
+constexpr uint32 VariantCount   = 16;
+// dozens of material permutations compiled at startup
+constexpr uint32 PermutationCount = 48;
+
+// headless app whose graphics pipeline is compiled, nothing to measure on machines without a Vulkan device
+struct Headless
+{
+    gl::App App;
+    // headless Vulkan came up, shut down on destruction
+    bool Available = false;
+
+    bool Init(const char *suite)
+    {
+        if (!App.InitHeadless(Size))
+        {
+            fmtx::Warn(fmt::format("No Vulkan device, {} skipped", suite));
+            return false;
+        }
+        Available = true;
+        if (!App.pipelineCompiler.Wait())
+        {
+            fmtx::Error("Failed to compile app pipelines");
+            return false;
+        }
+        return true;
+    }
+
+    ~Headless()
+    {
+        std::remove(CacheFile);
+        if (Available) App.Shutdown();
+    }
+};
+
+// Copies of the app pipeline that differ in rasterization state only, they share its shaders, layout and render
+// pass. Stands in for material permutations, created with vkCreateGraphicsPipelines so nothing is logged per pipeline.
+class Variants
+{
+public:
+    Variants(const gl::Pipeline &base, uint32 count) :
+        rasterization(count, base.rasterizationStateCreateInfo),
+        createInfos(count, base.createInfo),
+        handles(count, VK_NULL_HANDLE)
+    {
+        for (uint32 i = 0; i < count; ++i)
+        {
+            auto &state                   = rasterization[i];
+            state.cullMode                = VkCullModeFlags(i % 4);
+            state.frontFace               = i / 4 % 2 ? VK_FRONT_FACE_CLOCKWISE : VK_FRONT_FACE_COUNTER_CLOCKWISE;
+            state.depthBiasEnable         = VK_TRUE;
+            state.depthBiasConstantFactor = float(i);
+
+            createInfos[i].pRasterizationState = &state;
+        }
+    }
+
+    uint32 Count() const { return uint32(handles.size()); }
+
+    bool Create(const gl::Device &device, const gl::PipelineCache &cache, uint32 i)
+    {
+        auto result = vkCreateGraphicsPipelines(device.handle, cache.handle, 1, &createInfos[i], nullptr, &handles[i]);
+        return result == VK_SUCCESS;
+    }
+
+    void Destroy(const gl::Device &device)
+    {
+        for (auto &handle : handles)
+        {
+            if (handle != VK_NULL_HANDLE) vkDestroyPipeline(device.handle, handle, nullptr);
+            handle = VK_NULL_HANDLE;
+        }
+    }
+
+private:
+    std::vector<VkPipelineRasterizationStateCreateInfo> rasterization;
+    std::vector<VkGraphicsPipelineCreateInfo> createInfos;
+    std::vector<VkPipeline> handles;
+};
+
+// what startup does, open the cache file and compile every variant against it, false when any step fails
+bool compileAll(gl::App &app, Variants &variants, bool &warm)
+{
+    gl::PipelineCache cache;
+    if (!cache.Create(app.device, app.physicalDevice, CacheFile)) return false;
+    warm    = cache.IsWarm();
+    bool ok = true;
+    for (uint32 i = 0; i < variants.Count(); ++i) ok &= variants.Create(app.device, cache, i);
+    variants.Destroy(app.device);
+    ok &= cache.Save(app.device);
+    cache.Destroy(app.device);
+    return ok;
+}
+
+// every variant compiled by a compiler with that many threads against one fresh cold cache
+bool compileParallel(gl::App &app, Variants &variants, uint32 threads)
+{
+    std::remove(CacheFile);
+    gl::PipelineCache cache;
+    if (!cache.Create(app.device, app.physicalDevice, CacheFile)) return false;
+
+    gl::PipelineCompiler compiler;
+    bool ok = compiler.Create(app.device, cache, threads);
+    for (uint32 i = 0; i < variants.Count() && ok; ++i)
+        compiler.Submit([&, i]() { return variants.Create(app.device, cache, i); });
+    ok = compiler.Wait() && ok;
+    compiler.Destroy();
+    variants.Destroy(app.device);
+    cache.Destroy(app.device);
+    return ok;
+}
+
+// draws of single scene triangles split into chunks recorded by the app's recorder, empty when recording failed
+std::vector<VkCommandBuffer> record(gl::App &app, uint32 draws, uint32 chunks, std::atomic<uint32> *recorded = nullptr)
+{
+    const auto &pipeline = app.graphicsPipeline;
+    auto descriptorSet   = app.descriptorPool.descriptorSets[app.Frame()].handle;
+    auto triangles       = app.indexCount / 3;
+    auto perChunk        = (draws + chunks - 1) / chunks;
+    return app.recorder.Record(
+        chunks,
+        app.renderPass,
+        app.swapChainFramebuffers[app.ImageIndex()],
+        [&](uint32_t chunk, gl::CommandBuffer &commands, uint32_t i)
+        {
+            commands.CmdViewport(i, {0, 0}, app.swapChain.extent);
+            commands.CmdScissor(i, {0, 0}, app.swapChain.extent);
+            commands.CmdBindGraphicsPipeline(i, pipeline);
+            commands.CmdBindDescriptorSet(i, pipeline, descriptorSet);
+            commands.CmdBindVertexBuffer(i, app.vertexBuffer);
+            commands.CmdBindIndexBuffer(i, app.indexBuffer);
+
+            auto begin = std::min(draws, chunk * perChunk);
+            auto end   = std::min(draws, begin + perChunk);
+            for (auto draw = begin; draw < end; ++draw) commands.CmdDrawIndexed(i, 3, draw % triangles * 3);
+            if (recorded) *recorded += end - begin;
+        }
+    );
+}
+
+// one headless frame whose scene pass executes the recorded chunks, false when any Vulkan call fails
+bool frame(gl::App &app, uint32 draws, uint32 chunks, std::atomic<uint32> &recorded)
+{
+    // also resets the recorder's pools of this frame
+    if (app.BeginFrame() == gl::App::State::Error) return false;
+
+    auto secondaries = record(app, draws, chunks, &recorded);
+    if (secondaries.size() != chunks) return false;
+
+    auto index             = app.Frame();
+    const auto &framebuffer = app.swapChainFramebuffers[app.ImageIndex()];
+    app.commandBuffers.Reset(index);
+    if (app.commandBuffers.Begin(index) != VK_SUCCESS) return false;
+    app.commandBuffers.ClearColor({0.0f, 0.0f, 0.0f, 1.0f});
+    app.commandBuffers.ClearDepthStencil();
+    app.commandBuffers.CmdBeginRenderPass(
+        index, app.renderPass, framebuffer, app.swapChain.extent, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS
+    );
+    app.commandBuffers.CmdExecuteCommands(index, secondaries);
+    app.commandBuffers.CmdEndRenderPass(index);
+    if (app.commandBuffers.End(index) != VK_SUCCESS) return false;
+
+    return app.EndFrame() != gl::App::State::Error;
+}
+} // namespace
+
+namespace Bench
+{
+// Mesa drivers keep their own shader cache on disk as well, MESA_SHADER_CACHE_DISABLE=true makes cold runs cold
+void PipelineCache()
+{
+    Headless headless;
+    if (!headless.Init("pipeline_cache")) return;
+
+    auto &app = headless.App;
+    Variants variants(app.graphicsPipeline, VariantCount);
+    Section(fmt::format("pipeline cache, {} pipeline variants", variants.Count()));
+
+    bool ok = true, warm = false;
+    auto cold = Measure(
+        5,
+        [&]()
+        {
+            std::remove(CacheFile);
+            ok &= compileAll(app, variants, warm) && !warm;
+        }
+    );
+    auto loaded = Measure(5, [&]() { ok &= compileAll(app, variants, warm) && warm; });
+    if (!ok)
+    {
+        fmtx::Error("Pipeline cache runs failed");
+        return;
+    }
+
+    auto perPipeline = [&](double ms) { return fmt::format("{:.2f} ms per pipeline", ms / variants.Count()); };
+    Report("cold start", cold, perPipeline(cold));
+    Report("warm start", loaded, perPipeline(loaded));
+    Speedup("warm vs cold", cold, loaded);
+    fmtx::Info(fmt::format("Cache file {} KB", std::filesystem::file_size(CacheFile) / 1024));
+}
+
+bool CheckPipelineCache()
+{
+    Headless headless;
+    // a machine without a GPU cannot run it, which is not a failure of the cache
+    if (!headless.Init("pipeline_cache")) return !headless.Available;
+
+    auto &app = headless.App;
+    Variants variants(app.graphicsPipeline, 4);
+
+    bool ok = true, warm = true;
+    std::remove(CacheFile);
+    ok &= Expect(compileAll(app, variants, warm) && !warm, "missing file starts cold and is saved");
+    ok &= Expect(compileAll(app, variants, warm) && warm, "saved file starts warm");
+
+    // another device or driver wrote it, the cache has to start cold and still compile
+    auto saved = io::BinaryFile::Load(CacheFile)->Bytes();
+    ok &= Expect(saved.size() > 16, "saved file holds a header");
+    if (saved.size() > 16)
+    {
+        auto bytes = saved;
+        for (size_t i = 8; i < 16; ++i) bytes[i] = char(~bytes[i]);
+        ok &= Expect(io::BinaryFile::Save(CacheFile, bytes.data(), bytes.size()), "mismatching header is written");
+        ok &= Expect(compileAll(app, variants, warm) && !warm, "mismatching header starts cold");
+
+        // driver data cut short of the size in the header
+        ok &= Expect(io::BinaryFile::Save(CacheFile, saved.data(), saved.size() - 1), "truncated file is written");
+        ok &= Expect(compileAll(app, variants, warm) && !warm, "truncated file starts cold");
+    }
+    ok &= Expect(compileAll(app, variants, warm) && warm, "file saved after a cold start is warm again");
+    return ok;
+}
+
+// same Mesa shader cache caveat as pipeline_cache
+void PipelineCompiler()
+{
+    Headless headless;
+    if (!headless.Init("pipeline_compiler")) return;
+
+    auto &app = headless.App;
+    Variants variants(app.graphicsPipeline, PermutationCount);
+    Section(fmt::format("pipeline compiler, {} pipeline variants on a cold cache", variants.Count()));
+
+    std::vector<uint32> threadCounts;
+    for (uint32 threads = 1; threads < Parallel::ThreadCount(); threads *= 2) threadCounts.push_back(threads);
+    threadCounts.push_back(Parallel::ThreadCount());
+
+    double serial = 0;
+    for (auto threads : threadCounts)
+    {
+        bool ok   = true;
+        auto time = Measure(3, [&]() { ok &= compileParallel(app, variants, threads); });
+        if (!ok)
+        {
+            fmtx::Error("Pipeline compilation failed");
+            return;
+        }
+
+        if (threads == 1) serial = time;
+        auto perPipeline = fmt::format("{:.2f} ms per pipeline", time / variants.Count());
+        Report(fmt::format("{} threads", threads), time, perPipeline);
+        if (threads > 1) Speedup(fmt::format("{} threads vs 1", threads), serial, time);
+    }
+}
+
+bool CheckPipelineCompiler()
+{
+    // Create only keeps the device and cache, jobs that do not touch them run without a GPU
+    gl::Device device;
+    gl::PipelineCache cache;
+    gl::PipelineCompiler compiler;
+
+    bool ok = true;
+    ok &= Expect(compiler.Create(device, cache, 4), "compiler is created");
+    ok &= Expect(compiler.Wait(), "Wait without jobs succeeds");
+
+    std::atomic<uint32> done{0};
+    for (uint32 i = 0; i < 64; ++i)
+    {
+        compiler.Submit(
+            [&]()
+            {
+                ++done;
+                return true;
+            }
+        );
+    }
+    ok &= Expect(compiler.Wait() && done == 64, "Wait returns once every job ran");
+    ok &= Expect(compiler.Pending() == 0, "nothing is pending after Wait");
+
+    for (uint32 i = 0; i < 16; ++i) compiler.Submit([i]() { return i != 7; });
+    ok &= Expect(!compiler.Wait(), "one failed job fails Wait");
+    ok &= Expect(compiler.Wait(), "a failure is reported by one Wait only");
+
+    // Submit drops finished jobs, the failure of a dropped one still has to reach Wait
+    compiler.Submit([]() { return false; }).wait();
+    compiler.Submit([]() { return true; }).wait();
+    ok &= Expect(!compiler.Wait(), "failure of a pruned job fails Wait");
+    ok &= Expect(compiler.Wait(), "Wait succeeds again afterwards");
+    return ok;
+}
+
+// CPU time of recording only, nothing is submitted
+void Recorder()
+{
+    Headless headless;
+    if (!headless.Init("recorder")) return;
+
+    auto &app  = headless.App;
+    auto lanes = app.recorder.Lanes();
+    for (uint32 draws : {1000u, 10000u, 100000u})
+    {
+        Section(fmt::format("command recorder, {} draw calls", draws));
+
+        bool ok      = true;
+        auto measure = [&](uint32 chunks)
+        {
+            return Measure(
+                5,
+                [&]()
+                {
+                    ok &= app.recorder.BeginFrame(app.Frame());
+                    ok &= record(app, draws, chunks).size() == chunks;
+                }
+            );
+        };
+        auto serial   = measure(1);
+        auto parallel = measure(lanes);
+        if (!ok)
+        {
+            fmtx::Error("Recording failed");
+            return;
+        }
+
+        auto perDraw = [&](double ms) { return fmt::format("{:.1f} ns per draw", ms * 1e6 / draws); };
+        Report("1 chunk", serial, perDraw(serial));
+        Report(fmt::format("{} chunks", lanes), parallel, perDraw(parallel));
+        Speedup(fmt::format("{} lanes vs 1", lanes), serial, parallel);
+    }
+}
+
+bool CheckRecorder()
+{
+    Headless headless;
+    // a machine without a GPU cannot run it, which is not a failure of the recorder
+    if (!headless.Init("recorder")) return !headless.Available;
+
+    auto &app = headless.App;
+    bool ok   = true;
+    // more chunks than lanes so lanes record several, every frame slot is reused at least once
+    auto chunks = app.recorder.Lanes() + 3;
+    for (int i = 0; i < 2 * app.MaxFramesInFlight() && ok; ++i)
+    {
+        std::atomic<uint32> recorded{0};
+        ok &= Expect(frame(app, 5000, chunks, recorded), "headless frame executes the recorded chunks");
+        ok &= Expect(recorded == 5000, "every draw is recorded once");
+    }
+
+    // chunk order is kept whichever lane recorded a chunk, the pools are only reset once the GPU is done with them
+    std::vector<VkCommandBuffer> handles(chunks, VK_NULL_HANDLE);
+    ok &= Expect(app.device.WaitIdle() == VK_SUCCESS, "device goes idle");
+    ok &= Expect(app.recorder.BeginFrame(app.Frame()), "recorder frame begins");
+    auto secondaries = app.recorder.Record(
+        chunks,
+        app.renderPass,
+        app.swapChainFramebuffers[app.ImageIndex()],
+        [&](uint32_t chunk, gl::CommandBuffer &commands, uint32_t i) { handles[chunk] = commands.handles[i]; }
+    );
+    ok &= Expect(secondaries == handles, "buffers are returned in chunk order");
+    std::sort(handles.begin(), handles.end());
+    ok &= Expect(
+        std::unique(handles.begin(), handles.end()) == handles.end() && handles.front() != VK_NULL_HANDLE,
+        "every chunk has its own buffer"
+    );
+    return ok;
+}
+}; // namespace Bench
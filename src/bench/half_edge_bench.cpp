@@ -0,0 +1,477 @@
+#include "../geometry/half_edge_mesh.hpp"
+#include "bench.hpp"
+#include "legacy_half_edge.hpp"
+#include "suites.hpp"
+#include <fmt/ranges.h>
+#include <optional>
+#include <random>
+
+namespace
+{
+struct Indexed
+{
+    std::vector<Vec3> Positions;
+    std::vector<uint32> Indices;
+    std::vector<uint32> FaceSizes;
+};
+
+// size x size quads on a slightly bumpy plane so face normals differ
+Indexed grid(uint32 size)
+{
+    Indexed grid;
+    for (uint32 y = 0; y <= size; ++y)
+        for (uint32 x = 0; x <= size; ++x) grid.Positions.emplace_back(x, std::sin(x * 0.1f) * std::cos(y * 0.1f), y);
+
+    for (uint32 y = 0; y < size; ++y)
+    {
+        for (uint32 x = 0; x < size; ++x)
+        {
+            const uint32 v = y * (size + 1) + x;
+            grid.Indices.insert(grid.Indices.end(), {v, v + size + 1, v + size + 2, v + 1});
+            grid.FaceSizes.emplace_back(4);
+        }
+    }
+    return grid;
+}
+
+void traversal(const Indexed &input)
+{
+    auto legacy = Legacy::Mesh::FromIndexed(input.Positions, input.Indices, input.FaceSizes);
+    legacy.GenerateMissingTwins();
+    auto mesh = HalfEdgeMesh::FromIndexed(input.Positions, input.Indices, input.FaceSizes);
+
+    Bench::Section(fmt::format("half-edge traversal, {} faces", input.FaceSizes.size()));
+
+    Vec3 sum(0);
+    auto legacyCenters = Bench::Measure(
+        5,
+        [&]()
+        {
+            for (const auto &f : legacy.Faces) sum += f->Center();
+        }
+    );
+    auto centers = Bench::Measure(
+        5,
+        [&]()
+        {
+            for (uint32 f = 0; f < mesh->FaceCount(); ++f) sum += mesh->Center(HalfEdge::Face(f));
+        }
+    );
+    Bench::Report("shared_ptr Face::Center", legacyCenters);
+    Bench::Report("SoA HalfEdgeMesh::Center", centers);
+    Bench::Speedup("Center", legacyCenters, centers);
+
+    auto legacyNormals = Bench::Measure(
+        5,
+        [&]()
+        {
+            for (const auto &f : legacy.Faces) sum += f->Normal();
+        }
+    );
+    auto normals = Bench::Measure(
+        5,
+        [&]()
+        {
+            for (uint32 f = 0; f < mesh->FaceCount(); ++f) sum += mesh->Normal(HalfEdge::Face(f));
+        }
+    );
+    Bench::Report("shared_ptr Face::Normal", legacyNormals);
+    Bench::Report("SoA HalfEdgeMesh::Normal", normals);
+    Bench::Speedup("Normal", legacyNormals, normals);
+
+    uint64 corners      = 0;
+    auto legacyTriangles = Bench::Measure(
+        5,
+        [&]()
+        {
+            for (const auto &f : legacy.Faces)
+                f->EachTriangle(
+                    [&](const auto &a, const auto &b, const auto &c)
+                    {
+                        sum += a->P + b->P + c->P;
+                        corners += 3;
+                    }
+                );
+        }
+    );
+    auto triangles = Bench::Measure(
+        5,
+        [&]()
+        {
+            for (uint32 f = 0; f < mesh->FaceCount(); ++f)
+                mesh->EachTriangle(
+                    HalfEdge::Face(f),
+                    [&](HalfEdge::Vertex a, HalfEdge::Vertex b, HalfEdge::Vertex c)
+                    {
+                        sum += mesh->Position(a) + mesh->Position(b) + mesh->Position(c);
+                        corners += 3;
+                    }
+                );
+        }
+    );
+    Bench::Report("shared_ptr Face::EachTriangle", legacyTriangles);
+    Bench::Report("SoA HalfEdgeMesh::EachTriangle", triangles);
+    Bench::Speedup("EachTriangle", legacyTriangles, triangles);
+
+    fmt::println("  checksum {} {}", sum.x + sum.y + sum.z, corners);
+}
+
+void twins(const Indexed &input)
+{
+    Bench::Section(fmt::format("twin linking, {} half-edges", input.Indices.size()));
+
+    auto legacy     = Legacy::Mesh::FromIndexed(input.Positions, input.Indices, input.FaceSizes);
+    auto legacyTime = Bench::Measure(3, [&]() { legacy.GenerateMissingTwins(); });
+
+    uint32 edges = 0;
+    auto time    = Bench::Measure(
+        3,
+        [&]() { edges = HalfEdgeMesh::FromIndexed(input.Positions, input.Indices, input.FaceSizes)->EdgeCount(); }
+    );
+    Bench::Report("std::map twin pass", legacyTime);
+    Bench::Report("HalfEdgeMesh::FromIndexed, whole build", time, fmt::format("{} half-edges", edges));
+    Bench::Speedup("twins", legacyTime, time);
+}
+
+// faces added one by one in random order, the way editing tools build meshes
+HalfEdgeMesh::Ptr shuffled(const Indexed &input, uint32 seed, std::vector<HalfEdge::Face> &faces)
+{
+    auto mesh = HalfEdgeMesh::New();
+    for (const auto &p : input.Positions) mesh->AddVertex(p);
+
+    std::vector<uint32> order(input.FaceSizes.size());
+    for (uint32 f = 0; f < order.size(); ++f) order[f] = f;
+    std::shuffle(order.begin(), order.end(), std::mt19937(seed));
+
+    faces.clear();
+    std::vector<HalfEdge::Vertex> corners;
+    for (auto f : order)
+    {
+        corners.clear();
+        for (uint32 i = 0; i < 4; ++i) corners.emplace_back(input.Indices[f * 4 + i]);
+        faces.emplace_back(mesh->AddFace(corners.data(), 4));
+    }
+    return mesh;
+}
+// serial GenerateMesh, faces in handle order, vertex normals summed from area normals of the faces around them
+Mesh referenceMesh(const HalfEdgeMesh &mesh, bool shareVertices)
+{
+    Mesh reference;
+    if (shareVertices)
+    {
+        for (uint32 v = 0; v < mesh.VertexCount(); ++v)
+            reference.Vertices.push_back(mesh.Position(HalfEdge::Vertex(v)));
+        reference.Normals.assign(mesh.VertexCount(), Vec3(0));
+    }
+
+    for (uint32 f = 0; f < mesh.FaceCount(); ++f)
+    {
+        const HalfEdge::Face face(f);
+        if (!mesh.IsValid(face)) continue;
+
+        const auto base  = uint32(reference.Vertices.size());
+        const auto first = mesh.FaceEdge(face);
+        auto e           = first;
+        do
+        {
+            auto v = mesh.Origin(e);
+            if (shareVertices)
+                reference.Normals[v.Value] += mesh.AreaNormal(face);
+            else
+            {
+                reference.Vertices.push_back(mesh.Position(v));
+                reference.Normals.push_back(mesh.Normal(face));
+            }
+            e = mesh.Next(e);
+        } while (e != first);
+
+        uint32 corner = base;
+        mesh.EachTriangle(
+            face,
+            [&](HalfEdge::Vertex a, HalfEdge::Vertex b, HalfEdge::Vertex c)
+            {
+                if (shareVertices)
+                    reference.Indices.insert(reference.Indices.end(), {a.Value, b.Value, c.Value});
+                else
+                    reference.Indices.insert(reference.Indices.end(), {base, corner + 1, corner + 2});
+                ++corner;
+            }
+        );
+    }
+
+    if (shareVertices)
+        for (auto &n : reference.Normals) n = Mathf::Dot(n, n) > 0 ? Mathf::Normalize(n) : UP;
+    return reference;
+}
+
+// both layouts against referenceMesh and the expected buffer sizes, normals may differ by summation order
+bool checkGenerate(const HalfEdgeMesh &mesh, const std::string &name, size_t sharedVertices, size_t flatVertices)
+{
+    bool ok = true;
+    for (bool share : {true, false})
+    {
+        const auto generated = mesh.GenerateMesh(share);
+        const auto reference = referenceMesh(mesh, share);
+        bool same            = generated.Vertices.size() == (share ? sharedVertices : flatVertices) &&
+                               generated.Vertices == reference.Vertices && generated.Indices == reference.Indices &&
+                               generated.Colors.size() == generated.Vertices.size() &&
+                               generated.Normals.size() == reference.Normals.size();
+        for (size_t i = 0; same && i < generated.Normals.size(); ++i)
+            same = Mathf::Distance(generated.Normals[i], reference.Normals[i]) < 1e-5f;
+        ok &= Bench::Expect(same, fmt::format("{} {} mesh matches serial generation", name, share ? "shared" : "flat"));
+    }
+    return ok;
+}
+
+// position and normal of every corner of non-degenerate triangles, patched meshes keep deleted faces as degenerate
+// triangles that a fresh mesh does not have
+std::vector<std::pair<Vec3, Vec3>> triangleCorners(const Mesh &mesh)
+{
+    std::vector<std::pair<Vec3, Vec3>> corners;
+    for (size_t i = 0; i + 2 < mesh.Indices.size(); i += 3)
+    {
+        const uint32 *t = &mesh.Indices[i];
+        if (t[0] == t[1] && t[1] == t[2]) continue;
+        for (uint32 k = 0; k < 3; ++k) corners.emplace_back(mesh.Vertices[t[k]], mesh.Normals[t[k]]);
+    }
+    return corners;
+}
+
+bool sameTriangles(const Mesh &a, const Mesh &b)
+{
+    const auto cornersA = triangleCorners(a);
+    const auto cornersB = triangleCorners(b);
+    bool same           = cornersA.size() == cornersB.size();
+    for (size_t i = 0; same && i < cornersA.size(); ++i)
+    {
+        same = cornersA[i].first == cornersB[i].first &&
+               Mathf::Distance(cornersA[i].second, cornersB[i].second) < 1e-5f;
+    }
+    return same;
+}
+
+// every byte that changed lies in one of the ranges and the ranges add up to expected bytes
+template <typename T>
+bool coversChanges(
+    const std::vector<T> &before,
+    const std::vector<T> &after,
+    const std::vector<HalfEdgeMesh::MeshUpdate::Range> &ranges,
+    size_t expected
+)
+{
+    const auto bytes = before.size() * sizeof(T);
+    if (after.size() != before.size()) return false;
+
+    std::vector<bool> inRange(bytes, false);
+    size_t total = 0;
+    for (const auto &range : ranges)
+    {
+        if (range.Offset + range.Size > bytes) return false;
+        std::fill_n(inRange.begin() + range.Offset, range.Size, true);
+        total += range.Size;
+    }
+
+    const auto *a = reinterpret_cast<const uint8 *>(before.data());
+    const auto *b = reinterpret_cast<const uint8 *>(after.data());
+    for (size_t i = 0; i < bytes; ++i)
+        if (a[i] != b[i] && !inRange[i]) return false;
+    return total == expected;
+}
+
+// each edit patched into the mesh has to look like a fresh one and report only the bytes of the dirty elements
+bool checkUpdate(bool shareVertices)
+{
+    const uint32 size = 8;
+    const auto input  = grid(size);
+    auto mesh         = HalfEdgeMesh::FromIndexed(input.Positions, input.Indices, input.FaceSizes);
+    const auto layout = shareVertices ? "shared" : "flat";
+
+    Mesh patched;
+    bool ok = Bench::Expect(
+        mesh->UpdateMesh(patched, shareVertices).Rebuilt && sameTriangles(patched, mesh->GenerateMesh(shareVertices)),
+        fmt::format("first {} UpdateMesh generates the whole mesh", layout)
+    );
+
+    // vertices is the number of rewritten vertices, shared ones or face corners, triangles the rewritten triangles
+    auto step = [&](const char *name, const std::function<void()> &edit, size_t vertices, size_t triangles)
+    {
+        const auto before = patched;
+        edit();
+        const auto update      = mesh->UpdateMesh(patched, shareVertices);
+        const auto vertexBytes = vertices * sizeof(Vec3);
+        bool same              = !update.Rebuilt && sameTriangles(patched, mesh->GenerateMesh(shareVertices)) &&
+                    coversChanges(before.Vertices, patched.Vertices, update.Vertices, vertexBytes) &&
+                    coversChanges(before.Normals, patched.Normals, update.Normals, vertexBytes) &&
+                    coversChanges(before.Colors, patched.Colors, update.Colors, shareVertices ? 0 : vertexBytes) &&
+                    coversChanges(before.Indices, patched.Indices, update.Indices, triangles * 3 * sizeof(uint32));
+        ok &= Bench::Expect(same, fmt::format("{} patches {} mesh and reports changed ranges", name, layout));
+    };
+
+    // interior vertex moves 4 faces and with them 9 shared vertices, face 10 and its 4 corners are removed and
+    // added back into the same slot
+    const HalfEdge::Vertex moved(4 * (size + 1) + 4);
+    const HalfEdge::Face removed(10);
+    std::vector<HalfEdge::Vertex> corners;
+    for (uint32 i = 0; i < 4; ++i) corners.emplace_back(input.Indices[removed.Value * 4 + i]);
+
+    step(
+        "SetPosition",
+        [&]() { mesh->SetPosition(moved, mesh->Position(moved) + Vec3(0, 0.5f, 0)); },
+        shareVertices ? 9 : 16,
+        8
+    );
+    step("DeleteFace", [&]() { mesh->DeleteFace(removed); }, 4, 2);
+    step("AddFace", [&]() { mesh->AddFace(corners.data(), 4); }, 4, 2);
+    return ok;
+}
+
+// two batches deleted, one face added back into freed slots, then compacted
+bool checkCompact()
+{
+    const uint32 size = 8;
+    const auto input  = grid(size);
+    auto mesh         = HalfEdgeMesh::FromIndexed(input.Positions, input.Indices, input.FaceSizes);
+    const auto edges  = mesh->EdgeCount();
+    const auto faces  = mesh->FaceCount();
+
+    // rows 4 and 5 take every vertex between them along, faces 9 and 10 take the edge they share
+    std::vector<HalfEdge::Face> rows;
+    for (uint32 f = 4 * size; f < 6 * size; ++f) rows.emplace_back(f);
+    mesh->DeleteFaces(rows);
+    const HalfEdge::Face pair[] = {HalfEdge::Face(9), HalfEdge::Face(10)};
+    mesh->DeleteFaces(pair, 2);
+    bool ok = Bench::Expect(
+        mesh->IsConsistent() && mesh->HasDeleted() && mesh->FaceCount() == faces && !mesh->IsValid(pair[0]) &&
+            !mesh->IsValid(HalfEdge::Vertex(5 * (size + 1) + 4)),
+        "batch deletes tombstone faces, edges and vertices"
+    );
+
+    std::vector<HalfEdge::Vertex> corners;
+    for (uint32 i = 0; i < 4; ++i) corners.emplace_back(input.Indices[9 * 4 + i]);
+    auto added = mesh->AddFace(corners.data(), 4);
+    ok &= Bench::Expect(
+        mesh->IsConsistent() && added.Value < faces && mesh->FaceCount() == faces && mesh->EdgeCount() == edges,
+        "AddFace reuses deleted face and edge slots"
+    );
+
+    // positions and centers before compacting, nullopt for deleted elements
+    std::vector<std::optional<Vec3>> positions(mesh->VertexCount());
+    std::vector<std::optional<Vec3>> centers(mesh->FaceCount());
+    uint32 liveVertices = 0, liveEdges = 0, liveFaces = 0;
+    for (uint32 v = 0; v < mesh->VertexCount(); ++v)
+    {
+        if (!mesh->IsValid(HalfEdge::Vertex(v))) continue;
+        positions[v] = mesh->Position(HalfEdge::Vertex(v));
+        ++liveVertices;
+    }
+    for (uint32 e = 0; e < mesh->EdgeCount(); ++e) liveEdges += mesh->IsValid(HalfEdge::Edge(e));
+    for (uint32 f = 0; f < mesh->FaceCount(); ++f)
+    {
+        if (!mesh->IsValid(HalfEdge::Face(f))) continue;
+        centers[f] = mesh->Center(HalfEdge::Face(f));
+        ++liveFaces;
+    }
+
+    auto remap = mesh->Compact();
+    ok &= Bench::Expect(
+        mesh->IsConsistent() && !mesh->HasDeleted() && mesh->VertexCount() == liveVertices &&
+            mesh->EdgeCount() == liveEdges && mesh->FaceCount() == liveFaces &&
+            liveFaces == size * size - 2 * size - 1,
+        "Compact leaves only live elements"
+    );
+
+    bool moved = true;
+    for (uint32 v = 0; v < positions.size(); ++v)
+    {
+        auto to = remap.Remap(HalfEdge::Vertex(v));
+        moved &= to.IsValid() == positions[v].has_value() && (!to.IsValid() || mesh->Position(to) == *positions[v]);
+    }
+    for (uint32 f = 0; f < centers.size(); ++f)
+    {
+        auto to = remap.Remap(HalfEdge::Face(f));
+        moved &= to.IsValid() == centers[f].has_value() && (!to.IsValid() || mesh->Center(to) == *centers[f]);
+    }
+    return ok & Bench::Expect(moved, "remap carries surviving handles to the same positions");
+}
+} // namespace
+
+namespace Bench
+{
+void HalfEdge()
+{
+    traversal(grid(512));
+    twins(grid(500));
+}
+
+bool CheckHalfEdge()
+{
+    bool ok = true;
+
+    auto cube = HalfEdgeMesh::NewCube();
+    ok &= Expect(cube->IsConsistent() && cube->EdgeCount() == 24, "cube has 24 linked half-edges");
+
+    // every face order has to end with the same closed boundary, no side may be duplicated
+    const auto input = grid(12);
+    bool added = true, deleted = true;
+    std::vector<HalfEdge::Face> faces;
+    for (uint32 seed = 0; seed < 32; ++seed)
+    {
+        auto mesh = shuffled(input, seed, faces);
+        added &= mesh->IsConsistent() && mesh->EdgeCount() == 2 * 2 * 12 * 13;
+
+        std::shuffle(faces.begin(), faces.end(), std::mt19937(seed));
+        for (uint32 i = 0; i < faces.size() && deleted; i += 2)
+        {
+            mesh->DeleteFace(faces[i]);
+            deleted &= mesh->IsConsistent();
+        }
+    }
+    ok &= Expect(added, "faces added in any order get twins and closed boundary loops");
+    ok &= Expect(deleted, "deleting faces keeps boundary loops closed");
+
+    // edge 0 -> 1 used by both faces, and two fans meeting at vertex 0 only
+    const std::vector<Vec3> points = {Vec3(0, 0, 0), Vec3(1, 0, 0), Vec3(0, 1, 0), Vec3(0, 0, 1), Vec3(-1, 0, 0)};
+    for (const auto &indices : {std::vector<uint32>{0, 1, 2, 0, 1, 3}, std::vector<uint32>{0, 1, 2, 0, 3, 4}})
+    {
+        auto mesh   = HalfEdgeMesh::FromIndexed(points, indices, {3, 3});
+        bool linked = mesh && mesh->IsConsistent();
+        if (linked) mesh->DeleteFace(HalfEdge::Face(0));
+        linked = linked && mesh->IsConsistent();
+        if (linked) mesh->DeleteFace(HalfEdge::Face(1));
+        linked = linked && mesh->IsConsistent() && !mesh->IsValid(HalfEdge::Vertex(0));
+        ok &= Expect(linked, fmt::format("non-manifold input {} closes boundary loops", fmt::join(indices, ",")));
+    }
+
+    ok &= checkCompact();
+    ok &= checkUpdate(true);
+    ok &= checkUpdate(false);
+
+    // big enough to be split across threads, then with holes so deleted faces get no range
+    ok &= checkGenerate(*HalfEdgeMesh::NewCube(), "cube", 8, 24);
+    const uint32 size = 96;
+    const auto bumpy  = grid(size);
+    auto gridMesh     = HalfEdgeMesh::FromIndexed(bumpy.Positions, bumpy.Indices, bumpy.FaceSizes);
+    ok &= checkGenerate(*gridMesh, "grid", (size + 1) * (size + 1), size * size * 4);
+    uint32 holes = 0;
+    for (uint32 f = 0; f < gridMesh->FaceCount(); f += 7, ++holes) gridMesh->DeleteFace(HalfEdge::Face(f));
+    ok &= checkGenerate(*gridMesh, "grid with holes", (size + 1) * (size + 1), (size * size - holes) * 4);
+
+    // top of the cube and a lone plane whose corners are deleted with the face
+    auto top      = cube->Extrude(HalfEdge::Face(4), 0.5f);
+    bool extruded = cube->IsConsistent() && cube->VertexCount() == 12 && cube->FaceCount() == 10 &&
+                    cube->EdgeCount() == 40 && Mathf::Distance(cube->Center(top), Vec3(0.5f, 1.5f, 0.5f)) < 1e-5f;
+    auto plane = HalfEdgeMesh::NewPlane();
+    plane->Extrude(HalfEdge::Face(0), 2.0f);
+    plane->Compact();
+    extruded &= plane->IsConsistent() && plane->VertexCount() == 8 && plane->FaceCount() == 5 &&
+                plane->EdgeCount() == 24 &&
+                Mathf::Distance(plane->Center(HalfEdge::Face(0)), Vec3(0.5f, 2, 0.5f)) < 1e-5f;
+    ok &= Expect(extruded, "extruded faces are bridged to their old sides");
+
+    bool rejected = !HalfEdgeMesh::FromIndexed(points, {0, 1, 9}, {3});
+    rejected &= !HalfEdgeMesh::FromIndexed(points, {0, 1}, {2});
+    ok &= Expect(rejected, "indices out of range and faces under 3 vertices return nullptr");
+
+    return ok;
+}
+}; // namespace Bench
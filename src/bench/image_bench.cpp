@@ -0,0 +1,100 @@
+#include "../io/image.hpp"
+#include "bench.hpp"
+#include "suites.hpp"
+#include <random>
+
+namespace
+{
+// the scalar fallback, what RGBToRGBA is checked and timed against
+void referenceRGBToRGBA(const uint8 *src, uint8 *dst, size_t pixels)
+{
+    for (size_t i = 0; i < pixels; ++i, src += 3, dst += 4)
+    {
+        dst[0] = src[0];
+        dst[1] = src[1];
+        dst[2] = src[2];
+        dst[3] = 255;
+    }
+}
+
+std::vector<uint8> randomBytes(size_t count, uint32 seed)
+{
+    std::mt19937 random(seed);
+    std::vector<uint8> bytes(count);
+    for (auto &byte : bytes) byte = uint8(random());
+    return bytes;
+}
+
+// pixel counts below, at and above multiples of the 16 pixel SIMD step, src and dst start off their alignment and
+// the bytes behind dst must stay untouched
+bool matchesReference(size_t pixels)
+{
+    const size_t guard = 64;
+    auto src           = randomBytes(pixels * 3 + 1, uint32(pixels));
+    std::vector<uint8> expected(pixels * 4 + 1 + guard, 0xCD);
+    auto actual = expected;
+
+    referenceRGBToRGBA(src.data() + 1, expected.data() + 1, pixels);
+    io::Image::RGBToRGBA(src.data() + 1, actual.data() + 1, pixels);
+    return actual == expected;
+}
+
+// binary PPM, SDL_image decodes it into an RGB24 surface whose rows are padded to 4 bytes
+std::string ppm(int32 width, int32 height, const std::vector<uint8> &rgb)
+{
+    auto file = fmt::format("P6\n{} {}\n255\n", width, height);
+    file.append(rgb.begin(), rgb.end());
+    return file;
+}
+
+// decoded through Image::Load, packed rows go through RGBToRGBA at once, padded ones row by row
+bool decodes(int32 width, int32 height)
+{
+    auto rgb = randomBytes(size_t(width) * height * 3, uint32(width));
+    std::vector<uint8> expected(size_t(width) * height * 4);
+    referenceRGBToRGBA(rgb.data(), expected.data(), size_t(width) * height);
+
+    auto file = ppm(width, height, rgb);
+    io::Image image;
+    return image.Load(io::ByteView(file.data(), file.size()), fmt::format("{}x{} PPM", width, height)) &&
+           image.Width == width && image.Height == height && image.Size() == expected.size() &&
+           std::equal(expected.begin(), expected.end(), image.GetPixelData());
+}
+} // namespace
+
+namespace Bench
+{
+void RGBToRGBA()
+{
+    const size_t pixels = 1920 * 1080;
+    Section(fmt::format("RGB to RGBA, {} backend, 1920x1080", io::Image::RGBToRGBABackend()));
+
+    auto src = randomBytes(pixels * 3, 1);
+    std::vector<uint8> dst(pixels * 4);
+    auto reference = Measure(10, [&]() { referenceRGBToRGBA(src.data(), dst.data(), pixels); });
+    auto expected  = dst;
+    auto swizzle   = Measure(10, [&]() { io::Image::RGBToRGBA(src.data(), dst.data(), pixels); });
+
+    // bytes read plus bytes written
+    auto bandwidth = [&](double ms) { return fmt::format("{:.1f} GB/s", pixels * 7 / (ms / 1000) / 1e9); };
+    Report("scalar", reference, bandwidth(reference));
+    Report(io::Image::RGBToRGBABackend(), swizzle, bandwidth(swizzle));
+    Speedup(fmt::format("{} vs scalar", io::Image::RGBToRGBABackend()), reference, swizzle);
+    if (dst != expected) fmtx::Error("RGBToRGBA differs from the scalar conversion");
+}
+
+bool CheckRGBToRGBA()
+{
+    fmtx::Info(fmt::format("RGBToRGBA uses the {} backend", io::Image::RGBToRGBABackend()));
+
+    bool ok   = true;
+    bool same = true;
+    for (size_t pixels = 0; pixels <= 70; ++pixels) same &= matchesReference(pixels);
+    ok &= Expect(same, "small conversions match the scalar one and stay in bounds");
+    ok &= Expect(matchesReference(1000003), "large conversion matches the scalar one");
+
+    // 32 pixels make 96 byte rows, 33 and 5 pixel rows are padded, 1 pixel wide images are all padding
+    for (int32 width : {32, 33, 5, 1}) ok &= Expect(decodes(width, 7), fmt::format("{} pixel wide RGB decodes", width));
+    return ok;
+}
+}; // namespace Bench
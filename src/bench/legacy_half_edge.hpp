@@ -0,0 +1,156 @@
+#pragma once
+
+#include "../core/all.hpp"
+#include <functional>
+#include <map>
+#include <memory>
+
+// Half-edge mesh as it was before HalfEdgeMesh moved to structure of arrays: every element is its own
+// shared_ptr and links are weak_ptr. Kept only as the baseline benchmarks compare against.
+namespace Legacy
+{
+class HalfEdge
+{
+public:
+    using Ptr = std::shared_ptr<HalfEdge>;
+    using Ref = std::weak_ptr<HalfEdge>;
+
+    struct Vertex
+    {
+        using Ptr = std::shared_ptr<Vertex>;
+        using Ref = std::weak_ptr<Vertex>;
+        static Ptr New(const Vec3 &v) { return std::make_shared<Vertex>(v); }
+        Vertex(const Vec3 &v) : P(v) {}
+
+        Vec3 P;
+        HalfEdge::Ref IncidentEdge;
+    };
+
+    struct Face
+    {
+        using Ptr = std::shared_ptr<Face>;
+        using Ref = std::weak_ptr<Face>;
+        static Ptr New() { return std::make_shared<Face>(); }
+
+        HalfEdge::Ref Edge;
+
+        Vec3 Center() const;
+        Vec3 Normal() const;
+        void EachTriangle(const std::function<void(const Vertex::Ptr &, const Vertex::Ptr &, const Vertex::Ptr &)> &fn
+        ) const;
+    };
+
+public:
+    static Ptr New() { return std::make_shared<HalfEdge>(); }
+
+public:
+    Vertex::Ref Origin;
+    Ref Twin;
+    Face::Ref IncidentFace;
+    Ref Prev;
+    Ref Next;
+};
+
+inline Vec3 HalfEdge::Face::Center() const
+{
+    Vec3 sum(0);
+    auto e       = Edge.lock();
+    float points = 0;
+    do
+    {
+        sum += e->Origin.lock()->P;
+        e = e->Next.lock();
+        points += 1;
+    } while (e != Edge.lock());
+
+    return sum / points;
+}
+
+inline Vec3 HalfEdge::Face::Normal() const
+{
+    auto edge1 = Edge.lock()->Next.lock()->Origin.lock()->P - Edge.lock()->Origin.lock()->P;
+    auto edge2 = Edge.lock()->Next.lock()->Next.lock()->Origin.lock()->P - Edge.lock()->Origin.lock()->P;
+    return Mathf::Normalize(Mathf::Cross(edge1, edge2));
+}
+
+inline void HalfEdge::Face::EachTriangle(
+    const std::function<void(const Vertex::Ptr &, const Vertex::Ptr &, const Vertex::Ptr &)> &fn
+) const
+{
+    auto first = Edge.lock();
+    auto a     = first->Origin.lock();
+    auto e     = first->Next.lock();
+    auto next  = e->Next.lock();
+    while (next != first)
+    {
+        fn(a, e->Origin.lock(), next->Origin.lock());
+        e    = next;
+        next = next->Next.lock();
+    }
+}
+
+struct Mesh
+{
+    std::vector<HalfEdge::Vertex::Ptr> Vertices;
+    std::vector<HalfEdge::Face::Ptr> Faces;
+    std::vector<HalfEdge::Ptr> Edges;
+
+    // same input as HalfEdgeMesh::FromIndexed, boundary half-edges are not created
+    static Mesh FromIndexed(
+        const std::vector<Vec3> &positions,
+        const std::vector<uint32> &indices,
+        const std::vector<uint32> &faceSizes
+    )
+    {
+        Mesh mesh;
+        for (const auto &p : positions) mesh.Vertices.emplace_back(HalfEdge::Vertex::New(p));
+
+        size_t offset = 0;
+        for (auto size : faceSizes)
+        {
+            auto face  = HalfEdge::Face::New();
+            auto first = mesh.Edges.size();
+            for (uint32 i = 0; i < size; ++i)
+            {
+                auto e          = HalfEdge::New();
+                auto v          = mesh.Vertices[indices[offset + i]];
+                e->Origin       = v;
+                e->IncidentFace = face;
+                if (v->IncidentEdge.expired()) v->IncidentEdge = e;
+                mesh.Edges.emplace_back(e);
+            }
+            for (uint32 i = 0; i < size; ++i)
+            {
+                mesh.Edges[first + i]->Next = mesh.Edges[first + (i + 1) % size];
+                mesh.Edges[first + i]->Prev = mesh.Edges[first + (i + size - 1) % size];
+            }
+            face->Edge = mesh.Edges[first];
+            mesh.Faces.emplace_back(face);
+            offset += size;
+        }
+        return mesh;
+    }
+
+    // the std::map based twin search HalfEdgeMesh::generateMissingTwins replaced
+    void GenerateMissingTwins()
+    {
+        std::map<std::pair<HalfEdge::Vertex::Ptr, HalfEdge::Vertex::Ptr>, HalfEdge::Ptr> edgeMap;
+        for (const auto &e : Edges)
+        {
+            auto key     = std::make_pair(e->Origin.lock(), e->Next.lock()->Origin.lock());
+            edgeMap[key] = e;
+        }
+
+        for (const auto &e : Edges)
+        {
+            auto key = std::make_pair(e->Next.lock()->Origin.lock(), e->Origin.lock());
+            if (edgeMap.find(key) != edgeMap.end())
+            {
+                auto twin  = edgeMap[key];
+                e->Twin    = twin;
+                twin->Twin = e;
+            }
+        }
+    }
+};
+}; // namespace Legacy
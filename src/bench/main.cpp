@@ -0,0 +1,50 @@
+#include "bench.hpp"
+#include "suites.hpp"
+#include <cstring>
+
+// bench [--check] [suite...]
+// Runs every suite when none is named. --check only runs correctness checks and fails the process when one does.
+int main(int argc, char **argv)
+{
+    const Bench::Suite suites[] = {
+        {"half_edge", Bench::HalfEdge, Bench::CheckHalfEdge},
+        {"bvh", Bench::BVH, Bench::CheckBVH},
+        {"ray_triangle", Bench::RayTriangle, Bench::CheckRayTriangle},
+        {"obj_weld", Bench::ObjWeld, Bench::CheckObjWeld},
+        {"obj_parse", Bench::ObjParse, Bench::CheckObjParse},
+        {"mesh_cache", Bench::MeshCache, Bench::CheckMeshCache},
+        {"async_reader", Bench::AsyncReader, Bench::CheckAsyncReader},
+        {"rgb_to_rgba", Bench::RGBToRGBA, Bench::CheckRGBToRGBA},
+        {"debug_draw", Bench::DebugDraw, Bench::CheckDebugDraw},
+        {"pipeline_cache", Bench::PipelineCache, Bench::CheckPipelineCache},
+        {"pipeline_compiler", Bench::PipelineCompiler, Bench::CheckPipelineCompiler},
+        {"recorder", Bench::Recorder, Bench::CheckRecorder},
+    };
+
+    bool check = false;
+    std::vector<std::string> names;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--check") == 0)
+            check = true;
+        else
+            names.emplace_back(argv[i]);
+    }
+
+    fmtx::Info(fmt::format("{}, {} threads", CPU::Describe(), Parallel::ThreadCount()));
+
+    bool ok = true;
+    for (const auto &suite : suites)
+    {
+        if (!names.empty() && std::find(names.begin(), names.end(), suite.Name) == names.end()) continue;
+
+        if (check)
+        {
+            if (suite.Check) ok &= suite.Check();
+        }
+        else
+            suite.Run();
+    }
+
+    return ok ? 0 : 1;
+}
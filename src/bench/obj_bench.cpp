@@ -0,0 +1,293 @@
+#include "../io/mesh.hpp"
+#include "../io/obj.hpp"
+#include "bench.hpp"
+#include "suites.hpp"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace
+{
+// size x size quads, one v/vt per grid point shared by up to 4 quads, a new o every 64 rows so welding crosses shapes,
+// split into triangles up front when tinyobj has to agree with the mapped parser, it picks quad diagonals by length
+std::string writeGrid(uint32 size, bool quads = true)
+{
+    auto path = (std::filesystem::temp_directory_path() / fmt::format("diye_grid_{}.obj", size)).string();
+
+    std::string text;
+    text.reserve(size_t(size + 1) * (size + 1) * 48 + size_t(size) * size * 48);
+    auto out = std::back_inserter(text);
+    for (uint32 y = 0; y <= size; ++y)
+    {
+        for (uint32 x = 0; x <= size; ++x)
+        {
+            fmt::format_to(out, "v {} {:.4f} {}\n", x, std::sin(x * 0.05f) * std::cos(y * 0.05f), y);
+            fmt::format_to(out, "vt {:.6f} {:.6f}\n", float(x) / size, float(y) / size);
+        }
+    }
+    fmt::format_to(out, "vn 0 1 0\n");
+    for (uint32 y = 0; y < size; ++y)
+    {
+        if (y % 64 == 0) fmt::format_to(out, "o rows_{}\n", y);
+        for (uint32 x = 0; x < size; ++x)
+        {
+            // 1 based, position and texture coordinate share the index
+            const uint32 v = y * (size + 1) + x + 1;
+            const uint32 a = v, b = v + size + 1, c = v + size + 2, d = v + 1;
+            if (quads)
+                fmt::format_to(out, "f {0}/{0}/1 {1}/{1}/1 {2}/{2}/1 {3}/{3}/1\n", a, b, c, d);
+            else
+            {
+                fmt::format_to(out, "f {0}/{0}/1 {1}/{1}/1 {2}/{2}/1\n", a, b, c);
+                fmt::format_to(out, "f {0}/{0}/1 {1}/{1}/1 {2}/{2}/1\n", a, c, d);
+            }
+        }
+    }
+
+    std::ofstream file(path, std::ios::binary);
+    file.write(text.data(), std::streamsize(text.size()));
+    return file ? path : "";
+}
+
+// one vertex per corner before welding, 4 byte indices either way
+void reportWeld(const std::string &name, const std::string &path)
+{
+    io::OBJ obj;
+    auto time = Bench::Measure(3, [&]() { obj.Load(path); });
+
+    const auto &mesh = obj.GetMesh();
+    auto corners     = mesh.indices.size();
+    auto vertexSize  = sizeof(io::OBJ::Vertex);
+    auto beforeBytes = corners * (vertexSize + sizeof(uint32_t));
+    auto afterBytes  = mesh.vertices.size() * vertexSize + mesh.indices.size() * sizeof(uint32_t);
+    Bench::Report(
+        fmt::format("{} load and weld", name),
+        time,
+        fmt::format("{} corners to {} vertices, {} indices", corners, mesh.vertices.size(), mesh.indices.size())
+    );
+    fmtx::Info(fmt::format(
+        "{} vertex and index data {} KB to {} KB, {:.2f}x smaller",
+        name,
+        beforeBytes / 1024,
+        afterBytes / 1024,
+        afterBytes > 0 ? double(beforeBytes) / afterBytes : 0.0
+    ));
+}
+
+// full Load, the weld after parsing is the same code for both parsers
+double measureLoad(const std::string &path, io::OBJ::Parser parser, size_t &indices)
+{
+    io::OBJ obj;
+    auto time = Bench::Measure(3, [&]() { obj.Load(path, parser); });
+    indices   = obj.GetMesh().indices.size();
+    return time;
+}
+
+void compareParsers(const std::string &name, const std::string &path)
+{
+    size_t tinyIndices   = 0;
+    size_t mappedIndices = 0;
+    auto tinyObj         = measureLoad(path, io::OBJ::Parser::TinyObj, tinyIndices);
+    auto mapped          = measureLoad(path, io::OBJ::Parser::Mapped, mappedIndices);
+    Bench::Report(fmt::format("{} tinyobj", name), tinyObj, fmt::format("{} indices", tinyIndices));
+    Bench::Report(
+        fmt::format("{} mapped", name),
+        mapped,
+        fmt::format("{} indices{}", mappedIndices, mappedIndices == tinyIndices ? "" : ", results differ")
+    );
+    Bench::Speedup(fmt::format("{} mapped vs tinyobj", name), tinyObj, mapped);
+}
+
+// cache hit maps the file, vertex pages are only read once something touches them, e.g. the staging copy
+void compareCache(const std::string &name, const std::string &source)
+{
+    auto cache     = source + ".mesh";
+    uint32 indices = 0;
+    io::OBJ obj;
+    auto load    = Bench::Measure(3, [&]() { obj.Load(source); });
+    auto rebuild = Bench::Measure(
+        3,
+        [&]()
+        {
+            std::remove(cache.c_str());
+            indices = io::MeshFile::LoadCached(source)->IndexCount();
+        }
+    );
+    // file is in the OS cache from the rebuild, as it is on every launch after the first
+    auto hit = Bench::Measure(3, [&]() { indices = io::MeshFile::LoadCached(source)->IndexCount(); });
+
+    Bench::Report(fmt::format("{} OBJ load", name), load, fmt::format("{} indices", obj.GetMesh().indices.size()));
+    Bench::Report(fmt::format("{} cache rebuild", name), rebuild, "OBJ load plus writing the cache");
+    Bench::Report(
+        fmt::format("{} cache hit", name),
+        hit,
+        fmt::format("{} indices, {} KB file", indices, std::filesystem::file_size(cache) / 1024)
+    );
+    Bench::Speedup(fmt::format("{} cache hit vs OBJ load", name), load, hit);
+}
+
+// the file holds exactly the welded mesh
+bool sameMesh(const io::MeshFile &file, const io::OBJ::Mesh &mesh)
+{
+    return file.VertexCount() == mesh.vertices.size() && file.IndexCount() == mesh.indices.size() &&
+           std::memcmp(file.Vertices(), mesh.vertices.data(), file.VertexDataSize()) == 0 &&
+           std::equal(mesh.indices.begin(), mesh.indices.end(), file.Indices());
+}
+} // namespace
+
+namespace Bench
+{
+void ObjWeld()
+{
+    Section("OBJ vertex welding");
+
+    // `make assets` copies it next to the binaries
+    if (std::filesystem::exists("viking_room.obj"))
+        reportWeld("viking_room", "viking_room.obj");
+    else
+        fmtx::Warn("viking_room.obj not found, run make assets");
+
+    auto grid = writeGrid(512);
+    if (grid.empty())
+    {
+        fmtx::Error("Failed to write synthetic OBJ");
+        return;
+    }
+    reportWeld("512x512 grid", grid);
+    std::remove(grid.c_str());
+}
+
+bool CheckObjWeld()
+{
+    const uint32 size = 40;
+    auto path         = writeGrid(size);
+    if (!Expect(!path.empty(), "synthetic OBJ written")) return false;
+
+    io::OBJ obj;
+    bool ok = Expect(obj.Load(path), "synthetic OBJ loads");
+    std::remove(path.c_str());
+    if (!ok) return false;
+
+    // every corner keeps its position, shared grid points collapse into one vertex across shapes
+    const auto &mesh    = obj.GetMesh();
+    const auto polygons = obj.GetPolygons();
+    bool samePositions  = mesh.indices.size() == polygons.indices.size();
+    for (size_t i = 0; samePositions && i < mesh.indices.size(); ++i)
+        samePositions = mesh.vertices[mesh.indices[i]].pos == polygons.positions[polygons.indices[i]];
+
+    ok &= Expect(mesh.indices.size() == size_t(size) * size * 6, "two triangles per quad");
+    ok &= Expect(mesh.vertices.size() == size_t(size + 1) * (size + 1), "one vertex per grid point");
+    ok &= Expect(samePositions, "welded corners keep their positions");
+    return ok;
+}
+
+void ObjParse()
+{
+    Section(fmt::format("OBJ load, parse and weld, {} threads", Parallel::ThreadCount()));
+
+    if (std::filesystem::exists("viking_room.obj"))
+        compareParsers("viking_room", "viking_room.obj");
+    else
+        fmtx::Warn("viking_room.obj not found, run make assets");
+
+    // big enough that the mapped parser splits it into one chunk per thread
+    auto grid = writeGrid(1024);
+    if (grid.empty())
+    {
+        fmtx::Error("Failed to write synthetic OBJ");
+        return;
+    }
+    compareParsers("1024x1024 grid", grid);
+    std::remove(grid.c_str());
+}
+
+bool CheckObjParse()
+{
+    auto path = writeGrid(300, false);
+    if (!Expect(!path.empty(), "synthetic OBJ written")) return false;
+
+    io::OBJ mapped, tinyObj;
+    bool ok = Expect(mapped.Load(path, io::OBJ::Parser::Mapped), "mapped parser loads synthetic OBJ");
+    ok &= Expect(tinyObj.Load(path, io::OBJ::Parser::TinyObj), "tinyobj loads synthetic OBJ");
+    std::remove(path.c_str());
+    if (!ok) return false;
+
+    // chunk boundaries must not change a single index, floats may differ in the last bit between the two parsers
+    const auto &a = mapped.GetMesh();
+    const auto &b = tinyObj.GetMesh();
+    bool same     = a.indices == b.indices && a.vertices.size() == b.vertices.size();
+    for (size_t i = 0; same && i < a.vertices.size(); ++i)
+    {
+        same = Mathf::Distance(a.vertices[i].pos, b.vertices[i].pos) < 1e-4f &&
+               Mathf::Distance(a.vertices[i].texCoord, b.vertices[i].texCoord) < 1e-6f;
+    }
+    return Expect(same, "mapped parser matches tinyobj");
+}
+
+void MeshCache()
+{
+    Section("mesh cache, LoadCached hit vs rebuild from the OBJ");
+
+    if (std::filesystem::exists("viking_room.obj"))
+        compareCache("viking_room", "viking_room.obj");
+    else
+        fmtx::Warn("viking_room.obj not found, run make assets");
+
+    auto grid = writeGrid(512);
+    if (grid.empty())
+    {
+        fmtx::Error("Failed to write synthetic OBJ");
+        return;
+    }
+    compareCache("512x512 grid", grid);
+    std::remove(grid.c_str());
+    std::remove((grid + ".mesh").c_str());
+}
+
+bool CheckMeshCache()
+{
+    auto source = writeGrid(40);
+    if (!Expect(!source.empty(), "synthetic OBJ written")) return false;
+    auto cache = source + ".mesh";
+    std::remove(cache.c_str());
+
+    io::OBJ obj;
+    bool ok = Expect(obj.Load(source), "synthetic OBJ loads");
+    ok &= Expect(sameMesh(*io::MeshFile::LoadCached(source), obj.GetMesh()), "rebuilt cache holds the OBJ mesh");
+    ok &= Expect(std::filesystem::exists(cache), "rebuilt cache is written");
+    ok &= Expect(sameMesh(*io::MeshFile::LoadCached(source), obj.GetMesh()), "cache hit holds the OBJ mesh");
+
+    io::MeshFile::SourceKey key;
+    ok &= Expect(io::MeshFile::QuerySource(source, key), "source is found");
+    ok &= Expect(!io::MeshFile::Open(cache, key)->IsEmpty(), "cache matches its source");
+    key.size += 1;
+    ok &= Expect(io::MeshFile::Open(cache, key)->IsEmpty(), "cache of another source is rejected");
+
+    // the key still matches, only the contents are broken, each has to be rejected and rebuilt
+    auto bytes = io::BinaryFile::Load(cache)->Bytes();
+    if (ok && bytes.size() > 4)
+    {
+        auto broken = bytes;
+        std::memset(broken.data() + broken.size() - 4, 0xFF, 4);
+        ok &= Expect(io::BinaryFile::Save(cache, broken.data(), broken.size()), "cache with a bad index is written");
+        ok &= Expect(sameMesh(*io::MeshFile::LoadCached(source), obj.GetMesh()), "index past the vertices rebuilds");
+
+        ok &= Expect(io::BinaryFile::Save(cache, bytes.data(), bytes.size() - 1), "truncated cache is written");
+        ok &= Expect(sameMesh(*io::MeshFile::LoadCached(source), obj.GetMesh()), "truncated cache rebuilds");
+    }
+
+    // a changed source makes the cache stale
+    {
+        std::ofstream file(source, std::ios::app);
+        file << "# edited\n";
+    }
+    ok &= Expect(sameMesh(*io::MeshFile::LoadCached(source), obj.GetMesh()), "cache of an edited source rebuilds");
+    ok &= Expect(io::MeshFile::QuerySource(source, key), "edited source is found");
+    ok &= Expect(!io::MeshFile::Open(cache, key)->IsEmpty(), "cache rebuilt for the edited source is written");
+
+    std::remove(source.c_str());
+    std::remove(cache.c_str());
+    return ok;
+}
+}; // namespace Bench
@@ -0,0 +1,143 @@
+#include "bench.hpp"
+#include "suites.hpp"
+#include <cmath>
+#include <random>
+
+namespace
+{
+using Mathf::PacketKernel;
+using Mathf::TrianglePacket;
+
+struct Scene
+{
+    std::vector<Vec3> Corners; // 3 per triangle
+    std::vector<TrianglePacket> Packets;
+    std::vector<Ray> Rays;
+};
+
+// small triangles scattered in a unit cube, rays from outside through random points of it
+Scene scene(uint32 packetCount, uint32 rayCount)
+{
+    std::mt19937 random(3);
+    std::uniform_real_distribution<float> unit(-1, 1);
+    auto point = [&]() { return Vec3(unit(random), unit(random), unit(random)); };
+
+    Scene scene;
+    scene.Packets.resize(packetCount);
+    for (auto &packet : scene.Packets)
+    {
+        for (int lane = 0; lane < TrianglePacket::Lanes; ++lane)
+        {
+            auto a = point();
+            auto b = a + point() * 0.3f;
+            auto c = a + point() * 0.3f;
+            packet.Set(lane, a, b, c);
+            scene.Corners.insert(scene.Corners.end(), {a, b, c});
+        }
+    }
+
+    scene.Rays.resize(rayCount);
+    for (auto &ray : scene.Rays)
+    {
+        ray.Origin    = Mathf::Normalize(point()) * 4.0f;
+        ray.Direction = Mathf::Normalize(point() * 0.5f - ray.Origin);
+    }
+    return scene;
+}
+
+// closest triangle every ray hits, Mathf::RayTriangleIntersection one triangle at a time
+uint64 traceOneByOne(const Scene &scene)
+{
+    uint64 sum = 0;
+    for (const auto &ray : scene.Rays)
+    {
+        float closest = std::numeric_limits<float>::max();
+        uint32 hit    = 0;
+        for (uint32 t = 0; t < scene.Corners.size() / 3; ++t)
+        {
+            float distance;
+            const auto *c = &scene.Corners[t * 3];
+            if (Mathf::RayTriangleIntersection(ray, c[0], c[1], c[2], distance) && distance < closest)
+            {
+                closest = distance;
+                hit     = t + 1;
+            }
+        }
+        sum += hit;
+    }
+    return sum;
+}
+
+uint64 tracePackets(const Scene &scene, PacketKernel kernel)
+{
+    uint64 sum = 0;
+    for (const auto &ray : scene.Rays)
+    {
+        float closest = std::numeric_limits<float>::max();
+        Vec2 barycentric;
+        uint32 hit = 0;
+        for (uint32 p = 0; p < scene.Packets.size(); ++p)
+        {
+            auto lane = Mathf::RayTrianglesIntersection(ray, scene.Packets[p], closest, barycentric, kernel);
+            if (lane >= 0) hit = p * TrianglePacket::Lanes + lane + 1;
+        }
+        sum += hit;
+    }
+    return sum;
+}
+
+struct Kernel
+{
+    const char *Name;
+    PacketKernel Value;
+    bool Supported;
+};
+
+std::vector<Kernel> kernels()
+{
+    return {
+        {"scalar packet", PacketKernel::Scalar, true},
+        {"SSE packet", PacketKernel::SSE, CPU::HasSSE2()},
+        {"AVX2 packet", PacketKernel::AVX2, CPU::HasAVX2()},
+    };
+}
+} // namespace
+
+namespace Bench
+{
+void RayTriangle()
+{
+    const auto input   = scene(2048, 256);
+    const double tests = double(input.Rays.size()) * input.Corners.size() / 3;
+    auto nanoseconds   = [&](double ms) { return fmt::format("{:.2f} ns per triangle", ms * 1e6 / tests); };
+    Section(fmt::format("ray / triangle, {} rays x {} triangles", input.Rays.size(), input.Corners.size() / 3));
+
+    uint64 reference = 0;
+    auto oneByOne    = Measure(3, [&]() { reference = traceOneByOne(input); });
+    Report("Mathf::RayTriangleIntersection", oneByOne, nanoseconds(oneByOne));
+
+    for (const auto &kernel : kernels())
+    {
+        if (!kernel.Supported) continue;
+
+        uint64 sum = 0;
+        auto time  = Measure(3, [&]() { sum = tracePackets(input, kernel.Value); });
+        Report(kernel.Name, time, nanoseconds(time) + (sum == reference ? "" : ", results differ"));
+        Speedup(fmt::format("{} vs one by one", kernel.Name), oneByOne, time);
+    }
+}
+
+bool CheckRayTriangle()
+{
+    // every kernel has to pick the same closest triangle as the scalar test, up to float ties
+    const auto input = scene(256, 512);
+    const auto sum   = traceOneByOne(input);
+    bool ok          = true;
+    for (const auto &kernel : kernels())
+    {
+        if (kernel.Supported)
+            ok &= Expect(tracePackets(input, kernel.Value) == sum, fmt::format("{} matches scalar test", kernel.Name));
+    }
+    return ok;
+}
+}; // namespace Bench
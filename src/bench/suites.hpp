@@ -0,0 +1,33 @@
+#pragma once
+
+// one Run and optional Check function per suite, see Bench::Suite
+namespace Bench
+{
+void HalfEdge();
+bool CheckHalfEdge();
+void BVH();
+bool CheckBVH();
+void RayTriangle();
+bool CheckRayTriangle();
+void ObjWeld();
+bool CheckObjWeld();
+void ObjParse();
+bool CheckObjParse();
+void MeshCache();
+bool CheckMeshCache();
+void AsyncReader();
+bool CheckAsyncReader();
+void RGBToRGBA();
+bool CheckRGBToRGBA();
+// headless, built once per imdd backend
+void DebugDraw();
+bool CheckDebugDraw();
+// headless, skipped without a Vulkan device
+void PipelineCache();
+bool CheckPipelineCache();
+void PipelineCompiler();
+// runs without a GPU
+bool CheckPipelineCompiler();
+void Recorder();
+bool CheckRecorder();
+}; // namespace Bench
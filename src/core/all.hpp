@@ -4,8 +4,10 @@
 #include "animation_curve.hpp"
 #include "camera.hpp"
 #include "colors.hpp"
+#include "cpu.hpp"
 #include "map.hpp"
 #include "math.hpp"
+#include "parallel.hpp"
 #include "timer.hpp"
 #include "transform.hpp"
 #include "types.hpp"
\ No newline at end of file
@@ -0,0 +1,70 @@
+#include "cpu.hpp"
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#endif
+
+namespace CPU
+{
+namespace
+{
+struct Features
+{
+    bool SSE2  = false;
+    bool SSSE3 = false;
+    bool SSE41 = false;
+    bool AVX2  = false;
+};
+
+Features detect()
+{
+    Features features;
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    __builtin_cpu_init();
+    features.SSE2  = __builtin_cpu_supports("sse2");
+    features.SSSE3 = __builtin_cpu_supports("ssse3");
+    features.SSE41 = __builtin_cpu_supports("sse4.1");
+    features.AVX2  = __builtin_cpu_supports("avx2");
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    int info[4];
+    __cpuid(info, 0);
+    const int maxLeaf = info[0];
+    __cpuid(info, 1);
+    features.SSE2  = (info[3] & (1 << 26)) != 0;
+    features.SSSE3 = (info[2] & (1 << 9)) != 0;
+    features.SSE41 = (info[2] & (1 << 19)) != 0;
+    // AVX2 also needs the OS to save YMM registers (OSXSAVE + XCR0)
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    if (maxLeaf >= 7 && osxsave && (_xgetbv(0) & 0x6) == 0x6)
+    {
+        __cpuidex(info, 7, 0);
+        features.AVX2 = (info[1] & (1 << 5)) != 0;
+    }
+#endif
+    return features;
+}
+
+const Features &features()
+{
+    static const Features cached = detect();
+    return cached;
+}
+} // namespace
+
+bool HasSSE2() { return features().SSE2; }
+
+bool HasSSSE3() { return features().SSSE3; }
+
+bool HasSSE41() { return features().SSE41; }
+
+bool HasAVX2() { return features().AVX2; }
+
+std::string Describe()
+{
+    if (HasAVX2()) return "AVX2";
+    if (HasSSE41()) return "SSE4.1";
+    if (HasSSSE3()) return "SSSE3";
+    if (HasSSE2()) return "SSE2";
+    return "scalar";
+}
+}; // namespace CPU
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <string>
+
+// Instruction sets available at runtime, used to pick SIMD code paths.
+// Always false on non-x86 targets.
+namespace CPU
+{
+bool HasSSE2();
+bool HasSSSE3();
+bool HasSSE41();
+bool HasAVX2();
+std::string Describe();
+}; // namespace CPU
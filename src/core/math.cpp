@@ -48,6 +48,19 @@ Quat QuatAngles(const Vec3 &angles)
 Quat Rotate(const Quat &q, float deg, const Vec3 &axes) { return glm::rotate(q, glm::radians(deg), axes); }
 
 bool RayTriangleIntersection(const Ray &ray, const Vec3 &a, const Vec3 &b, const Vec3 &c, float &distance)
+{
+    Vec2 barycentric;
+    return RayTriangleIntersection(ray, a, b, c, distance, barycentric);
+}
+
+bool RayTriangleIntersection(
+    const Ray &ray,
+    const Vec3 &a,
+    const Vec3 &b,
+    const Vec3 &c,
+    float &distance,
+    Vec2 &barycentric
+)
 {
     const float EPSILON = 0.0000001f;
     Vec3 edge1          = b - a;
@@ -72,7 +85,8 @@ bool RayTriangleIntersection(const Ray &ray, const Vec3 &a, const Vec3 &b, const
 
     if (t > EPSILON) // ray intersection
     {
-        distance = t;
+        distance    = t;
+        barycentric = Vec2(u, v);
         return true;
     }
     else // This means that there is a line intersection but not a ray intersection.
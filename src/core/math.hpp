@@ -4,6 +4,19 @@
 
 namespace Mathf
 {
+// Up to 8 triangles in structure of arrays layout for the packet ray test: corner a and edges b - a, c - a.
+// Unused lanes stay zero, a degenerate triangle that never hits.
+struct alignas(32) TrianglePacket
+{
+    static constexpr int Lanes = 8;
+
+    float A[3][Lanes]  = {};
+    float E1[3][Lanes] = {};
+    float E2[3][Lanes] = {};
+
+    void Set(int lane, const Vec3 &a, const Vec3 &b, const Vec3 &c);
+};
+
 Mat4 Fov(float degAngle, int w, int h, float zNear = 0.001f, float zFar = 1000.0f);
 Mat4 Ortho(float left, float right, float bottom, float top, float zNear, float zFar);
 Vec3 Cross(const Vec3 &a, const Vec3 &b);
@@ -23,4 +36,32 @@ float Abs(float val);
 Quat QuatAngles(const Vec3 &angles);
 Quat Rotate(const Quat &q, float deg, const Vec3 &axes = UP);
 bool RayTriangleIntersection(const Ray &ray, const Vec3 &a, const Vec3 &b, const Vec3 &c, float &distance);
+// barycentric.x/y are weights of b and c, a gets 1 - x - y
+bool RayTriangleIntersection(
+    const Ray &ray,
+    const Vec3 &a,
+    const Vec3 &b,
+    const Vec3 &c,
+    float &distance,
+    Vec2 &barycentric
+);
+// Closest lane hit nearer than distance (updated on hit) or -1, same rules as RayTriangleIntersection.
+// Runs AVX2, SSE or scalar code depending on what the CPU supports, picked once on first call.
+int RayTrianglesIntersection(const Ray &ray, const TrianglePacket &packet, float &distance, Vec2 &barycentric);
+// code paths of the packet test, Auto is the best one the CPU supports
+enum class PacketKernel
+{
+    Auto,
+    Scalar,
+    SSE,
+    AVX2
+};
+// same as above on a fixed code path for benchmarks and tests, kernels the CPU lacks run the scalar one
+int RayTrianglesIntersection(
+    const Ray &ray,
+    const TrianglePacket &packet,
+    float &distance,
+    Vec2 &barycentric,
+    PacketKernel kernel
+);
 }; // namespace Mathf
\ No newline at end of file
@@ -0,0 +1,228 @@
+#include "cpu.hpp"
+#include "math.hpp"
+#include <limits>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define MATHF_X86 1
+#include <immintrin.h>
+#endif
+
+// AVX2 kernel is compiled for AVX2 regardless of global flags, it only runs after CPU detection
+#if defined(__GNUC__) || defined(__clang__)
+#define MATHF_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define MATHF_TARGET_AVX2
+#endif
+
+namespace Mathf
+{
+namespace
+{
+constexpr float EPSILON  = 0.0000001f;
+constexpr float Infinity = std::numeric_limits<float>::infinity();
+
+using PacketIntersection = int (*)(const Ray &, const TrianglePacket &, float &, Vec2 &);
+
+// kernels write t = infinity for lanes that miss
+int closestLane(const float *t, const float *u, const float *v, float &distance, Vec2 &barycentric)
+{
+    int lane = -1;
+    for (int i = 0; i < TrianglePacket::Lanes; ++i)
+    {
+        if (t[i] < distance)
+        {
+            distance    = t[i];
+            barycentric = Vec2(u[i], v[i]);
+            lane        = i;
+        }
+    }
+    return lane;
+}
+
+int intersectScalar(const Ray &ray, const TrianglePacket &p, float &distance, Vec2 &barycentric)
+{
+    const auto &o = ray.Origin;
+    const auto &d = ray.Direction;
+    float t[TrianglePacket::Lanes], u[TrianglePacket::Lanes], v[TrianglePacket::Lanes];
+    for (int i = 0; i < TrianglePacket::Lanes; ++i)
+    {
+        t[i] = Infinity;
+
+        const float hx  = d.y * p.E2[2][i] - d.z * p.E2[1][i];
+        const float hy  = d.z * p.E2[0][i] - d.x * p.E2[2][i];
+        const float hz  = d.x * p.E2[1][i] - d.y * p.E2[0][i];
+        const float det = p.E1[0][i] * hx + p.E1[1][i] * hy + p.E1[2][i] * hz;
+        if (det > -EPSILON && det < EPSILON) continue;
+
+        const float invDet = 1.0f / det;
+        const float sx     = o.x - p.A[0][i];
+        const float sy     = o.y - p.A[1][i];
+        const float sz     = o.z - p.A[2][i];
+        u[i]               = (sx * hx + sy * hy + sz * hz) * invDet;
+        if (u[i] < 0.0f || u[i] > 1.0f) continue;
+
+        const float qx = sy * p.E1[2][i] - sz * p.E1[1][i];
+        const float qy = sz * p.E1[0][i] - sx * p.E1[2][i];
+        const float qz = sx * p.E1[1][i] - sy * p.E1[0][i];
+        v[i]           = (d.x * qx + d.y * qy + d.z * qz) * invDet;
+        if (v[i] < 0.0f || u[i] + v[i] > 1.0f) continue;
+
+        const float distanceToHit = (p.E2[0][i] * qx + p.E2[1][i] * qy + p.E2[2][i] * qz) * invDet;
+        if (distanceToHit > EPSILON) t[i] = distanceToHit;
+    }
+    return closestLane(t, u, v, distance, barycentric);
+}
+
+#ifdef MATHF_X86
+inline __m128 dot(__m128 ax, __m128 ay, __m128 az, __m128 bx, __m128 by, __m128 bz)
+{
+    return _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, bx), _mm_mul_ps(ay, by)), _mm_mul_ps(az, bz));
+}
+
+int intersectSSE(const Ray &ray, const TrianglePacket &p, float &distance, Vec2 &barycentric)
+{
+    alignas(16) float t[TrianglePacket::Lanes], u[TrianglePacket::Lanes], v[TrianglePacket::Lanes];
+
+    const __m128 ox       = _mm_set1_ps(ray.Origin.x);
+    const __m128 oy       = _mm_set1_ps(ray.Origin.y);
+    const __m128 oz       = _mm_set1_ps(ray.Origin.z);
+    const __m128 dx       = _mm_set1_ps(ray.Direction.x);
+    const __m128 dy       = _mm_set1_ps(ray.Direction.y);
+    const __m128 dz       = _mm_set1_ps(ray.Direction.z);
+    const __m128 zero     = _mm_setzero_ps();
+    const __m128 one      = _mm_set1_ps(1.0f);
+    const __m128 epsilon  = _mm_set1_ps(EPSILON);
+    const __m128 infinity = _mm_set1_ps(Infinity);
+    const __m128 absMask  = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+
+    for (int i = 0; i < TrianglePacket::Lanes; i += 4)
+    {
+        const __m128 e1x = _mm_load_ps(&p.E1[0][i]);
+        const __m128 e1y = _mm_load_ps(&p.E1[1][i]);
+        const __m128 e1z = _mm_load_ps(&p.E1[2][i]);
+        const __m128 e2x = _mm_load_ps(&p.E2[0][i]);
+        const __m128 e2y = _mm_load_ps(&p.E2[1][i]);
+        const __m128 e2z = _mm_load_ps(&p.E2[2][i]);
+
+        const __m128 hx  = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+        const __m128 hy  = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+        const __m128 hz  = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+        const __m128 det = dot(e1x, e1y, e1z, hx, hy, hz);
+        const __m128 inv = _mm_div_ps(one, det);
+
+        const __m128 sx = _mm_sub_ps(ox, _mm_load_ps(&p.A[0][i]));
+        const __m128 sy = _mm_sub_ps(oy, _mm_load_ps(&p.A[1][i]));
+        const __m128 sz = _mm_sub_ps(oz, _mm_load_ps(&p.A[2][i]));
+        const __m128 uu = _mm_mul_ps(dot(sx, sy, sz, hx, hy, hz), inv);
+
+        const __m128 qx = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y));
+        const __m128 qy = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z));
+        const __m128 qz = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x));
+        const __m128 vv = _mm_mul_ps(dot(dx, dy, dz, qx, qy, qz), inv);
+        const __m128 tt = _mm_mul_ps(dot(e2x, e2y, e2z, qx, qy, qz), inv);
+
+        __m128 hit = _mm_cmpge_ps(_mm_and_ps(det, absMask), epsilon);
+        hit        = _mm_and_ps(hit, _mm_cmpge_ps(uu, zero));
+        hit        = _mm_and_ps(hit, _mm_cmple_ps(uu, one));
+        hit        = _mm_and_ps(hit, _mm_cmpge_ps(vv, zero));
+        hit        = _mm_and_ps(hit, _mm_cmple_ps(_mm_add_ps(uu, vv), one));
+        hit        = _mm_and_ps(hit, _mm_cmpgt_ps(tt, epsilon));
+
+        _mm_store_ps(&t[i], _mm_or_ps(_mm_and_ps(hit, tt), _mm_andnot_ps(hit, infinity)));
+        _mm_store_ps(&u[i], uu);
+        _mm_store_ps(&v[i], vv);
+    }
+    return closestLane(t, u, v, distance, barycentric);
+}
+
+MATHF_TARGET_AVX2 inline __m256 dot(__m256 ax, __m256 ay, __m256 az, __m256 bx, __m256 by, __m256 bz)
+{
+    return _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ax, bx), _mm256_mul_ps(ay, by)), _mm256_mul_ps(az, bz));
+}
+
+MATHF_TARGET_AVX2 int intersectAVX2(const Ray &ray, const TrianglePacket &p, float &distance, Vec2 &barycentric)
+{
+    alignas(32) float t[TrianglePacket::Lanes], u[TrianglePacket::Lanes], v[TrianglePacket::Lanes];
+
+    const __m256 dx  = _mm256_set1_ps(ray.Direction.x);
+    const __m256 dy  = _mm256_set1_ps(ray.Direction.y);
+    const __m256 dz  = _mm256_set1_ps(ray.Direction.z);
+    const __m256 one = _mm256_set1_ps(1.0f);
+
+    const __m256 e1x = _mm256_load_ps(p.E1[0]);
+    const __m256 e1y = _mm256_load_ps(p.E1[1]);
+    const __m256 e1z = _mm256_load_ps(p.E1[2]);
+    const __m256 e2x = _mm256_load_ps(p.E2[0]);
+    const __m256 e2y = _mm256_load_ps(p.E2[1]);
+    const __m256 e2z = _mm256_load_ps(p.E2[2]);
+
+    const __m256 hx  = _mm256_sub_ps(_mm256_mul_ps(dy, e2z), _mm256_mul_ps(dz, e2y));
+    const __m256 hy  = _mm256_sub_ps(_mm256_mul_ps(dz, e2x), _mm256_mul_ps(dx, e2z));
+    const __m256 hz  = _mm256_sub_ps(_mm256_mul_ps(dx, e2y), _mm256_mul_ps(dy, e2x));
+    const __m256 det = dot(e1x, e1y, e1z, hx, hy, hz);
+    const __m256 inv = _mm256_div_ps(one, det);
+
+    const __m256 sx = _mm256_sub_ps(_mm256_set1_ps(ray.Origin.x), _mm256_load_ps(p.A[0]));
+    const __m256 sy = _mm256_sub_ps(_mm256_set1_ps(ray.Origin.y), _mm256_load_ps(p.A[1]));
+    const __m256 sz = _mm256_sub_ps(_mm256_set1_ps(ray.Origin.z), _mm256_load_ps(p.A[2]));
+    const __m256 uu = _mm256_mul_ps(dot(sx, sy, sz, hx, hy, hz), inv);
+
+    const __m256 qx = _mm256_sub_ps(_mm256_mul_ps(sy, e1z), _mm256_mul_ps(sz, e1y));
+    const __m256 qy = _mm256_sub_ps(_mm256_mul_ps(sz, e1x), _mm256_mul_ps(sx, e1z));
+    const __m256 qz = _mm256_sub_ps(_mm256_mul_ps(sx, e1y), _mm256_mul_ps(sy, e1x));
+    const __m256 vv = _mm256_mul_ps(dot(dx, dy, dz, qx, qy, qz), inv);
+    const __m256 tt = _mm256_mul_ps(dot(e2x, e2y, e2z, qx, qy, qz), inv);
+
+    const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+    __m256 hit           = _mm256_cmp_ps(_mm256_and_ps(det, absMask), _mm256_set1_ps(EPSILON), _CMP_GE_OQ);
+    hit                  = _mm256_and_ps(hit, _mm256_cmp_ps(uu, _mm256_setzero_ps(), _CMP_GE_OQ));
+    hit                  = _mm256_and_ps(hit, _mm256_cmp_ps(uu, one, _CMP_LE_OQ));
+    hit                  = _mm256_and_ps(hit, _mm256_cmp_ps(vv, _mm256_setzero_ps(), _CMP_GE_OQ));
+    hit                  = _mm256_and_ps(hit, _mm256_cmp_ps(_mm256_add_ps(uu, vv), one, _CMP_LE_OQ));
+    hit                  = _mm256_and_ps(hit, _mm256_cmp_ps(tt, _mm256_set1_ps(EPSILON), _CMP_GT_OQ));
+
+    _mm256_store_ps(t, _mm256_blendv_ps(_mm256_set1_ps(Infinity), tt, hit));
+    _mm256_store_ps(u, uu);
+    _mm256_store_ps(v, vv);
+    return closestLane(t, u, v, distance, barycentric);
+}
+#endif
+
+PacketIntersection selectIntersection(PacketKernel kernel)
+{
+#ifdef MATHF_X86
+    const bool any = kernel == PacketKernel::Auto;
+    if ((any || kernel == PacketKernel::AVX2) && CPU::HasAVX2()) return intersectAVX2;
+    if ((any || kernel == PacketKernel::SSE) && CPU::HasSSE2()) return intersectSSE;
+#endif
+    return intersectScalar;
+}
+} // namespace
+
+void TrianglePacket::Set(int lane, const Vec3 &a, const Vec3 &b, const Vec3 &c)
+{
+    for (int i = 0; i < 3; ++i)
+    {
+        A[i][lane]  = a[i];
+        E1[i][lane] = b[i] - a[i];
+        E2[i][lane] = c[i] - a[i];
+    }
+}
+
+int RayTrianglesIntersection(const Ray &ray, const TrianglePacket &packet, float &distance, Vec2 &barycentric)
+{
+    static const PacketIntersection intersect = selectIntersection(PacketKernel::Auto);
+    return intersect(ray, packet, distance, barycentric);
+}
+
+int RayTrianglesIntersection(
+    const Ray &ray,
+    const TrianglePacket &packet,
+    float &distance,
+    Vec2 &barycentric,
+    PacketKernel kernel
+)
+{
+    return selectIntersection(kernel)(ray, packet, distance, barycentric);
+}
+}; // namespace Mathf
@@ -0,0 +1,89 @@
+#include "parallel.hpp"
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+namespace Parallel
+{
+uint32 ThreadCount()
+{
+    static const uint32 count = std::max(1u, std::thread::hardware_concurrency());
+    return count;
+}
+
+void For(uint32 count, const std::function<void(uint32 begin, uint32 end)> &fn, uint32 minPerThread)
+{
+    if (count == 0) return;
+
+    uint32 threads = std::min(ThreadCount(), std::max(1u, count / std::max(1u, minPerThread)));
+    if (threads == 1)
+    {
+        fn(0, count);
+        return;
+    }
+
+    uint32 chunk = (count + threads - 1) / threads;
+    std::vector<std::thread> workers;
+    workers.reserve(threads - 1);
+    uint32 begin = 0;
+    for (uint32 i = 0; i + 1 < threads && begin < count; ++i, begin += chunk)
+    {
+        uint32 end = std::min(count, begin + chunk);
+        workers.emplace_back([&fn, begin, end]() { fn(begin, end); });
+    }
+    if (begin < count) fn(begin, count);
+
+    for (auto &worker : workers) worker.join();
+}
+
+Pool::Pool(uint32 threads) : busy(0), stopping(false)
+{
+    threads = std::max(1u, threads);
+    workers.reserve(threads);
+    for (uint32 i = 0; i < threads; ++i) workers.emplace_back([this]() { run(); });
+}
+
+Pool::~Pool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto &worker : workers) worker.join();
+}
+
+void Pool::Wait()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [this]() { return tasks.empty() && busy == 0; });
+}
+
+void Pool::enqueue(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.push_back(std::move(task));
+    }
+    wake.notify_one();
+}
+
+void Pool::run()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        wake.wait(lock, [this]() { return stopping || !tasks.empty(); });
+        if (tasks.empty()) return;
+
+        auto task = std::move(tasks.front());
+        tasks.pop_front();
+        ++busy;
+        lock.unlock();
+        task();
+        lock.lock();
+        --busy;
+        if (tasks.empty() && busy == 0) idle.notify_all();
+    }
+}
+}; // namespace Parallel
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "types.hpp"
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Parallel
+{
+// number of threads For() splits work across, at least 1
+uint32 ThreadCount();
+
+// Splits [0, count) into contiguous ranges and calls fn(begin, end) for each on its own thread,
+// calling thread takes the last range. Runs inline when there is less than minPerThread items per thread.
+void For(uint32 count, const std::function<void(uint32 begin, uint32 end)> &fn, uint32 minPerThread = 4096);
+
+// Long lived worker threads running queued tasks in submission order.
+// Queued tasks still run when the pool is destroyed.
+class Pool
+{
+public:
+    explicit Pool(uint32 threads = ThreadCount());
+    ~Pool();
+
+    template <typename Fn> auto Submit(Fn &&fn) -> std::future<decltype(fn())>
+    {
+        using Result = decltype(fn());
+        auto task    = std::make_shared<std::packaged_task<Result()>>(std::forward<Fn>(fn));
+        auto future  = task->get_future();
+        enqueue([task]() { (*task)(); });
+        return future;
+    }
+    // blocks until every submitted task has finished
+    void Wait();
+    uint32 Size() const { return uint32(workers.size()); }
+
+private:
+    void enqueue(std::function<void()> task);
+    void run();
+
+private:
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    std::deque<std::function<void()>> tasks;
+    std::vector<std::thread> workers;
+    uint32 busy;
+    bool stopping;
+};
+}; // namespace Parallel
@@ -46,6 +46,21 @@ private:
     double now   = 0;
     double ticks = 0;
 };
+
+// high resolution wall clock for timing one off work
+struct Stopwatch
+{
+public:
+    inline Stopwatch() : start(SDL_GetPerformanceCounter()) {}
+    inline void Restart() { start = SDL_GetPerformanceCounter(); }
+    inline double ElapsedMilliseconds() const
+    {
+        return double(SDL_GetPerformanceCounter() - start) * 1000.0 / double(SDL_GetPerformanceFrequency());
+    }
+
+private:
+    Uint64 start;
+};
 }; // namespace sdl
 
 class UI;
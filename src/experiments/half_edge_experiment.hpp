@@ -153,7 +153,7 @@ public:
         // {
         //     g.Line(line.From, line.To, ORANGE);
         // };
-        // selection.DrawLine(eachEdgeOfSelectedFace, camPos);
+        // selection.DrawLine(*editableMesh, eachEdgeOfSelectedFace, camPos);
     }
 
     void Render(const Camera &camera) override
@@ -176,7 +176,7 @@ public:
         //     // editableMesh->Extrude(hit.Face, 0.5f);
         //     selection.Clear();
         //     editableMesh->DeleteFace(hit.Face);
-        //     mesh = editableMesh->GenerateMesh(false);
+        //     editableMesh->UpdateMesh(mesh, false);
         // }
 
         // if (debug)
@@ -0,0 +1,267 @@
+#include "bvh.hpp"
+#include <algorithm>
+#include <numeric>
+
+namespace
+{
+constexpr float Miss = std::numeric_limits<float>::infinity();
+} // namespace
+
+void BVH::AABB::Grow(const Vec3 &p)
+{
+    Min = glm::min(Min, p);
+    Max = glm::max(Max, p);
+}
+
+void BVH::AABB::Grow(const AABB &other)
+{
+    Min = glm::min(Min, other.Min);
+    Max = glm::max(Max, other.Max);
+}
+
+float BVH::AABB::Area() const
+{
+    auto e = Max - Min;
+    if (e.x < 0) return 0;
+    return 2.0f * (e.x * e.y + e.y * e.z + e.z * e.x);
+}
+
+void BVH::Build(const std::vector<Vec3> &positions, std::vector<uint32> triangleIndices)
+{
+    Clear();
+    indices            = std::move(triangleIndices);
+    const uint32 count = TriangleCount();
+    if (count == 0) return;
+
+    std::vector<Vec3> centroids(count);
+    std::vector<AABB> triangleBounds(count);
+    for (uint32 t = 0; t < count; ++t)
+    {
+        const auto &a = positions[indices[t * 3 + 0]];
+        const auto &b = positions[indices[t * 3 + 1]];
+        const auto &c = positions[indices[t * 3 + 2]];
+        centroids[t]  = (a + b + c) / 3.0f;
+        triangleBounds[t].Grow(a);
+        triangleBounds[t].Grow(b);
+        triangleBounds[t].Grow(c);
+    }
+
+    std::vector<uint32> order(count);
+    std::iota(order.begin(), order.end(), 0);
+
+    // levels of median splits until every leaf fits one packet
+    auto medianDepth = [](uint32 count)
+    {
+        uint32 levels = 0;
+        while ((uint64(MaxLeafSize) << levels) < count) ++levels;
+        return levels;
+    };
+
+    nodes.reserve(size_t(count) * 2);
+    nodes.push_back({AABB(), 0, count});
+    std::vector<std::pair<uint32, uint32>> stack = {{0, 0}};
+    while (!stack.empty())
+    {
+        const auto [n, level] = stack.back();
+        const Node node       = nodes[n];
+        stack.pop_back();
+        depth = std::max(depth, level);
+        if (node.Count <= MaxLeafSize) continue;
+
+        // leaves are exactly one packet, everything bigger is split
+        uint32 axis;
+        float position;
+        split(node, order, centroids, triangleBounds, axis, position);
+
+        auto begin = order.begin() + node.First;
+        auto end   = begin + node.Count;
+        auto mid   = std::partition(begin, end, [&](uint32 t) { return centroids[t][axis] < position; });
+
+        // all centroids on one side of the plane, or lopsided SAH splits would outgrow MaxDepth,
+        // fall back to median split which halves the count every level
+        if (mid == begin || mid == end || level + medianDepth(node.Count) >= MaxDepth)
+        {
+            mid = begin + node.Count / 2;
+            std::nth_element(
+                begin,
+                mid,
+                end,
+                [&](uint32 a, uint32 b) { return centroids[a][axis] < centroids[b][axis]; }
+            );
+        }
+
+        const uint32 leftCount = uint32(mid - begin);
+        const uint32 left      = uint32(nodes.size());
+        nodes.push_back({AABB(), node.First, leftCount});
+        nodes.push_back({AABB(), node.First + leftCount, node.Count - leftCount});
+        nodes[n].First = left;
+        nodes[n].Count = 0;
+        stack.emplace_back(left, level + 1);
+        stack.emplace_back(left + 1, level + 1);
+    }
+
+    for (auto &node : nodes)
+    {
+        if (node.Count == 0) continue;
+
+        const uint32 packet = uint32(packetTriangles.size() / MaxLeafSize);
+        packetTriangles.resize(packetTriangles.size() + MaxLeafSize, InvalidTriangle);
+        std::copy_n(order.begin() + node.First, node.Count, packetTriangles.begin() + packet * MaxLeafSize);
+        node.First = packet;
+    }
+    packets.resize(packetTriangles.size() / MaxLeafSize);
+
+    Refit(positions);
+}
+
+void BVH::Refit(const std::vector<Vec3> &positions)
+{
+    // children are always stored after their parent
+    for (size_t n = nodes.size(); n-- > 0;)
+    {
+        auto &node = nodes[n];
+        if (node.Count == 0)
+        {
+            node.Bounds = nodes[node.First].Bounds;
+            node.Bounds.Grow(nodes[node.First + 1].Bounds);
+            continue;
+        }
+
+        auto &packet = packets[node.First];
+        node.Bounds  = AABB();
+        for (uint32 lane = 0; lane < node.Count; ++lane)
+        {
+            const auto *triangle = Triangle(packetTriangles[node.First * MaxLeafSize + lane]);
+            const auto &a        = positions[triangle[0]];
+            const auto &b        = positions[triangle[1]];
+            const auto &c        = positions[triangle[2]];
+            packet.Set(lane, a, b, c);
+            node.Bounds.Grow(a);
+            node.Bounds.Grow(b);
+            node.Bounds.Grow(c);
+        }
+    }
+}
+
+void BVH::Clear()
+{
+    nodes.clear();
+    indices.clear();
+    packets.clear();
+    packetTriangles.clear();
+    depth = 0;
+}
+
+BVH::Hit BVH::Raycast(const Ray &ray, float maxDistance) const
+{
+    Hit hit;
+    hit.Distance = maxDistance;
+    if (IsEmpty()) return hit;
+
+    const Vec3 invDirection = Vec3(1.0f / ray.Direction.x, 1.0f / ray.Direction.y, 1.0f / ray.Direction.z);
+    if (intersect(nodes[0].Bounds, ray, invDirection, hit.Distance) == Miss) return hit;
+
+    // one pending sibling per level above the current node plus both children of the deepest inner one
+    uint32 stack[MaxDepth + 1];
+    uint32 size   = 0;
+    stack[size++] = 0;
+    while (size > 0)
+    {
+        const auto &node = nodes[stack[--size]];
+        if (node.Count > 0)
+        {
+            auto lane = Mathf::RayTrianglesIntersection(ray, packets[node.First], hit.Distance, hit.Barycentric);
+            if (lane >= 0) hit.Triangle = packetTriangles[node.First * MaxLeafSize + lane];
+            continue;
+        }
+
+        // visit nearer child first so the farther one is likely culled by the hit distance
+        uint32 nearChild = node.First;
+        uint32 farChild  = node.First + 1;
+        float nearT      = intersect(nodes[nearChild].Bounds, ray, invDirection, hit.Distance);
+        float farT       = intersect(nodes[farChild].Bounds, ray, invDirection, hit.Distance);
+        if (farT < nearT)
+        {
+            std::swap(nearChild, farChild);
+            std::swap(nearT, farT);
+        }
+        if (farT != Miss) stack[size++] = farChild;
+        if (nearT != Miss) stack[size++] = nearChild;
+    }
+
+    return hit;
+}
+
+void BVH::split(
+    const Node &node,
+    const std::vector<uint32> &order,
+    const std::vector<Vec3> &centroids,
+    const std::vector<AABB> &triangleBounds,
+    uint32 &axis,
+    float &position
+) const
+{
+    AABB centroidBounds;
+    for (uint32 i = node.First; i < node.First + node.Count; ++i) centroidBounds.Grow(centroids[order[i]]);
+
+    // degenerate centroid bounds end up as a median split in Build
+    axis              = 0;
+    position          = centroidBounds.Min.x;
+    float bestCost    = std::numeric_limits<float>::max();
+    const auto extent = centroidBounds.Max - centroidBounds.Min;
+    for (uint32 a = 0; a < 3; ++a)
+    {
+        if (extent[a] <= 0) continue;
+
+        AABB binBounds[Bins];
+        uint32 binCounts[Bins] = {};
+        const float scale      = Bins / extent[a];
+        for (uint32 i = node.First; i < node.First + node.Count; ++i)
+        {
+            auto t = order[i];
+            auto b = std::min(Bins - 1, uint32((centroids[t][a] - centroidBounds.Min[a]) * scale));
+            binCounts[b]++;
+            binBounds[b].Grow(triangleBounds[t]);
+        }
+
+        // sweep from both sides, plane i separates bins [0, i) and [i, Bins)
+        float leftArea[Bins - 1], rightArea[Bins - 1];
+        uint32 leftCount[Bins - 1], rightCount[Bins - 1];
+        AABB left, right;
+        uint32 leftSum = 0, rightSum = 0;
+        for (uint32 i = 0; i < Bins - 1; ++i)
+        {
+            left.Grow(binBounds[i]);
+            leftSum += binCounts[i];
+            leftArea[i]  = left.Area();
+            leftCount[i] = leftSum;
+
+            right.Grow(binBounds[Bins - 1 - i]);
+            rightSum += binCounts[Bins - 1 - i];
+            rightArea[Bins - 2 - i]  = right.Area();
+            rightCount[Bins - 2 - i] = rightSum;
+        }
+
+        for (uint32 i = 0; i < Bins - 1; ++i)
+        {
+            float cost = leftCount[i] * leftArea[i] + rightCount[i] * rightArea[i];
+            if (cost < bestCost)
+            {
+                bestCost = cost;
+                axis     = a;
+                position = centroidBounds.Min[a] + extent[a] * float(i + 1) / Bins;
+            }
+        }
+    }
+}
+
+float BVH::intersect(const AABB &bounds, const Ray &ray, const Vec3 &invDirection, float maxDistance)
+{
+    auto t0    = (bounds.Min - ray.Origin) * invDirection;
+    auto t1    = (bounds.Max - ray.Origin) * invDirection;
+    auto near  = glm::min(t0, t1);
+    auto far   = glm::max(t0, t1);
+    float tMin = std::max(std::max(near.x, near.y), std::max(near.z, 0.0f));
+    float tMax = std::min(std::min(far.x, far.y), std::min(far.z, maxDistance));
+    return tMin <= tMax ? tMin : Miss;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "../core/all.hpp"
+#include <limits>
+
+// Bounding volume hierarchy over a triangle list, built with binned SAH.
+// Nodes live in one array, children of an inner node are adjacent and always stored after their parent
+// so refit is a single reverse pass. Every leaf holds one Mathf::TrianglePacket tested with a single SIMD call.
+class BVH
+{
+public:
+    static constexpr uint32 InvalidTriangle = std::numeric_limits<uint32>::max();
+    // build switches to median splits before leaves get deeper, traversal stack is sized for it
+    static constexpr uint32 MaxDepth = 63;
+
+    struct Hit
+    {
+        uint32 Triangle = InvalidTriangle;
+        float Distance  = std::numeric_limits<float>::max();
+        Vec2 Barycentric; // weights of second and third corner
+
+        bool Valid() const { return Triangle != InvalidTriangle; }
+    };
+
+public:
+    // indices hold 3 entries per triangle, triangle ids in hits are positions in this list
+    void Build(const std::vector<Vec3> &positions, std::vector<uint32> indices);
+    // positions moved but triangles stay the same, bounds are recomputed without changing the tree
+    void Refit(const std::vector<Vec3> &positions);
+    void Clear();
+    Hit Raycast(const Ray &ray, float maxDistance = std::numeric_limits<float>::max()) const;
+
+    bool IsEmpty() const { return nodes.empty(); }
+    // levels below the root of the deepest leaf
+    uint32 Depth() const { return depth; }
+    uint32 TriangleCount() const { return uint32(indices.size() / 3); }
+    const uint32 *Triangle(uint32 t) const { return &indices[size_t(t) * 3]; }
+
+private:
+    struct AABB
+    {
+        Vec3 Min = Vec3(std::numeric_limits<float>::max());
+        Vec3 Max = Vec3(std::numeric_limits<float>::lowest());
+
+        void Grow(const Vec3 &p);
+        void Grow(const AABB &other);
+        float Area() const;
+    };
+
+    // leaf when Count > 0: packet First with Count lanes used, otherwise children First and First + 1
+    struct Node
+    {
+        AABB Bounds;
+        uint32 First;
+        uint32 Count;
+    };
+
+    static constexpr uint32 MaxLeafSize = Mathf::TrianglePacket::Lanes;
+    static constexpr uint32 Bins        = 16;
+
+    // best SAH plane over binned centroids
+    void split(
+        const Node &node,
+        const std::vector<uint32> &order,
+        const std::vector<Vec3> &centroids,
+        const std::vector<AABB> &triangleBounds,
+        uint32 &axis,
+        float &position
+    ) const;
+    static float intersect(const AABB &bounds, const Ray &ray, const Vec3 &invDirection, float maxDistance);
+
+private:
+    std::vector<Node> nodes;
+    std::vector<uint32> indices;
+    std::vector<Mathf::TrianglePacket> packets;
+    std::vector<uint32> packetTriangles; // MaxLeafSize per packet, triangle of every lane
+    uint32 depth = 0;
+};
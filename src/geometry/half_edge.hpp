@@ -2,56 +2,29 @@
 
 #include "../core/all.hpp"
 #include "mesh.hpp"
-#include <functional>
-#include <memory>
+#include <limits>
 
-class HalfEdge
+namespace HalfEdge
 {
-public:
-    using Ptr = std::shared_ptr<HalfEdge>;
-    using Ref = std::weak_ptr<HalfEdge>;
+using Index = uint32;
 
-    struct Vertex
-    {
-        using Ptr = std::shared_ptr<Vertex>;
-        using Ref = std::weak_ptr<Vertex>;
-        static Ptr New() { return std::make_shared<Vertex>(); }
-        static Ptr New(const Vec3 &v) { return std::make_shared<Vertex>(v); }
-        Vertex() { IncidentEdge.reset(); }
-        Vertex(const Vec3 &v) : P(v) { IncidentEdge.reset(); }
-        ~Vertex();
+inline constexpr Index Invalid = std::numeric_limits<Index>::max();
 
-        Vec3 P;
-        HalfEdge::Ref IncidentEdge;
-    };
-
-    struct Face
-    {
-        using Ptr = std::shared_ptr<Face>;
-        using Ref = std::weak_ptr<Face>;
-        static Ptr New() { return std::make_shared<Face>(); }
-        Face() { Edge.reset(); }
-        ~Face();
-
-        HalfEdge::Ref Edge;
+// 32-bit index into one of HalfEdgeMesh arrays, tagged so vertex/edge/face handles cannot be mixed up
+template <typename Tag> struct Handle
+{
+    Index Value = Invalid;
 
-        Vec3 Center() const;
-        Vec3 Normal() const;
-        inline bool IsTriangle() const;          // 3
-        inline bool IsQuad() const;              // 4
-        inline bool IsPolygon(int n = -1) const; // >= 5
-        void EachTriangle(std::function<void(const Vertex::Ptr &a, const Vertex::Ptr &b, const Vertex::Ptr &c)> fn);
-    };
+    constexpr Handle() = default;
+    constexpr explicit Handle(Index value) : Value(value) {}
 
-public:
-    static Ptr New() { return std::make_shared<HalfEdge>(); }
-    HalfEdge();
-    ~HalfEdge();
+    constexpr bool IsValid() const { return Value != Invalid; }
+    constexpr bool operator==(const Handle &other) const { return Value == other.Value; }
+    constexpr bool operator!=(const Handle &other) const { return Value != other.Value; }
+    constexpr bool operator<(const Handle &other) const { return Value < other.Value; }
+};
 
-public:
-    Vertex::Ref Origin;
-    Ref Twin;
-    Face::Ref IncidentFace;
-    Ref Prev;
-    Ref Next;
-};
\ No newline at end of file
+using Vertex = Handle<struct VertexTag>;
+using Edge   = Handle<struct EdgeTag>;
+using Face   = Handle<struct FaceTag>;
+} // namespace HalfEdge
@@ -1,496 +1,731 @@
 #include "half_edge_mesh.hpp"
 #include <algorithm>
-#include <map>
+#include <atomic>
 
-HalfEdgeMesh::Ptr HalfEdgeMesh::NewPlane()
+using HalfEdge::Index;
+using HalfEdge::Invalid;
+
+namespace
 {
-    using Vertex = HalfEdge::Vertex;
-    using Face   = HalfEdge::Face;
-
-    HalfEdge::Ptr e[8];
-    Face::Ptr f[1];
-    Vertex::Ptr v[4];
-
-    v[0] = Vertex::New({0, 0, 1});
-    v[1] = Vertex::New({1, 0, 1});
-    v[2] = Vertex::New({1, 0, 0});
-    v[3] = Vertex::New({0, 0, 0});
-
-    for (int i = 0; i < 1; ++i) f[i] = Face::New();
-
-    for (int i = 0; i < 8; ++i) e[i] = HalfEdge::New();
-
-    // https://jerryyin.info/geometry-processing-algorithms/half-edge/
-    // Half-edge	Origin	Twin	Incident face	Next	Prev
-    // e0	v0	e6	f0	e1	e2
-    // e1	v2	e7	f0	e2	e0
-    // e2	v3	e3	f0	e0	e1
-    // e3	v0	e2	f1	e4	e5
-    // e4	v3	e8	f1	e5	e3
-    // e5	v1	e9	f1	e3	e4
-    // e6	v2	e0	∅	e9	e7
-    // e7	v3	e1	∅	e6	e8
-    // e8	v1	e4	∅	e7	e9
-    // e9	v0	e5	∅	e8	e6
-
-    // Vertex	Coordinate	Incident edge
-    // v1	(0, 1, 0)	e0
-    // v2	(1, 1, 0)	e5
-    // v3	(0, 0, 0)	e1
-    // v4	(1, 0, 0)	e2
-
-    f[0]->Edge = e[0];
-
-    v[0]->IncidentEdge = e[0];
-    v[1]->IncidentEdge = e[1];
-    v[2]->IncidentEdge = e[2];
-    v[3]->IncidentEdge = e[3];
-
-    e[0]->Origin       = v[0];
-    e[0]->IncidentFace = f[0];
-    e[0]->Next         = e[1];
-    e[0]->Prev         = e[3];
-
-    e[1]->Origin       = v[1];
-    e[1]->IncidentFace = f[0];
-    e[1]->Next         = e[2];
-    e[1]->Prev         = e[0];
-
-    e[2]->Origin       = v[2];
-    e[2]->IncidentFace = f[0];
-    e[2]->Next         = e[3];
-    e[2]->Prev         = e[1];
-
-    e[3]->Origin       = v[3];
-    e[3]->IncidentFace = f[0];
-    e[3]->Next         = e[0];
-    e[3]->Prev         = e[2];
-
-    e[4]->Origin = v[0];
-    e[4]->IncidentFace.reset();
-    e[4]->Next = e[5];
-    e[4]->Prev = e[7];
-
-    e[5]->Origin = v[3];
-    e[5]->IncidentFace.reset();
-    e[5]->Next = e[6];
-    e[5]->Prev = e[4];
-
-    e[6]->Origin = v[2];
-    e[6]->IncidentFace.reset();
-    e[6]->Next = e[7];
-    e[6]->Prev = e[5];
-
-    e[7]->Origin = v[1];
-    e[6]->IncidentFace.reset();
-    e[7]->Next = e[4];
-    e[7]->Prev = e[6];
+Index remapped(const std::vector<Index> &remap, Index i) { return i == Invalid ? Invalid : remap[i]; }
 
-    auto mesh = std::make_shared<HalfEdgeMesh>();
-    for (int i = 0; i < 4; ++i) mesh->Vertices.emplace_back(v[i]);
+// builds old -> new index table, deleted elements map to Invalid
+std::vector<Index> buildRemap(const std::vector<bool> &deleted)
+{
+    std::vector<Index> remap(deleted.size(), Invalid);
+    Index next = 0;
+    for (size_t i = 0; i < deleted.size(); ++i)
+        if (!deleted[i]) remap[i] = next++;
 
-    for (int i = 0; i < 1; ++i) mesh->Faces.emplace_back(f[i]);
+    return remap;
+}
 
-    for (int i = 0; i < 8; ++i) mesh->Edges.emplace_back(e[i]);
+// remap[i] <= i so live elements can be moved forward in place
+template <typename T> void compactArray(std::vector<T> &values, const std::vector<Index> &remap)
+{
+    size_t count = 0;
+    for (size_t i = 0; i < values.size(); ++i)
+    {
+        if (remap[i] == Invalid) continue;
+        values[remap[i]] = values[i];
+        ++count;
+    }
+    values.resize(count);
+}
 
-    mesh->generateMissingTwins();
+const std::vector<Vec4> faceColors = {
+    Vec4(0.0f, 0.0f, 0.0f, 1.0f),    Vec4(1.0f, 0.0f, 0.0f, 1.0f),    Vec4(0.0f, 1.0f, 0.0f, 1.0f),
+    Vec4(0.0f, 0.0f, 1.0f, 1.0f),    Vec4(1.0f, 1.0f, 0.0f, 1.0f),    Vec4(1.0f, 0.0f, 1.0f, 1.0f),
+    Vec4(0.0f, 1.0f, 1.0f, 1.0f),    Vec4(1.0f, 1.0f, 1.0f, 1.0f),    Vec4(0.5f, 0.0f, 0.0f, 1.0f),
+    Vec4(0.0f, 0.5f, 0.0f, 1.0f),    Vec4(0.0f, 0.0f, 0.5f, 1.0f),    Vec4(0.5f, 0.5f, 0.0f, 1.0f),
+    Vec4(0.5f, 0.0f, 0.5f, 1.0f),    Vec4(0.0f, 0.5f, 0.5f, 1.0f),    Vec4(0.5f, 0.5f, 0.5f, 1.0f),
+    Vec4(0.25f, 0.0f, 0.0f, 1.0f),   Vec4(0.0f, 0.25f, 0.0f, 1.0f),   Vec4(0.0f, 0.0f, 0.25f, 1.0f),
+    Vec4(0.25f, 0.25f, 0.0f, 1.0f),  Vec4(0.25f, 0.0f, 0.25f, 1.0f),  Vec4(0.0f, 0.25f, 0.25f, 1.0f),
+    Vec4(0.25f, 0.25f, 0.25f, 1.0f), Vec4(0.75f, 0.0f, 0.0f, 1.0f),   Vec4(0.0f, 0.75f, 0.0f, 1.0f),
+    Vec4(0.0f, 0.0f, 0.75f, 1.0f),   Vec4(0.75f, 0.75f, 0.0f, 1.0f),  Vec4(0.75f, 0.0f, 0.75f, 1.0f),
+    Vec4(0.0f, 0.75f, 0.75f, 1.0f),  Vec4(0.75f, 0.75f, 0.75f, 1.0f), Vec4(0.25f, 0.0f, 0.0f, 1.0f),
+    Vec4(0.0f, 0.25f, 0.0f, 1.0f),   Vec4(0.0f, 0.0f, 0.25f, 1.0f),   Vec4(0.25f, 0.25f, 0.0f, 1.0f),
+    Vec4(0.25f, 0.0f, 0.25f, 1.0f),  Vec4(0.0f, 0.25f, 0.25f, 1.0f),  Vec4(0.25f, 0.25f, 0.25f, 1.0f),
+};
+
+Vec3 faceColor(Index f) { return Vec3(faceColors[f % faceColors.size()]); }
+
+// element runs [begin, end) sorted by begin to byte ranges, touching runs are merged
+void appendRanges(
+    const std::vector<std::pair<Index, Index>> &runs,
+    size_t elementSize,
+    std::vector<HalfEdgeMesh::MeshUpdate::Range> &ranges
+)
+{
+    for (const auto &[begin, end] : runs)
+    {
+        size_t offset = size_t(begin) * elementSize;
+        size_t size   = size_t(end - begin) * elementSize;
+        if (!ranges.empty() && ranges.back().Offset + ranges.back().Size == offset)
+            ranges.back().Size += size;
+        else
+            ranges.push_back({offset, size});
+    }
+}
+
+uint64 edgeKey(Index origin, Index destination) { return (uint64(origin) << 32) | destination; }
+
+// Open addressing (linear probing) table of directed edges keyed by packed (origin, destination) pair.
+// Sized once up front so inserting never rehashes, slots are claimed with CAS so edges can be inserted
+// from several threads. Lookups must not overlap with inserts.
+class EdgeTable
+{
+public:
+    explicit EdgeTable(uint32 count)
+    {
+        uint32 capacity = 16;
+        while (capacity < count * 2) capacity <<= 1;
+        mask   = capacity - 1;
+        keys   = std::make_unique<std::atomic<uint64>[]>(capacity);
+        values = std::make_unique<Index[]>(capacity);
+        for (uint32 i = 0; i < capacity; ++i) keys[i].store(Empty, std::memory_order_relaxed);
+    }
+
+    // false when the key is already stored, the edge is not inserted then
+    bool Insert(uint64 key, Index edge)
+    {
+        for (auto i = slot(key);; i = (i + 1) & mask)
+        {
+            auto current = keys[i].load(std::memory_order_relaxed);
+            if (current == Empty && keys[i].compare_exchange_strong(current, key, std::memory_order_relaxed))
+            {
+                values[i] = edge;
+                return true;
+            }
+            if (current == key) return false;
+        }
+    }
+
+    Index Find(uint64 key) const
+    {
+        for (auto i = slot(key);; i = (i + 1) & mask)
+        {
+            auto current = keys[i].load(std::memory_order_relaxed);
+            if (current == key) return values[i];
+            if (current == Empty) return Invalid;
+        }
+    }
+
+private:
+    // both indices Invalid, never a real edge
+    static constexpr uint64 Empty = ~uint64(0);
+
+    uint32 slot(uint64 key) const { return uint32((key * 0x9E3779B97F4A7C15ull) >> 32) & mask; }
+
+private:
+    std::unique_ptr<std::atomic<uint64>[]> keys;
+    std::unique_ptr<Index[]> values;
+    uint32 mask;
+};
+} // namespace
+
+HalfEdgeMesh::Ptr HalfEdgeMesh::NewPlane()
+{
+    auto mesh = std::make_shared<HalfEdgeMesh>();
+
+    Vertex v[4];
+    v[0] = mesh->AddVertex({0, 0, 1});
+    v[1] = mesh->AddVertex({1, 0, 1});
+    v[2] = mesh->AddVertex({1, 0, 0});
+    v[3] = mesh->AddVertex({0, 0, 0});
+
+    mesh->AddFace({v[0], v[1], v[2], v[3]});
 
     return mesh;
 }
 
 HalfEdgeMesh::Ptr HalfEdgeMesh::NewCube()
 {
-    using Vertex = HalfEdge::Vertex;
-    using Face   = HalfEdge::Face;
-
-    HalfEdge::Ptr e[24]; // 24 half-edges for a cube
-    Face::Ptr f[6];      // 6 faces for a cube
-    Vertex::Ptr v[8];    // 8 vertices for a cube
+    auto mesh = std::make_shared<HalfEdgeMesh>();
 
     // Define 8 vertices (positions for a unit cube)
-    v[0] = Vertex::New({0, 0, 1});
-    v[1] = Vertex::New({1, 0, 1});
-    v[2] = Vertex::New({1, 1, 1});
-    v[3] = Vertex::New({0, 1, 1});
-    v[4] = Vertex::New({0, 0, 0});
-    v[5] = Vertex::New({1, 0, 0});
-    v[6] = Vertex::New({1, 1, 0});
-    v[7] = Vertex::New({0, 1, 0});
-
-    // Create 6 faces
-    for (int i = 0; i < 6; ++i) f[i] = Face::New();
-
-    // Create 24 half-edges
-    for (int i = 0; i < 24; ++i) e[i] = HalfEdge::New();
-
-    // Front face (f0)
-    f[0]->Edge         = e[0];
-    e[0]->IncidentFace = f[0];
-    e[1]->IncidentFace = f[0];
-    e[2]->IncidentFace = f[0];
-    e[3]->IncidentFace = f[0];
-    e[0]->Origin       = v[0];
-    e[1]->Origin       = v[1];
-    e[2]->Origin       = v[2];
-    e[3]->Origin       = v[3];
-    e[0]->Next         = e[1];
-    e[1]->Next         = e[2];
-    e[2]->Next         = e[3];
-    e[3]->Next         = e[0];
-    e[0]->Prev         = e[3];
-    e[1]->Prev         = e[0];
-    e[2]->Prev         = e[1];
-    e[3]->Prev         = e[2];
-
-    // left face (f1)
-    f[1]->Edge         = e[4];
-    e[4]->IncidentFace = f[1];
-    e[5]->IncidentFace = f[1];
-    e[6]->IncidentFace = f[1];
-    e[7]->IncidentFace = f[1];
-    e[4]->Origin       = v[0];
-    e[5]->Origin       = v[3];
-    e[6]->Origin       = v[7];
-    e[7]->Origin       = v[4];
-    e[4]->Next         = e[5];
-    e[5]->Next         = e[6];
-    e[6]->Next         = e[7];
-    e[7]->Next         = e[4];
-    e[4]->Prev         = e[7];
-    e[5]->Prev         = e[4];
-    e[6]->Prev         = e[5];
-    e[7]->Prev         = e[6];
-
-    // right face (f2)
-    f[2]->Edge          = e[8];
-    e[8]->IncidentFace  = f[2];
-    e[9]->IncidentFace  = f[2];
-    e[10]->IncidentFace = f[2];
-    e[11]->IncidentFace = f[2];
-    e[8]->Origin        = v[1];
-    e[9]->Origin        = v[5];
-    e[10]->Origin       = v[6];
-    e[11]->Origin       = v[2];
-    e[8]->Next          = e[9];
-    e[9]->Next          = e[10];
-    e[10]->Next         = e[11];
-    e[11]->Next         = e[8];
-    e[8]->Prev          = e[11];
-    e[9]->Prev          = e[8];
-    e[10]->Prev         = e[9];
-    e[11]->Prev         = e[10];
-
-    // back face (f3)
-    f[3]->Edge          = e[12];
-    e[12]->IncidentFace = f[3];
-    e[13]->IncidentFace = f[3];
-    e[14]->IncidentFace = f[3];
-    e[15]->IncidentFace = f[3];
-    e[12]->Origin       = v[5];
-    e[13]->Origin       = v[4];
-    e[14]->Origin       = v[7];
-    e[15]->Origin       = v[6];
-    e[12]->Next         = e[13];
-    e[13]->Next         = e[14];
-    e[14]->Next         = e[15];
-    e[15]->Next         = e[12];
-    e[12]->Prev         = e[15];
-    e[13]->Prev         = e[12];
-    e[14]->Prev         = e[13];
-    e[15]->Prev         = e[14];
-
-    // top face (f4)
-    f[4]->Edge          = e[16];
-    e[16]->IncidentFace = f[4];
-    e[17]->IncidentFace = f[4];
-    e[18]->IncidentFace = f[4];
-    e[19]->IncidentFace = f[4];
-    e[16]->Origin       = v[3];
-    e[17]->Origin       = v[2];
-    e[18]->Origin       = v[6];
-    e[19]->Origin       = v[7];
-    e[16]->Next         = e[17];
-    e[17]->Next         = e[18];
-    e[18]->Next         = e[19];
-    e[19]->Next         = e[16];
-    e[16]->Prev         = e[19];
-    e[17]->Prev         = e[16];
-    e[18]->Prev         = e[17];
-    e[19]->Prev         = e[18];
-
-    // bottom face (f5)
-    f[5]->Edge          = e[20];
-    e[20]->IncidentFace = f[5];
-    e[21]->IncidentFace = f[5];
-    e[22]->IncidentFace = f[5];
-    e[23]->IncidentFace = f[5];
-    e[20]->Origin       = v[0];
-    e[21]->Origin       = v[4];
-    e[22]->Origin       = v[5];
-    e[23]->Origin       = v[1];
-    e[20]->Next         = e[21];
-    e[21]->Next         = e[22];
-    e[22]->Next         = e[23];
-    e[23]->Next         = e[20];
-    e[20]->Prev         = e[23];
-    e[21]->Prev         = e[20];
-    e[22]->Prev         = e[21];
-    e[23]->Prev         = e[22];
-
-    // Set the incident edges for vertices
-    v[0]->IncidentEdge = e[0];
-    v[1]->IncidentEdge = e[1];
-    v[2]->IncidentEdge = e[2];
-    v[3]->IncidentEdge = e[3];
-    v[4]->IncidentEdge = e[12];
-    v[5]->IncidentEdge = e[13];
-    v[6]->IncidentEdge = e[14];
-    v[7]->IncidentEdge = e[15];
-
-    // Create the mesh
-    auto mesh = std::make_shared<HalfEdgeMesh>();
-    for (int i = 0; i < 8; ++i) mesh->Vertices.emplace_back(v[i]);
+    Vertex v[8];
+    v[0] = mesh->AddVertex({0, 0, 1});
+    v[1] = mesh->AddVertex({1, 0, 1});
+    v[2] = mesh->AddVertex({1, 1, 1});
+    v[3] = mesh->AddVertex({0, 1, 1});
+    v[4] = mesh->AddVertex({0, 0, 0});
+    v[5] = mesh->AddVertex({1, 0, 0});
+    v[6] = mesh->AddVertex({1, 1, 0});
+    v[7] = mesh->AddVertex({0, 1, 0});
+
+    mesh->AddFace({v[0], v[1], v[2], v[3]}); // front
+    mesh->AddFace({v[0], v[3], v[7], v[4]}); // left
+    mesh->AddFace({v[1], v[5], v[6], v[2]}); // right
+    mesh->AddFace({v[5], v[4], v[7], v[6]}); // back
+    mesh->AddFace({v[3], v[2], v[6], v[7]}); // top
+    mesh->AddFace({v[0], v[4], v[5], v[1]}); // bottom
 
-    for (int i = 0; i < 6; ++i) mesh->Faces.emplace_back(f[i]);
+    return mesh;
+}
 
-    for (int i = 0; i < 24; ++i) mesh->Edges.emplace_back(e[i]);
+HalfEdgeMesh::Ptr HalfEdgeMesh::FromIndexed(
+    const std::vector<Vec3> &positions,
+    const std::vector<uint32> &indices,
+    const std::vector<uint32> &faceSizes
+)
+{
+    // exclusive prefix sum gives first half-edge of every face
+    const uint32 faceCount = faceSizes.size();
+    std::vector<Index> faceOffsets(faceCount);
+    uint64 edgeCount = 0;
+    for (uint32 f = 0; f < faceCount; ++f)
+    {
+        if (faceSizes[f] < 3)
+        {
+            fmtx::Error(fmt::format("Face {} has {} vertices, at least 3 are required", f, faceSizes[f]));
+            return nullptr;
+        }
+        faceOffsets[f] = edgeCount;
+        edgeCount += faceSizes[f];
+    }
+
+    if (edgeCount != indices.size())
+    {
+        fmtx::Error(fmt::format("Face sizes add up to {} indices, got {}", edgeCount, indices.size()));
+        return nullptr;
+    }
+    // boundary can at most double the half-edges
+    if (edgeCount * 2 >= Invalid || positions.size() >= Invalid)
+    {
+        fmtx::Error("Mesh is too large for 32-bit half-edge handles");
+        return nullptr;
+    }
+    for (auto index : indices)
+    {
+        if (index >= positions.size())
+        {
+            fmtx::Error(fmt::format("Vertex index {} out of range, mesh has {} positions", index, positions.size()));
+            return nullptr;
+        }
+    }
+
+    auto mesh = std::make_shared<HalfEdgeMesh>();
+    mesh->Vertices.P = positions;
+    mesh->Vertices.IncidentEdge.assign(positions.size(), Invalid);
+    mesh->Vertices.Deleted.assign(positions.size(), false);
+    mesh->Edges.Origin.resize(edgeCount);
+    mesh->Edges.Twin.resize(edgeCount);
+    mesh->Edges.IncidentFace.resize(edgeCount);
+    mesh->Edges.Prev.resize(edgeCount);
+    mesh->Edges.Next.resize(edgeCount);
+    mesh->Edges.Deleted.assign(edgeCount, false);
+    mesh->Faces.Edge.resize(faceCount);
+    mesh->Faces.Deleted.assign(faceCount, false);
+
+    auto &edges = mesh->Edges;
+    Parallel::For(
+        faceCount,
+        [&](uint32 begin, uint32 end)
+        {
+            for (Index f = begin; f < end; ++f)
+            {
+                const Index first = faceOffsets[f];
+                const Index size  = faceSizes[f];
+                mesh->Faces.Edge[f] = first;
+                for (Index i = 0; i < size; ++i)
+                {
+                    const Index e         = first + i;
+                    edges.Origin[e]       = indices[e];
+                    edges.Twin[e]         = Invalid;
+                    edges.IncidentFace[e] = f;
+                    edges.Next[e]         = first + (i + 1) % size;
+                    edges.Prev[e]         = first + (i + size - 1) % size;
+                }
+            }
+        }
+    );
+
+    // lowest outgoing edge of every vertex, boundary vertices are switched to boundary edges with twins
+    for (Index e = edgeCount; e-- > 0;) mesh->Vertices.IncidentEdge[edges.Origin[e]] = e;
 
     mesh->generateMissingTwins();
 
     return mesh;
 }
 
-HalfEdgeMesh::~HalfEdgeMesh()
+HalfEdgeMesh::Vertex HalfEdgeMesh::AddVertex(const Vec3 &p)
 {
-    fmt::println("HalfEdgeMesh deleted");
-    Faces.clear();
-    Vertices.clear();
-    Edges.clear();
+    if (!Vertices.Free.empty())
+    {
+        auto v = Vertices.Free.back();
+        Vertices.Free.pop_back();
+        Vertices.P[v]            = p;
+        Vertices.IncidentEdge[v] = Invalid;
+        Vertices.Deleted[v]      = false;
+        markVertexDirty(v);
+        return Vertex(v);
+    }
+
+    Vertices.P.emplace_back(p);
+    Vertices.IncidentEdge.emplace_back(Invalid);
+    Vertices.Deleted.push_back(false);
+    markVertexDirty(VertexCount() - 1);
+
+    return Vertex(VertexCount() - 1);
 }
 
-void HalfEdgeMesh::DeleteFace(const HalfEdge::Face::Ptr &face)
+HalfEdgeMesh::Face HalfEdgeMesh::AddFace(const Vertex *vertices, uint32 count)
 {
-    auto e = face->Edge.lock();
-    std::vector<HalfEdge::Ptr> edges;
-    std::vector<HalfEdge::Vertex::Ptr> orphanVertices;
-    do
+    if (count < 3) return Face();
+
+    // corners have to be on the boundary and sides have to be boundary or missing, otherwise the face would
+    // make the mesh non-manifold
+    scratch.resize(count);
+    for (uint32 i = 0; i < count; ++i)
     {
-        edges.emplace_back(e);
-        auto twin = e->Twin.lock();
-        if (twin)
+        const auto from     = vertices[i].Value;
+        const auto to       = vertices[(i + 1) % count].Value;
+        const auto incident = Vertices.IncidentEdge[from];
+        if (incident != Invalid && Edges.IncidentFace[incident] != Invalid)
         {
-            twin->Twin.reset();
-            auto isBoundary = twin->IncidentFace.expired();
-            if (isBoundary)
-            {
-                edges.emplace_back(twin);
-            }
+            fmtx::Warn(fmt::format("Cannot add face, vertex {} is not on the boundary", from));
+            return Face();
+        }
+        scratch[i] = findEdge(from, to);
+        if (scratch[i] != Invalid && Edges.IncidentFace[scratch[i]] != Invalid)
+        {
+            fmtx::Warn(fmt::format("Cannot add face, edge {} -> {} already has a face", from, to));
+            return Face();
         }
-        e->IncidentFace.reset();
-        e = e->Next.lock();
-    } while (e != face->Edge.lock());
+    }
 
-    e = face->Edge.lock();
-    do
+    // links are collected and written at the end so boundary loops are always walked in their original state
+    nextLinks.clear();
+    for (uint32 i = 0, ii = 1; i < count; ++i, ii = (ii + 1) % count)
+    {
+        const auto innerPrev = scratch[i];
+        const auto innerNext = scratch[ii];
+        if (innerPrev == Invalid || innerNext == Invalid || Edges.Next[innerPrev] == innerNext) continue;
+
+        // both sides exist but other fans sit between them around the corner, those are moved to another gap
+        auto boundaryPrev = Edges.Twin[innerNext];
+        do
+            boundaryPrev = Edges.Twin[Edges.Next[boundaryPrev]];
+        while (Edges.IncidentFace[boundaryPrev] != Invalid || boundaryPrev == innerPrev);
+        const auto boundaryNext = Edges.Next[boundaryPrev];
+        if (boundaryNext == innerNext)
+        {
+            fmtx::Warn(fmt::format("Cannot add face, no free gap around vertex {}", vertices[ii].Value));
+            return Face();
+        }
+        nextLinks.emplace_back(boundaryPrev, Edges.Next[innerPrev]);
+        nextLinks.emplace_back(Edges.Prev[innerNext], boundaryNext);
+        nextLinks.emplace_back(innerPrev, innerNext);
+    }
+
+    Face face;
+    if (!Faces.Free.empty())
+    {
+        face = Face(Faces.Free.back());
+        Faces.Free.pop_back();
+        Faces.Deleted[face.Value] = false;
+    }
+    else
+    {
+        face = Face(FaceCount());
+        Faces.Edge.emplace_back(Invalid);
+        Faces.Deleted.push_back(false);
+    }
+
+    // missing sides get an interior and boundary pair, new edges stay unlinked until nextLinks are written
+    for (uint32 i = 0; i < count; ++i)
+    {
+        if (scratch[i] == Invalid)
+        {
+            auto e           = newEdge(vertices[i], Face()).Value;
+            auto twin        = newEdge(vertices[(i + 1) % count], Face()).Value;
+            Edges.Twin[e]    = twin;
+            Edges.Twin[twin] = e;
+            scratch[i]       = e;
+        }
+        Edges.IncidentFace[scratch[i]] = face.Value;
+        markVertexDirty(vertices[i].Value);
+    }
+
+    // boundary loops passing every corner are rerouted around the face
+    auto isNew = [this](Index e) { return Edges.Next[e] == Invalid; };
+    for (uint32 i = 0, ii = 1; i < count; ++i, ii = (ii + 1) % count)
     {
-        auto vertex = e->Origin.lock();
-        auto edge   = vertex->IncidentEdge.lock();
-        if (edge->IncidentFace.expired())
+        const auto innerPrev = scratch[i];
+        const auto innerNext = scratch[ii];
+        const auto outerPrev = Edges.Twin[innerNext];
+        const auto outerNext = Edges.Twin[innerPrev];
+        const bool prevNew   = isNew(innerPrev);
+        const bool nextNew   = isNew(innerNext);
+        auto &incident       = Vertices.IncidentEdge[vertices[ii].Value];
+
+        if (prevNew && nextNew)
         {
-            orphanVertices.emplace_back(vertex);
+            if (incident == Invalid)
+            {
+                incident = outerNext;
+                nextLinks.emplace_back(outerPrev, outerNext);
+            }
+            else
+            {
+                nextLinks.emplace_back(Edges.Prev[incident], outerNext);
+                nextLinks.emplace_back(outerPrev, incident);
+            }
         }
-        e->Origin.lock()->IncidentEdge.reset();
-        e->Origin.reset();
-        e = e->Next.lock();
-    } while (e != face->Edge.lock());
+        else if (prevNew)
+            nextLinks.emplace_back(Edges.Prev[innerNext], outerNext);
+        else if (nextNew)
+            nextLinks.emplace_back(outerPrev, Edges.Next[innerPrev]);
 
-    face->Edge.reset();
+        if (prevNew || nextNew) nextLinks.emplace_back(innerPrev, innerNext);
+    }
 
-    fmt::println("Faces: {}, Edges: {}, Vertex: {}", Faces.size(), Edges.size(), Vertices.size());
-    Faces.erase(std::remove(Faces.begin(), Faces.end(), face), Faces.end());
-    for (auto &e : edges) Edges.erase(std::remove(Edges.begin(), Edges.end(), e), Edges.end());
-    for (auto &v : orphanVertices) Vertices.erase(std::remove(Vertices.begin(), Vertices.end(), v), Vertices.end());
-    fmt::println("Faces: {}, Edges: {}, Vertex: {}", Faces.size(), Edges.size(), Vertices.size());
+    for (const auto &[e, next] : nextLinks)
+    {
+        Edges.Next[e]    = next;
+        Edges.Prev[next] = e;
+    }
+    for (uint32 i = 0; i < count; ++i) adjustIncidentEdge(vertices[i].Value);
+
+    Faces.Edge[face.Value] = scratch[0];
+    markFaceDirty(face.Value);
+    Picking.Rebuild = true;
+
+    return face;
 }
 
-void HalfEdgeMesh::Extrude(const HalfEdge::Face::Ptr &fromFace, float distance)
+void HalfEdgeMesh::DeleteFaces(const Face *faces, uint32 count)
 {
-    // std::vector<HalfEdge::Ptr> newEdges;
-    // std::vector<HalfEdge::Vertex::Ptr> newVertices;
-    // std::vector<HalfEdge::Face::Ptr> newFaces;
-    // std::unordered_map<HalfEdge::Vertex::Ptr, HalfEdge::Vertex::Ptr> vertexMap;
+    for (uint32 i = 0; i < count; ++i)
+        if (IsValid(faces[i])) deleteFace(faces[i]);
+}
 
-    // auto faceEdge = fromFace->Edge;
-    // auto dir = fromFace->Normal() * distance;
-    // DeleteFace(fromFace);
+HalfEdgeMesh::HandleRemap HalfEdgeMesh::Compact()
+{
+    HandleRemap remap;
+    remap.Vertices = buildRemap(Vertices.Deleted);
+    remap.Edges    = buildRemap(Edges.Deleted);
+    remap.Faces    = buildRemap(Faces.Deleted);
+
+    compactArray(Vertices.P, remap.Vertices);
+    compactArray(Vertices.IncidentEdge, remap.Vertices);
+    for (auto &e : Vertices.IncidentEdge) e = remapped(remap.Edges, e);
+
+    compactArray(Edges.Origin, remap.Edges);
+    compactArray(Edges.Twin, remap.Edges);
+    compactArray(Edges.IncidentFace, remap.Edges);
+    compactArray(Edges.Prev, remap.Edges);
+    compactArray(Edges.Next, remap.Edges);
+    for (Index e = 0; e < EdgeCount(); ++e)
+    {
+        Edges.Origin[e]       = remapped(remap.Vertices, Edges.Origin[e]);
+        Edges.Twin[e]         = remapped(remap.Edges, Edges.Twin[e]);
+        Edges.IncidentFace[e] = remapped(remap.Faces, Edges.IncidentFace[e]);
+        Edges.Prev[e]         = remapped(remap.Edges, Edges.Prev[e]);
+        Edges.Next[e]         = remapped(remap.Edges, Edges.Next[e]);
+    }
 
-    // // vertices first
-    // auto e = faceEdge.lock();
-    // do
-    // {
-    //     auto extrudedVertex = HalfEdge::Vertex::New(e->Origin.lock()->P + dir);
-    //     vertexMap[e->Origin.lock()] = extrudedVertex;
-    //     newVertices.push_back(extrudedVertex);
-    //     e = e->Next.lock();
-    // } while (e != faceEdge.lock());
+    compactArray(Faces.Edge, remap.Faces);
+    for (auto &e : Faces.Edge) e = remapped(remap.Edges, e);
 
-    // // connect half-edges to new vertices
-    // e = faceEdge;
-    // do
-    // {
-    //     auto edge = HalfEdge::New();
-    //     // auto twin = HalfEdge::New();
-    //     auto face = HalfEdge::Face::New();
+    Vertices.Deleted.assign(VertexCount(), false);
+    Edges.Deleted.assign(EdgeCount(), false);
+    Faces.Deleted.assign(FaceCount(), false);
+    Vertices.Free.clear();
+    Edges.Free.clear();
+    Faces.Free.clear();
 
-    //     newEdges.push_back(edge);
-    //     newFaces.push_back(face);
+    // handles moved, render mesh has to be generated from scratch
+    clearDirty();
+    Layout.Valid    = false;
+    Picking.Rebuild = true;
 
-    //     face->Edge = edge;
+    return remap;
+}
 
-    //     edge->Origin = e->Origin;
-    //     edge->IncidentFace = face;
-    //     edge->Next = nullptr; // later
-    //     edge->Prev = nullptr; // later
+HalfEdgeMesh::Face HalfEdgeMesh::Extrude(Face fromFace, float distance)
+{
+    if (!IsValid(fromFace)) return Face();
 
-    //     e = e->Next;
-    // } while (e != faceEdge);
+    const auto offset = Normal(fromFace) * distance;
+    std::vector<Vertex> base;
+    std::vector<Vec3> positions;
+    const auto first = Faces.Edge[fromFace.Value];
+    auto e           = first;
+    do
+    {
+        base.emplace_back(Edges.Origin[e]);
+        positions.emplace_back(Vertices.P[Edges.Origin[e]]);
+        e = Edges.Next[e];
+    } while (e != first);
+    const uint32 count = base.size();
+
+    // sides of the deleted face stay as boundary half-edges for the side quads, corners of a face without
+    // neighbours are deleted with it and come back as new vertices
+    DeleteFace(fromFace);
+    std::vector<bool> lost(count);
+    for (uint32 i = 0; i < count; ++i) lost[i] = !IsValid(base[i]);
+    for (uint32 i = 0; i < count; ++i)
+        if (lost[i]) base[i] = AddVertex(positions[i]);
+
+    std::vector<Vertex> top(count);
+    for (uint32 i = 0; i < count; ++i) top[i] = AddVertex(positions[i] + offset);
+
+    auto face = AddFace(top.data(), count);
+    for (uint32 i = 0, ii = 1; i < count; ++i, ii = (ii + 1) % count)
+        AddFace({base[i], base[ii], top[ii], top[i]});
+
+    return face;
+}
 
-    // // build opposite face (extruded face along direction)
-    // e = faceEdge;
-    // do
-    // {
-    //     auto v = vertexMap[e->Origin];
-    //     auto nextV = vertexMap[e->Next->Origin];
-    //     auto edge = HalfEdge::New();
-    //     auto twin = HalfEdge::New();
+Vec3 HalfEdgeMesh::Center(Face f) const
+{
+    Vec3 sum(0);
+    float points     = 0;
+    const auto first = Faces.Edge[f.Value];
+    auto e           = first;
+    do
+    {
+        sum += Vertices.P[Edges.Origin[e]];
+        e = Edges.Next[e];
+        points += 1;
+    } while (e != first);
 
-    //     e = e->Next;
-    // } while (e != faceEdge);
+    return sum / points;
+}
 
-    // for (auto &v : newVertices)
-    //     Vertices.emplace_back(v);
+Vec3 HalfEdgeMesh::Normal(Face f) const { return Mathf::Normalize(AreaNormal(f)); }
 
-    // for (auto &f : newFaces)
-    //     Faces.emplace_back(f);
+Vec3 HalfEdgeMesh::AreaNormal(Face f) const
+{
+    // sum of fan triangle normals, length is twice the face area
+    Vec3 sum(0);
+    EachTriangle(
+        f,
+        [&](Vertex a, Vertex b, Vertex c)
+        {
+            const auto &p = Vertices.P[a.Value];
+            sum += Mathf::Cross(Vertices.P[b.Value] - p, Vertices.P[c.Value] - p);
+        }
+    );
+    return sum;
+}
+
+uint32 HalfEdgeMesh::Size(Face f) const
+{
+    uint32 count     = 0;
+    const auto first = Faces.Edge[f.Value];
+    auto e           = first;
+    do
+    {
+        e = Edges.Next[e];
+        ++count;
+    } while (e != first);
 
-    // for (auto &e : newEdges)
-    //     Edges.emplace_back(e);
+    return count;
 }
 
-Mesh HalfEdgeMesh::GenerateMesh(bool shareVertices) const
+void HalfEdgeMesh::GenerateMesh(Mesh &mesh, bool shareVertices) const
 {
-    Mesh mesh;
-    if (Vertices.empty()) return std::move(mesh);
+    std::vector<Index> cornerOffsets;
+    std::vector<Index> triangleOffsets;
+    generateMesh(mesh, shareVertices, cornerOffsets, triangleOffsets);
+}
 
-    if (shareVertices)
+void HalfEdgeMesh::SetPosition(Vertex v, const Vec3 &p)
+{
+    Vertices.P[v.Value] = p;
+    Picking.Refit       = true;
+    markVertexDirty(v.Value);
+
+    // normals of every face around the vertex change and so do normals of their corners
+    const auto start = Vertices.IncidentEdge[v.Value];
+    auto out         = start;
+    while (out != Invalid)
     {
-        std::map<HalfEdge::Vertex::Ptr, int> vertexMap;
-        for (const auto &v : Vertices)
+        auto f = Edges.IncidentFace[out];
+        if (f != Invalid)
         {
-            vertexMap[v] = mesh.Vertices.size();
-            mesh.Vertices.emplace_back(v->P);
-            // fmt::println("Vertex: {}, {}, {}", v->P.x, v->P.y, v->P.z);
-            mesh.Colors.push_back(YELLOW);
-            auto normal = v->IncidentEdge.lock()->IncidentFace.lock()->Normal();
-            mesh.Normals.emplace_back(normal);
+            markFaceDirty(f);
+            const auto first = Faces.Edge[f];
+            auto e           = first;
+            do
+            {
+                markVertexDirty(Edges.Origin[e]);
+                e = Edges.Next[e];
+            } while (e != first);
         }
+        auto prev = Edges.Prev[out];
+        out       = prev == Invalid ? Invalid : Edges.Twin[prev];
+        if (out == start) break;
+    }
+}
+
+HalfEdgeMesh::MeshUpdate HalfEdgeMesh::UpdateMesh(Mesh &mesh, bool shareVertices)
+{
+    MeshUpdate update;
+
+    bool patchable = Layout.Valid && Layout.SharedVertices == shareVertices &&
+                     Layout.CornerOffsets.size() == size_t(FaceCount()) + 1 &&
+                     mesh.Indices.size() == size_t(Layout.TriangleOffsets.back()) * 3 &&
+                     (!shareVertices || (Layout.VertexCount == VertexCount() && mesh.Vertices.size() == VertexCount()));
+
+    // a face reusing a deleted slot has to fit into the range the old face had
+    for (auto f : Dirty.Faces)
+    {
+        if (!patchable) break;
+        if (!Faces.Deleted[f] && Size(Face(f)) > Layout.CornerOffsets[f + 1] - Layout.CornerOffsets[f])
+            patchable = false;
+    }
+
+    if (!patchable)
+    {
+        generateMesh(mesh, shareVertices, Layout.CornerOffsets, Layout.TriangleOffsets);
+        Layout.Valid          = true;
+        Layout.SharedVertices = shareVertices;
+        Layout.VertexCount    = VertexCount();
+        clearDirty();
+
+        update.Rebuilt = true;
+        update.Vertices.push_back({0, mesh.Vertices.size() * sizeof(Vec3)});
+        update.Colors.push_back({0, mesh.Colors.size() * sizeof(Vec3)});
+        update.Normals.push_back({0, mesh.Normals.size() * sizeof(Vec3)});
+        update.Indices.push_back({0, mesh.Indices.size() * sizeof(uint32)});
+        return update;
+    }
+
+    auto faceNormal = [this](Index f) { return AreaNormal(Face(f)); };
+    std::sort(Dirty.Faces.begin(), Dirty.Faces.end());
 
-        for (const auto &f : Faces)
+    std::vector<std::pair<Index, Index>> triangleRuns;
+    std::vector<std::pair<Index, Index>> vertexRuns;
+    for (auto f : Dirty.Faces)
+    {
+        const auto corners   = Layout.CornerOffsets[f];
+        const auto triangles = Layout.TriangleOffsets[f];
+        const auto capacity  = Layout.TriangleOffsets[f + 1] - triangles;
+        if (capacity == 0) continue;
+
+        auto *out     = &mesh.Indices[size_t(triangles) * 3];
+        uint32 filled = 0;
+        if (!Faces.Deleted[f])
         {
-            auto eachTriangle =
-                [&](const HalfEdge::Vertex::Ptr &a, const HalfEdge::Vertex::Ptr &b, const HalfEdge::Vertex::Ptr &c)
-            {
-                mesh.Indices.push_back(vertexMap[a]);
-                mesh.Indices.push_back(vertexMap[b]);
-                mesh.Indices.push_back(vertexMap[c]);
-                auto normals = a->IncidentEdge.lock()->IncidentFace.lock()->Normal() +
-                               b->IncidentEdge.lock()->IncidentFace.lock()->Normal() +
-                               c->IncidentEdge.lock()->IncidentFace.lock()->Normal();
-                normals                    = Mathf::Normalize(normals / 3.0f);
-                mesh.Normals[vertexMap[a]] = normals;
-                mesh.Normals[vertexMap[b]] = normals;
-                mesh.Normals[vertexMap[c]] = normals;
-                // fmt::println("Triangle: {}, {}, {}", vertexMap[a], vertexMap[b], vertexMap[c]);
-            };
-            f->EachTriangle(eachTriangle);
+            if (shareVertices)
+                filled = writeTriangles(f, out);
+            else
+                filled = writeFlatFace(f, mesh, corners, Mathf::Normalize(faceNormal(f)), out);
         }
+
+        // removed triangles stay in the buffer as degenerate ones
+        const uint32 degenerate = filled > 0 || shareVertices ? out[0] : corners;
+        std::fill(out + filled * 3, out + capacity * 3, degenerate);
+
+        triangleRuns.emplace_back(triangles, triangles + capacity);
+        if (!shareVertices) vertexRuns.emplace_back(corners, Layout.CornerOffsets[f + 1]);
     }
-    else
+
+    if (shareVertices)
     {
-        // TODO: this is temporary
-        std::vector<Vec4> colors = {
-            Vec4(0.0f, 0.0f, 0.0f, 1.0f),    Vec4(1.0f, 0.0f, 0.0f, 1.0f),    Vec4(0.0f, 1.0f, 0.0f, 1.0f),
-            Vec4(0.0f, 0.0f, 1.0f, 1.0f),    Vec4(1.0f, 1.0f, 0.0f, 1.0f),    Vec4(1.0f, 0.0f, 1.0f, 1.0f),
-            Vec4(0.0f, 1.0f, 1.0f, 1.0f),    Vec4(1.0f, 1.0f, 1.0f, 1.0f),    Vec4(0.5f, 0.0f, 0.0f, 1.0f),
-            Vec4(0.0f, 0.5f, 0.0f, 1.0f),    Vec4(0.0f, 0.0f, 0.5f, 1.0f),    Vec4(0.5f, 0.5f, 0.0f, 1.0f),
-            Vec4(0.5f, 0.0f, 0.5f, 1.0f),    Vec4(0.0f, 0.5f, 0.5f, 1.0f),    Vec4(0.5f, 0.5f, 0.5f, 1.0f),
-            Vec4(0.25f, 0.0f, 0.0f, 1.0f),   Vec4(0.0f, 0.25f, 0.0f, 1.0f),   Vec4(0.0f, 0.0f, 0.25f, 1.0f),
-            Vec4(0.25f, 0.25f, 0.0f, 1.0f),  Vec4(0.25f, 0.0f, 0.25f, 1.0f),  Vec4(0.0f, 0.25f, 0.25f, 1.0f),
-            Vec4(0.25f, 0.25f, 0.25f, 1.0f), Vec4(0.75f, 0.0f, 0.0f, 1.0f),   Vec4(0.0f, 0.75f, 0.0f, 1.0f),
-            Vec4(0.0f, 0.0f, 0.75f, 1.0f),   Vec4(0.75f, 0.75f, 0.0f, 1.0f),  Vec4(0.75f, 0.0f, 0.75f, 1.0f),
-            Vec4(0.0f, 0.75f, 0.75f, 1.0f),  Vec4(0.75f, 0.75f, 0.75f, 1.0f), Vec4(0.25f, 0.0f, 0.0f, 1.0f),
-            Vec4(0.0f, 0.25f, 0.0f, 1.0f),   Vec4(0.0f, 0.0f, 0.25f, 1.0f),   Vec4(0.25f, 0.25f, 0.0f, 1.0f),
-            Vec4(0.25f, 0.0f, 0.25f, 1.0f),  Vec4(0.0f, 0.25f, 0.25f, 1.0f),  Vec4(0.25f, 0.25f, 0.25f, 1.0f),
-        };
-        int colorIndex = 0;
-
-        for (const auto &f : Faces)
+        for (auto f : Dirty.Faces)
         {
-            std::map<HalfEdge::Vertex::Ptr, int> vertexMap;
-            auto normal = f->Normal();
-            auto color  = colors[colorIndex % colors.size()];
-            colorIndex++;
-            auto eachTriangle =
-                [&](const HalfEdge::Vertex::Ptr &a, const HalfEdge::Vertex::Ptr &b, const HalfEdge::Vertex::Ptr &c)
+            if (Faces.Deleted[f]) continue;
+
+            const auto first = Faces.Edge[f];
+            auto e           = first;
+            do
             {
-                auto addVertex = [&](const HalfEdge::Vertex::Ptr &v)
-                {
-                    auto it = vertexMap.find(v);
-                    if (it == vertexMap.end())
-                    {
-                        vertexMap[v] = mesh.Vertices.size();
-                        mesh.Vertices.emplace_back(v->P);
-                        mesh.Colors.push_back(color);
-                        mesh.Normals.push_back(normal);
-                    }
-                };
-                addVertex(a);
-                addVertex(b);
-                addVertex(c);
-                mesh.Indices.push_back(vertexMap[a]);
-                mesh.Indices.push_back(vertexMap[b]);
-                mesh.Indices.push_back(vertexMap[c]);
-            };
-
-            f->EachTriangle(eachTriangle);
+                markVertexDirty(Edges.Origin[e]);
+                e = Edges.Next[e];
+            } while (e != first);
+        }
+        std::sort(Dirty.Vertices.begin(), Dirty.Vertices.end());
+
+        for (auto v : Dirty.Vertices)
+        {
+            mesh.Vertices[v] = Vertices.P[v];
+            mesh.Normals[v]  = vertexNormal(v, faceNormal);
+            vertexRuns.emplace_back(v, v + 1);
         }
     }
 
-    return std::move(mesh);
+    appendRanges(vertexRuns, sizeof(Vec3), update.Vertices);
+    appendRanges(vertexRuns, sizeof(Vec3), update.Normals);
+    if (!shareVertices) appendRanges(vertexRuns, sizeof(Vec3), update.Colors);
+    appendRanges(triangleRuns, sizeof(uint32) * 3, update.Indices);
+    clearDirty();
+
+    return update;
+}
+
+bool HalfEdgeMesh::IsConsistent() const
+{
+    auto broken = [](const char *element, Index i, const char *what)
+    {
+        fmtx::Error(fmt::format("Half-edge mesh {} {}: {}", element, i, what));
+        return false;
+    };
+    auto live = [](const std::vector<bool> &deleted, Index i) { return i < deleted.size() && !deleted[i]; };
+
+    for (Index e = 0; e < EdgeCount(); ++e)
+    {
+        if (Edges.Deleted[e]) continue;
+
+        const auto twin = Edges.Twin[e];
+        const auto next = Edges.Next[e];
+        const auto face = Edges.IncidentFace[e];
+        if (!live(Edges.Deleted, twin) || Edges.Twin[twin] != e) return broken("edge", e, "twin is not linked back");
+        if (!live(Edges.Deleted, next) || Edges.Prev[next] != e) return broken("edge", e, "next is not linked back");
+        if (Edges.Origin[next] != Edges.Origin[twin]) return broken("edge", e, "next does not start at destination");
+        if (Edges.IncidentFace[next] != face) return broken("edge", e, "next belongs to another face");
+        if (face == Invalid && Edges.IncidentFace[twin] == Invalid) return broken("edge", e, "both sides are boundary");
+        if (face != Invalid && !live(Faces.Deleted, face)) return broken("edge", e, "face is deleted");
+        if (!live(Vertices.Deleted, Edges.Origin[e])) return broken("edge", e, "origin is deleted");
+    }
+
+    for (Index f = 0; f < FaceCount(); ++f)
+    {
+        if (Faces.Deleted[f]) continue;
+        if (!live(Edges.Deleted, Faces.Edge[f]) || Edges.IncidentFace[Faces.Edge[f]] != f)
+            return broken("face", f, "edge belongs to another face");
+    }
+
+    for (Index v = 0; v < VertexCount(); ++v)
+    {
+        const auto e = Vertices.IncidentEdge[v];
+        if (Vertices.Deleted[v] || e == Invalid) continue;
+        if (!live(Edges.Deleted, e) || Edges.Origin[e] != v)
+            return broken("vertex", v, "incident edge starts elsewhere");
+    }
+
+    return true;
 }
 
 void HalfEdgeMesh::DebugDrawLine(const std::function<void(const DrawLine &)> &fn, const Vec3 &cameraPosition) const
 {
     DrawLine draw;
-    for (const auto &e : Edges)
+    for (Index e = 0; e < EdgeCount(); ++e)
     {
-        draw.Boundary = e->IncidentFace.expired();
+        if (Edges.Deleted[e]) continue;
+
+        const auto &from = Vertices.P[Edges.Origin[e]];
+        const auto &to   = Vertices.P[Edges.Origin[Edges.Next[e]]];
+        draw.Boundary    = Edges.IncidentFace[e] == Invalid;
         if (draw.Boundary)
         {
-            draw.From     = e->Origin.lock()->P;
-            draw.To       = e->Next.lock()->Origin.lock()->P;
-            draw.Boundary = true;
-            draw.Visible  = true; // would be nice to have visibility check (twin face check)
+            draw.From    = from;
+            draw.To      = to;
+            draw.Visible = true; // would be nice to have visibility check (twin face check)
             fn(draw);
         }
         else
         {
-            auto center = e->IncidentFace.lock()->Center();
-            auto dir    = Mathf::Normalize(cameraPosition - center);
-            auto dot    = Mathf::Dot(dir, e->IncidentFace.lock()->Normal());
-            draw.From   = Mathf::Normalize(center - e->Origin.lock()->P) * 0.01f + e->Origin.lock()->P;
-            draw.To     = Mathf::Normalize(center - e->Next.lock()->Origin.lock()->P) * 0.01f +
-                      e->Next.lock()->Origin.lock()->P;
+            auto face    = Face(Edges.IncidentFace[e]);
+            auto center  = Center(face);
+            auto dir     = Mathf::Normalize(cameraPosition - center);
+            auto dot     = Mathf::Dot(dir, Normal(face));
+            draw.From    = Mathf::Normalize(center - from) * 0.01f + from;
+            draw.To      = Mathf::Normalize(center - to) * 0.01f + to;
             draw.Visible = dot >= 0;
             fn(draw);
         }
@@ -500,19 +735,23 @@ void HalfEdgeMesh::DebugDrawLine(const std::function<void(const DrawLine &)> &fn
 void HalfEdgeMesh::DebugDrawPoint(const std::function<void(const DrawPoint &)> &fn, const Vec3 &cameraPosition) const
 {
     DrawPoint draw;
-    for (const auto &v : Vertices)
+    for (Index v = 0; v < VertexCount(); ++v)
     {
-        draw.Position = v->P;
+        if (Vertices.Deleted[v]) continue;
+
+        draw.Position = Vertices.P[v];
         draw.Center   = false;
         draw.Visible  = true; // would be nice to have visibility check (face check)
         fn(draw);
     }
 
-    for (const auto &f : Faces)
+    for (Index f = 0; f < FaceCount(); ++f)
     {
-        auto center = f->Center();
+        if (Faces.Deleted[f]) continue;
+
+        auto center = Center(Face(f));
         auto dir    = Mathf::Normalize(cameraPosition - center);
-        auto dot    = Mathf::Dot(dir, f->Normal());
+        auto dot    = Mathf::Dot(dir, Normal(Face(f)));
 
         draw.Position = center;
         draw.Center   = true;
@@ -524,10 +763,12 @@ void HalfEdgeMesh::DebugDrawPoint(const std::function<void(const DrawPoint &)> &
 void HalfEdgeMesh::DebugDrawNormal(const std::function<void(const DrawNormal &)> &fn, const Vec3 &cameraPosition) const
 {
     DrawNormal draw;
-    for (const auto &f : Faces)
+    for (Index f = 0; f < FaceCount(); ++f)
     {
-        draw.From      = f->Center();
-        draw.Direction = f->Normal();
+        if (Faces.Deleted[f]) continue;
+
+        draw.From      = Center(Face(f));
+        draw.Direction = Normal(Face(f));
         auto dir       = Mathf::Normalize(cameraPosition - draw.From);
         auto dot       = Mathf::Dot(dir, draw.Direction);
         draw.Visible   = dot >= 0;
@@ -537,67 +778,441 @@ void HalfEdgeMesh::DebugDrawNormal(const std::function<void(const DrawNormal &)>
 
 HalfEdgeMesh::RaycastHit HalfEdgeMesh::Raycast(const Ray &ray) const
 {
+    if (Picking.Rebuild)
+    {
+        std::vector<uint32> indices;
+        Picking.TriangleFaces.clear();
+        for (Index f = 0; f < FaceCount(); ++f)
+        {
+            if (Faces.Deleted[f]) continue;
+
+            EachTriangle(
+                Face(f),
+                [&](Vertex a, Vertex b, Vertex c)
+                {
+                    indices.insert(indices.end(), {a.Value, b.Value, c.Value});
+                    Picking.TriangleFaces.emplace_back(f);
+                }
+            );
+        }
+        Picking.Tree.Build(Vertices.P, std::move(indices));
+        Picking.Rebuild = false;
+        Picking.Refit   = false;
+    }
+    else if (Picking.Refit)
+    {
+        Picking.Tree.Refit(Vertices.P);
+        Picking.Refit = false;
+    }
+
     RaycastHit hit;
-    float minDistance = 100;
-    for (const auto &f : Faces)
+    auto treeHit = Picking.Tree.Raycast(ray);
+    if (!treeHit.Valid()) return hit;
+
+    const auto *triangle = Picking.Tree.Triangle(treeHit.Triangle);
+    hit.Face             = Face(Picking.TriangleFaces[treeHit.Triangle]);
+    hit.Center           = Center(hit.Face);
+    hit.Point            = ray.Origin + ray.Direction * treeHit.Distance;
+    hit.Distance         = treeHit.Distance;
+    hit.Barycentric      = treeHit.Barycentric;
+    for (int i = 0; i < 3; ++i) hit.Triangle[i] = Vertex(triangle[i]);
+
+    return hit;
+}
+
+template <typename FaceNormal> Vec3 HalfEdgeMesh::vertexNormal(Index v, FaceNormal &&faceNormal) const
+{
+    // area-weighted average of faces around the vertex, isolated and deleted vertices point up
+    Vec3 sum(0);
+    const auto start = Vertices.IncidentEdge[v];
+    auto out         = start;
+    while (out != Invalid)
     {
-        auto e = f->Edge.lock();
-        do
+        if (Edges.IncidentFace[out] != Invalid) sum += faceNormal(Edges.IncidentFace[out]);
+        auto prev = Edges.Prev[out];
+        out       = prev == Invalid ? Invalid : Edges.Twin[prev];
+        if (out == start) break;
+    }
+    return Mathf::Dot(sum, sum) > 0 ? Mathf::Normalize(sum) : UP;
+}
+
+uint32 HalfEdgeMesh::writeTriangles(Index f, uint32 *out) const
+{
+    uint32 triangles = 0;
+    EachTriangle(
+        Face(f),
+        [&](Vertex a, Vertex b, Vertex c)
         {
-            auto a      = e->Origin.lock()->P;
-            auto b      = e->Next.lock()->Origin.lock()->P;
-            auto c      = e->Next.lock()->Next.lock()->Origin.lock()->P;
-            auto normal = -Mathf::Normalize(Mathf::Cross(b - a, c - a));
-            if (Mathf::Dot(ray.Direction, normal) < 0) continue;
-            auto intersection = Mathf::RayTriangleIntersection(ray, a, b, c, minDistance);
-
-            // if (d > 0 && d < minDistance)
-            if (intersection)
+            *out++ = a.Value;
+            *out++ = b.Value;
+            *out++ = c.Value;
+            ++triangles;
+        }
+    );
+    return triangles;
+}
+
+uint32 HalfEdgeMesh::writeFlatFace(Index f, Mesh &mesh, Index base, const Vec3 &normal, uint32 *out) const
+{
+    const auto color = faceColor(f);
+    auto corner      = base;
+    const auto first = Faces.Edge[f];
+    auto e           = first;
+    do
+    {
+        mesh.Vertices[corner] = Vertices.P[Edges.Origin[e]];
+        mesh.Colors[corner]   = color;
+        mesh.Normals[corner]  = normal;
+        ++corner;
+        e = Edges.Next[e];
+    } while (e != first);
+
+    for (auto i = base + 1; i + 1 < corner; ++i)
+    {
+        *out++ = base;
+        *out++ = i;
+        *out++ = i + 1;
+    }
+    return corner - base - 2;
+}
+
+void HalfEdgeMesh::generateMesh(
+    Mesh &mesh,
+    bool shareVertices,
+    std::vector<Index> &cornerOffsets,
+    std::vector<Index> &triangleOffsets
+) const
+{
+    // pass 1: corner and triangle counts per face, deleted faces emit nothing
+    const uint32 faceCount = FaceCount();
+    cornerOffsets.resize(faceCount + 1);
+    triangleOffsets.resize(faceCount + 1);
+    std::vector<Vec3> faceNormals(faceCount);
+    Parallel::For(
+        faceCount,
+        [&](uint32 begin, uint32 end)
+        {
+            for (Index f = begin; f < end; ++f)
             {
-                // minDistance = d;
-                fmt::println("Intersection: {}", intersection);
-                fmt::println("Distance: {}", minDistance);
-                hit.Center = f->Center();
-                hit.Face   = f;
-                break;
+                if (Faces.Deleted[f])
+                {
+                    cornerOffsets[f]   = 0;
+                    triangleOffsets[f] = 0;
+                    continue;
+                }
+                cornerOffsets[f]   = Size(Face(f));
+                triangleOffsets[f] = cornerOffsets[f] - 2;
+                faceNormals[f]     = AreaNormal(Face(f));
             }
-            e = e->Next.lock();
-        } while (e != f->Edge.lock());
+        }
+    );
+
+    // exclusive prefix sum turns counts into offsets, last element holds the total
+    Index corners = 0, triangles = 0;
+    for (Index f = 0; f <= faceCount; ++f)
+    {
+        auto cornerCount   = f < faceCount ? cornerOffsets[f] : 0;
+        auto triangleCount = f < faceCount ? triangleOffsets[f] : 0;
+        cornerOffsets[f]   = corners;
+        triangleOffsets[f] = triangles;
+        corners += cornerCount;
+        triangles += triangleCount;
+    }
+
+    // pass 2: every face writes into its own range of the pre-sized buffers
+    mesh.Indices.resize(size_t(triangles) * 3);
+    if (shareVertices)
+    {
+        mesh.Vertices.assign(Vertices.P.begin(), Vertices.P.end());
+        mesh.Colors.assign(VertexCount(), Vec3(YELLOW));
+        mesh.Normals.resize(VertexCount());
+
+        Parallel::For(
+            VertexCount(),
+            [&](uint32 begin, uint32 end)
+            {
+                auto faceNormal = [&](Index f) { return faceNormals[f]; };
+                for (Index v = begin; v < end; ++v) mesh.Normals[v] = vertexNormal(v, faceNormal);
+            }
+        );
+
+        Parallel::For(
+            faceCount,
+            [&](uint32 begin, uint32 end)
+            {
+                for (Index f = begin; f < end; ++f)
+                    if (!Faces.Deleted[f]) writeTriangles(f, &mesh.Indices[size_t(triangleOffsets[f]) * 3]);
+            }
+        );
+    }
+    else
+    {
+        mesh.Vertices.resize(corners);
+        mesh.Colors.resize(corners);
+        mesh.Normals.resize(corners);
+
+        // every face gets its own copy of the corner vertices
+        Parallel::For(
+            faceCount,
+            [&](uint32 begin, uint32 end)
+            {
+                for (Index f = begin; f < end; ++f)
+                {
+                    if (Faces.Deleted[f]) continue;
+
+                    auto *out = &mesh.Indices[size_t(triangleOffsets[f]) * 3];
+                    writeFlatFace(f, mesh, cornerOffsets[f], Mathf::Normalize(faceNormals[f]), out);
+                }
+            }
+        );
     }
-    return hit;
 }
 
-void HalfEdgeMesh::generateMissingTwins()
+HalfEdgeMesh::Edge HalfEdgeMesh::newEdge(Vertex origin, Face face)
 {
-    std::map<std::pair<HalfEdge::Vertex::Ptr, HalfEdge::Vertex::Ptr>, HalfEdge::Ptr> edgeMap;
-    for (const auto &e : Edges)
+    if (!Edges.Free.empty())
     {
-        auto key     = std::make_pair(e->Origin.lock(), e->Next.lock()->Origin.lock());
-        edgeMap[key] = e;
+        auto e = Edges.Free.back();
+        Edges.Free.pop_back();
+        Edges.Origin[e]       = origin.Value;
+        Edges.Twin[e]         = Invalid;
+        Edges.IncidentFace[e] = face.Value;
+        Edges.Prev[e]         = Invalid;
+        Edges.Next[e]         = Invalid;
+        Edges.Deleted[e]      = false;
+        return Edge(e);
     }
 
-    for (const auto &e : Edges)
+    Edges.Origin.emplace_back(origin.Value);
+    Edges.Twin.emplace_back(Invalid);
+    Edges.IncidentFace.emplace_back(face.Value);
+    Edges.Prev.emplace_back(Invalid);
+    Edges.Next.emplace_back(Invalid);
+    Edges.Deleted.push_back(false);
+
+    return Edge(EdgeCount() - 1);
+}
+
+Index HalfEdgeMesh::findEdge(Index from, Index to) const
+{
+    const auto start = Vertices.IncidentEdge[from];
+    if (start == Invalid) return Invalid;
+
+    auto out = start;
+    do
+    {
+        if (Edges.Origin[Edges.Twin[out]] == to) return out;
+        out = Edges.Twin[Edges.Prev[out]];
+    } while (out != start);
+
+    return Invalid;
+}
+
+uint32 HalfEdgeMesh::generateMissingTwins()
+{
+    const Index edgeCount = EdgeCount();
+    auto isOpen           = [this](Index e) { return !Edges.Deleted[e] && Edges.Twin[e] == Invalid; };
+
+    // same directed edge used twice means the edge is shared by more than two faces or winding is inconsistent,
+    // such edges are left without an interior twin and get a boundary one instead
+    std::atomic<uint32> nonManifold{0};
+    EdgeTable table(edgeCount);
+    Parallel::For(
+        edgeCount,
+        [&](uint32 begin, uint32 end)
+        {
+            uint32 duplicates = 0;
+            for (Index e = begin; e < end; ++e)
+                if (isOpen(e) && !table.Insert(edgeKey(Edges.Origin[e], Edges.Origin[Edges.Next[e]]), e))
+                    ++duplicates;
+            nonManifold += duplicates;
+        }
+    );
+
+    // every edge only writes its own twin, pairs are accepted when both sides found each other
+    std::vector<Index> candidates(edgeCount, Invalid);
+    Parallel::For(
+        edgeCount,
+        [&](uint32 begin, uint32 end)
+        {
+            for (Index e = begin; e < end; ++e)
+                if (isOpen(e)) candidates[e] = table.Find(edgeKey(Edges.Origin[Edges.Next[e]], Edges.Origin[e]));
+        }
+    );
+    Parallel::For(
+        edgeCount,
+        [&](uint32 begin, uint32 end)
+        {
+            for (Index e = begin; e < end; ++e)
+            {
+                auto twin = candidates[e];
+                if (twin != Invalid && candidates[twin] == e) Edges.Twin[e] = twin;
+            }
+        }
+    );
+
+    // close every open edge with a boundary half-edge going the other way
+    scratch.clear();
+    for (Index e = 0; e < edgeCount; ++e)
     {
-        auto key = std::make_pair(e->Next.lock()->Origin.lock(), e->Origin.lock());
-        if (edgeMap.find(key) != edgeMap.end())
+        if (Edges.Deleted[e] || Edges.Twin[e] != Invalid) continue;
+
+        auto origin   = Vertex(Edges.Origin[Edges.Next[e]]);
+        auto boundary = newEdge(origin, Face());
+        Edges.Twin[e]                       = boundary.Value;
+        Edges.Twin[boundary.Value]          = e;
+        Vertices.IncidentEdge[origin.Value] = boundary.Value;
+        scratch.emplace_back(boundary.Value);
+    }
+
+    // boundary half-edge continues with the one leaving its fan around the destination, found by rotating
+    // through interior edges only so it works before any boundary edge is linked
+    Parallel::For(
+        scratch.size(),
+        [&](uint32 begin, uint32 end)
         {
-            auto twin  = edgeMap[key];
-            e->Twin    = twin;
-            twin->Twin = e;
+            for (uint32 i = begin; i < end; ++i)
+            {
+                const auto b = scratch[i];
+                auto out     = Edges.Twin[Edges.Prev[Edges.Twin[b]]];
+                while (Edges.IncidentFace[out] != Invalid) out = Edges.Twin[Edges.Prev[out]];
+                Edges.Next[b] = out;
+            }
         }
+    );
+
+    // vertices with several fans would get one loop per fan, swapping successors chains them so rotating
+    // around the vertex visits all of them
+    std::vector<Index> lastIncoming(VertexCount(), Invalid);
+    for (auto b : scratch)
+    {
+        auto &last = lastIncoming[Edges.Origin[Edges.Twin[b]]];
+        if (last != Invalid) std::swap(Edges.Next[last], Edges.Next[b]);
+        last = b;
     }
+    for (auto b : scratch) Edges.Prev[Edges.Next[b]] = b;
+
+    if (nonManifold > 0) fmtx::Warn(fmt::format("Half-edge mesh has {} non-manifold edges", nonManifold.load()));
+
+    return nonManifold;
 }
 
-bool HalfEdgeMeshSelection::IsSelected() const
+void HalfEdgeMesh::deleteFace(Face face)
 {
-    for (const auto &f : SelectedFaces)
+    // face edges become boundary, edges with boundary on both sides are removed
+    scratch.clear();
+    const auto first = Faces.Edge[face.Value];
+    auto e           = first;
+    do
+    {
+        Edges.IncidentFace[e] = Invalid;
+        scratch.emplace_back(e);
+        markVertexDirty(Edges.Origin[e]);
+        e = Edges.Next[e];
+    } while (e != first);
+
+    for (auto h0 : scratch)
     {
-        if (!f.expired()) return true;
+        auto h1 = Edges.Twin[h0];
+        if (Edges.Deleted[h0] || Edges.IncidentFace[h1] != Invalid) continue;
+
+        auto next0 = Edges.Next[h0];
+        auto prev0 = Edges.Prev[h0];
+        auto next1 = Edges.Next[h1];
+        auto prev1 = Edges.Prev[h1];
+        auto v0    = Edges.Origin[h0];
+        auto v1    = Edges.Origin[h1];
+
+        // splice the edge out of the boundary loop
+        Edges.Next[prev0] = next1;
+        Edges.Prev[next1] = prev0;
+        Edges.Next[prev1] = next0;
+        Edges.Prev[next0] = prev1;
+
+        if (Vertices.IncidentEdge[v0] == h0) Vertices.IncidentEdge[v0] = next1 == h0 ? Invalid : next1;
+        if (Vertices.IncidentEdge[v1] == h1) Vertices.IncidentEdge[v1] = next0 == h1 ? Invalid : next0;
+
+        deleteEdge(h0);
+        deleteEdge(h1);
     }
-    return false;
+
+    // origins of deleted edges are still readable, their slots are only reused by the next insertion
+    for (auto h : scratch)
+    {
+        auto v = Edges.Origin[h];
+        if (Vertices.Deleted[v]) continue;
+
+        if (Vertices.IncidentEdge[v] == Invalid)
+            deleteVertex(v);
+        else
+            adjustIncidentEdge(v);
+    }
+
+    Faces.Edge[face.Value]    = Invalid;
+    Faces.Deleted[face.Value] = true;
+    markFaceDirty(face.Value);
+    Picking.Rebuild = true;
+    Faces.Free.emplace_back(face.Value);
+}
+
+void HalfEdgeMesh::adjustIncidentEdge(Index v)
+{
+    // prefer boundary outgoing edge so boundary vertices can be detected in O(1)
+    const auto start = Vertices.IncidentEdge[v];
+    auto out         = start;
+    do
+    {
+        if (Edges.IncidentFace[out] == Invalid)
+        {
+            Vertices.IncidentEdge[v] = out;
+            return;
+        }
+        out = Edges.Twin[Edges.Prev[out]];
+    } while (out != start);
+}
+
+void HalfEdgeMesh::deleteEdge(Index e)
+{
+    Edges.Deleted[e] = true;
+    Edges.Free.emplace_back(e);
+}
+
+void HalfEdgeMesh::deleteVertex(Index v)
+{
+    Vertices.IncidentEdge[v] = Invalid;
+    Vertices.Deleted[v]      = true;
+    Vertices.Free.emplace_back(v);
 }
 
-void HalfEdgeMeshSelection::Select(const HalfEdge::Face::Ref &face)
+void HalfEdgeMesh::markVertexDirty(Index v)
+{
+    if (v >= Dirty.VertexFlags.size()) Dirty.VertexFlags.resize(VertexCount(), false);
+    if (Dirty.VertexFlags[v]) return;
+
+    Dirty.VertexFlags[v] = true;
+    Dirty.Vertices.emplace_back(v);
+}
+
+void HalfEdgeMesh::markFaceDirty(Index f)
+{
+    if (f >= Dirty.FaceFlags.size()) Dirty.FaceFlags.resize(FaceCount(), false);
+    if (Dirty.FaceFlags[f]) return;
+
+    Dirty.FaceFlags[f] = true;
+    Dirty.Faces.emplace_back(f);
+}
+
+void HalfEdgeMesh::clearDirty()
+{
+    for (auto v : Dirty.Vertices) Dirty.VertexFlags[v] = false;
+    for (auto f : Dirty.Faces) Dirty.FaceFlags[f] = false;
+    Dirty.Vertices.clear();
+    Dirty.Faces.clear();
+}
+
+bool HalfEdgeMeshSelection::IsSelected() const { return !SelectedFaces.empty(); }
+
+void HalfEdgeMeshSelection::Select(HalfEdge::Face face)
 {
     Clear();
     SelectedFaces.emplace_back(face);
@@ -605,7 +1220,19 @@ void HalfEdgeMeshSelection::Select(const HalfEdge::Face::Ref &face)
 
 void HalfEdgeMeshSelection::Clear() { SelectedFaces.clear(); }
 
+void HalfEdgeMeshSelection::Remap(const HalfEdgeMesh::HandleRemap &remap)
+{
+    std::vector<HalfEdge::Face> faces;
+    for (const auto &f : SelectedFaces)
+    {
+        auto face = remap.Remap(f);
+        if (face.IsValid()) faces.emplace_back(face);
+    }
+    SelectedFaces = std::move(faces);
+}
+
 void HalfEdgeMeshSelection::DrawLine(
+    const HalfEdgeMesh &mesh,
     const std::function<void(const HalfEdgeMesh::DrawLine &)> &fn,
     const Vec3 &cameraPosition
 ) const
@@ -614,21 +1241,22 @@ void HalfEdgeMeshSelection::DrawLine(
 
     for (const auto &f : SelectedFaces)
     {
-        if (f.expired()) continue;
+        if (!mesh.IsValid(f)) continue;
 
-        auto center = f.lock()->Center();
+        auto center = mesh.Center(f);
         auto dir    = Mathf::Normalize(cameraPosition - center);
-        auto dot    = Mathf::Dot(dir, f.lock()->Normal());
+        auto dot    = Mathf::Dot(dir, mesh.Normal(f));
 
-        auto e = f.lock()->Edge.lock();
+        const auto first = mesh.FaceEdge(f);
+        auto e           = first;
         do
         {
-            draw.From     = e->Origin.lock()->P;
-            draw.To       = e->Next.lock()->Origin.lock()->P;
-            draw.Boundary = e->IncidentFace.expired();
+            draw.From     = mesh.Position(mesh.Origin(e));
+            draw.To       = mesh.Position(mesh.Destination(e));
+            draw.Boundary = mesh.IsBoundary(e);
             draw.Visible  = dot >= 0;
             fn(draw);
-            e = e->Next.lock();
-        } while (e != f.lock()->Edge.lock());
+            e = mesh.Next(e);
+        } while (e != first);
     }
 }
@@ -1,10 +1,19 @@
 #pragma once
 
+#include "bvh.hpp"
 #include "half_edge.hpp"
+#include <functional>
 
+// Half-edge mesh stored as structure of arrays, elements are addressed by 32-bit handles (see half_edge.hpp).
+// Every interior half-edge has a twin, boundary half-edges have no incident face.
+// Deleted elements are only tombstoned and their slots reused, call Compact() to drop them and remap handles.
 class HalfEdgeMesh
 {
 public:
+    using Vertex = HalfEdge::Vertex;
+    using Edge   = HalfEdge::Edge;
+    using Face   = HalfEdge::Face;
+
     struct DrawLine
     {
         Vec3 From;
@@ -25,12 +34,45 @@ public:
         bool Visible;
     };
 
+    // closest hit, Point = Barycentric weighted Triangle corners (first corner gets 1 - x - y)
     struct RaycastHit
     {
-        HalfEdge::Face::Ptr Face;
+        HalfEdge::Face Face;
         Vec3 Center;
+        Vec3 Point;
+        float Distance = 0;
+        Vec2 Barycentric;
+        HalfEdge::Vertex Triangle[3];
+
+        bool Hit() const { return Face.IsValid(); }
+    };
+
+    // old -> new handle tables produced by Compact(), deleted elements map to invalid handles
+    struct HandleRemap
+    {
+        std::vector<HalfEdge::Index> Vertices;
+        std::vector<HalfEdge::Index> Edges;
+        std::vector<HalfEdge::Index> Faces;
 
-        bool Hit() const { return Face != nullptr; }
+        Vertex Remap(Vertex v) const { return v.Value < Vertices.size() ? Vertex(Vertices[v.Value]) : Vertex(); }
+        Edge Remap(Edge e) const { return e.Value < Edges.size() ? Edge(Edges[e.Value]) : Edge(); }
+        Face Remap(Face f) const { return f.Value < Faces.size() ? Face(Faces[f.Value]) : Face(); }
+    };
+
+    // byte ranges of Mesh buffers changed by UpdateMesh, everything is listed when the mesh was rebuilt
+    struct MeshUpdate
+    {
+        struct Range
+        {
+            size_t Offset;
+            size_t Size;
+        };
+
+        std::vector<Range> Vertices;
+        std::vector<Range> Colors;
+        std::vector<Range> Normals;
+        std::vector<Range> Indices;
+        bool Rebuilt = false;
     };
 
 public:
@@ -39,34 +81,190 @@ public:
     static Ptr New() { return std::make_shared<HalfEdgeMesh>(); }
     static Ptr NewPlane();
     static Ptr NewCube();
+    // polygon soup with shared vertices, face f uses faceSizes[f] consecutive entries of indices.
+    // Non-manifold edges are split into boundary ones so the mesh stays consistent, nullptr is only returned
+    // when face sizes or indices are out of range.
+    static Ptr FromIndexed(
+        const std::vector<Vec3> &positions,
+        const std::vector<uint32> &indices,
+        const std::vector<uint32> &faceSizes
+    );
     HalfEdgeMesh() = default;
-    ~HalfEdgeMesh();
 
-    void DeleteFace(const HalfEdge::Face::Ptr &face);
-    void Extrude(const HalfEdge::Face::Ptr &fromFace, float distance);
+    Vertex AddVertex(const Vec3 &p);
+    // links the sides to existing boundary half-edges, returns invalid handle when the face would make the mesh
+    // non-manifold
+    Face AddFace(const Vertex *vertices, uint32 count);
+    Face AddFace(std::initializer_list<Vertex> vertices) { return AddFace(vertices.begin(), vertices.size()); }
+    void DeleteFace(Face face) { DeleteFaces(&face, 1); }
+    void DeleteFaces(const Face *faces, uint32 count);
+    void DeleteFaces(const std::vector<Face> &faces) { DeleteFaces(faces.data(), faces.size()); }
+    HandleRemap Compact();
+    // moves the face along its normal and bridges the gap with quads, returns the moved face
+    Face Extrude(Face fromFace, float distance);
+    void SetPosition(Vertex v, const Vec3 &p);
 
-    Mesh GenerateMesh(bool shareVertices = true) const;
+    Mesh GenerateMesh(bool shareVertices = true) const
+    {
+        Mesh mesh;
+        GenerateMesh(mesh, shareVertices);
+        return mesh;
+    }
+    // reuses buffers of the given mesh, they only grow when the mesh does
+    void GenerateMesh(Mesh &mesh, bool shareVertices = true) const;
+    // Patches mesh previously filled by UpdateMesh with faces and vertices changed since then. Faces keep
+    // their index range, deleted ones become degenerate triangles. Falls back to full generation on first
+    // call, after Compact(), when vertices were appended or when a face outgrows its range.
+    MeshUpdate UpdateMesh(Mesh &mesh, bool shareVertices = true);
+    bool IsDirty() const { return !Dirty.Vertices.empty() || !Dirty.Faces.empty(); }
+    // checks twin, next/prev, origin and face links of every live element, logs the first broken one
+    bool IsConsistent() const;
     void DebugDrawLine(const std::function<void(const DrawLine &)> &fn, const Vec3 &cameraPosition) const;
     void DebugDrawPoint(const std::function<void(const DrawPoint &)> &fn, const Vec3 &cameraPosition) const;
     void DebugDrawNormal(const std::function<void(const DrawNormal &)> &fn, const Vec3 &cameraPosition) const;
+    // BVH over face triangles is rebuilt on first query after topology changes and refit after SetPosition
     RaycastHit Raycast(const Ray &ray) const;
 
+    // slot counts, deleted elements are included until Compact()
+    uint32 VertexCount() const { return uint32(Vertices.P.size()); }
+    uint32 EdgeCount() const { return uint32(Edges.Origin.size()); }
+    uint32 FaceCount() const { return uint32(Faces.Edge.size()); }
+    bool HasDeleted() const { return !Vertices.Free.empty() || !Edges.Free.empty() || !Faces.Free.empty(); }
+    bool IsValid(Vertex v) const { return v.Value < VertexCount() && !Vertices.Deleted[v.Value]; }
+    bool IsValid(Edge e) const { return e.Value < EdgeCount() && !Edges.Deleted[e.Value]; }
+    bool IsValid(Face f) const { return f.Value < FaceCount() && !Faces.Deleted[f.Value]; }
+
+    const Vec3 &Position(Vertex v) const { return Vertices.P[v.Value]; }
+    Edge IncidentEdge(Vertex v) const { return Edge(Vertices.IncidentEdge[v.Value]); }
+    Vertex Origin(Edge e) const { return Vertex(Edges.Origin[e.Value]); }
+    Vertex Destination(Edge e) const { return Origin(Next(e)); }
+    Edge Twin(Edge e) const { return Edge(Edges.Twin[e.Value]); }
+    Edge Next(Edge e) const { return Edge(Edges.Next[e.Value]); }
+    Edge Prev(Edge e) const { return Edge(Edges.Prev[e.Value]); }
+    Face IncidentFace(Edge e) const { return Face(Edges.IncidentFace[e.Value]); }
+    bool IsBoundary(Edge e) const { return Edges.IncidentFace[e.Value] == HalfEdge::Invalid; }
+    Edge FaceEdge(Face f) const { return Edge(Faces.Edge[f.Value]); }
+
+    Vec3 Center(Face f) const;
+    Vec3 Normal(Face f) const;
+    Vec3 AreaNormal(Face f) const;
+    uint32 Size(Face f) const;
+    bool IsTriangle(Face f) const { return Size(f) == 3; }
+    bool IsQuad(Face f) const { return Size(f) == 4; }
+    bool IsPolygon(Face f) const { return Size(f) >= 5; }
+
+    // fan triangulation of the face, fn(Vertex a, Vertex b, Vertex c)
+    template <typename Fn> void EachTriangle(Face f, Fn &&fn) const
+    {
+        const auto first = Faces.Edge[f.Value];
+        const auto a     = Edges.Origin[first];
+        auto e           = Edges.Next[first];
+        auto next        = Edges.Next[e];
+        while (next != first)
+        {
+            fn(Vertex(a), Vertex(Edges.Origin[e]), Vertex(Edges.Origin[next]));
+            e    = next;
+            next = Edges.Next[next];
+        }
+    }
+
 private:
-    void generateMissingTwins();
-    std::vector<HalfEdge::Vertex::Ptr> Vertices;
-    std::vector<HalfEdge::Face::Ptr> Faces;
-    std::vector<HalfEdge::Ptr> Edges;
+    Edge newEdge(Vertex origin, Face face);
+    // outgoing half-edge from -> to or Invalid, walks every fan around the origin
+    HalfEdge::Index findEdge(HalfEdge::Index from, HalfEdge::Index to) const;
+    // links twins of open half-edges and closes the rest with boundary ones, returns number of non-manifold edges
+    uint32 generateMissingTwins();
+    void generateMesh(
+        Mesh &mesh,
+        bool shareVertices,
+        std::vector<HalfEdge::Index> &cornerOffsets,
+        std::vector<HalfEdge::Index> &triangleOffsets
+    ) const;
+    template <typename FaceNormal> Vec3 vertexNormal(HalfEdge::Index v, FaceNormal &&faceNormal) const;
+    uint32 writeTriangles(HalfEdge::Index f, uint32 *out) const;
+    uint32 writeFlatFace(HalfEdge::Index f, Mesh &mesh, HalfEdge::Index base, const Vec3 &normal, uint32 *out) const;
+    void markVertexDirty(HalfEdge::Index v);
+    void markFaceDirty(HalfEdge::Index f);
+    void clearDirty();
+    void deleteFace(Face face);
+    void deleteEdge(HalfEdge::Index e);
+    void deleteVertex(HalfEdge::Index v);
+    void adjustIncidentEdge(HalfEdge::Index v);
+
+private:
+    struct
+    {
+        std::vector<Vec3> P;
+        std::vector<HalfEdge::Index> IncidentEdge;
+        std::vector<bool> Deleted;
+        std::vector<HalfEdge::Index> Free;
+    } Vertices;
+
+    struct
+    {
+        std::vector<HalfEdge::Index> Origin;
+        std::vector<HalfEdge::Index> Twin;
+        std::vector<HalfEdge::Index> IncidentFace;
+        std::vector<HalfEdge::Index> Prev;
+        std::vector<HalfEdge::Index> Next;
+        std::vector<bool> Deleted;
+        std::vector<HalfEdge::Index> Free;
+    } Edges;
+
+    struct
+    {
+        std::vector<HalfEdge::Index> Edge;
+        std::vector<bool> Deleted;
+        std::vector<HalfEdge::Index> Free;
+    } Faces;
+
+    // changed since last UpdateMesh
+    struct
+    {
+        std::vector<HalfEdge::Index> Vertices;
+        std::vector<HalfEdge::Index> Faces;
+        std::vector<bool> VertexFlags;
+        std::vector<bool> FaceFlags;
+    } Dirty;
+
+    // buffer ranges of every face in the mesh last filled by UpdateMesh
+    struct
+    {
+        bool Valid          = false;
+        bool SharedVertices = true;
+        uint32 VertexCount  = 0;
+        std::vector<HalfEdge::Index> CornerOffsets;
+        std::vector<HalfEdge::Index> TriangleOffsets;
+    } Layout;
+
+    // picking acceleration, updated lazily by Raycast
+    mutable struct
+    {
+        BVH Tree;
+        std::vector<HalfEdge::Index> TriangleFaces;
+        bool Rebuild = true;
+        bool Refit   = false;
+    } Picking;
+
+    // reused between calls so editing does not allocate once warmed up
+    std::vector<HalfEdge::Index> scratch;
+    std::vector<std::pair<HalfEdge::Index, HalfEdge::Index>> nextLinks;
 };
 
 class HalfEdgeMeshSelection
 {
 public:
     bool IsSelected() const;
-    void Select(const HalfEdge::Face::Ref &face);
+    void Select(HalfEdge::Face face);
     void Clear();
+    void Remap(const HalfEdgeMesh::HandleRemap &remap);
 
-    void DrawLine(const std::function<void(const HalfEdgeMesh::DrawLine &)> &fn, const Vec3 &cameraPosition) const;
+    void DrawLine(
+        const HalfEdgeMesh &mesh,
+        const std::function<void(const HalfEdgeMesh::DrawLine &)> &fn,
+        const Vec3 &cameraPosition
+    ) const;
 
 public:
-    std::vector<HalfEdge::Face::Ref> SelectedFaces;
-};
\ No newline at end of file
+    std::vector<HalfEdge::Face> SelectedFaces;
+};
@@ -1,15 +1,51 @@
 #include "app.hpp"
 
 #include "../io/binary.hpp"
-#include "../io/obj.hpp"
+#include "../io/mesh.hpp"
+#include <algorithm>
 
 namespace gl
 {
-App::App() : wnd(nullptr), needRecreateSwapChain(false), imageIndex(0), currentFrame(0), maxFramesInFlight(2) {}
+// mesh files are uploaded as they are, the vertex input layout has to match
+static_assert(sizeof(App::Vertex) == sizeof(io::OBJ::Vertex), "App::Vertex must match io::OBJ::Vertex");
+static_assert(offsetof(App::Vertex, uv) == offsetof(io::OBJ::Vertex, texCoord), "App::Vertex uv must match texCoord");
+
+App::App() :
+    wnd(nullptr),
+    headless(false),
+    headlessExtent({0, 0}),
+    needRecreateSwapChain(false),
+    presentModeChanged(false),
+    imageIndex(0),
+    currentFrame(0),
+    maxFramesInFlight(2),
+    maxFrames(0),
+    framesRendered(0),
+    lastImageIndex(0),
+    indexCount(0)
+{
+}
 
 App::~App() {}
 
-void App::MaxFramesInFlight(int maxFrames) { maxFramesInFlight = maxFrames; }
+void App::MaxFramesInFlight(int maxFrames)
+{
+    if (device.handle != VK_NULL_HANDLE)
+    {
+        fmtx::Warn("Frames in flight can only be changed before Init");
+        return;
+    }
+    maxFramesInFlight = std::clamp(maxFrames, FramesInFlightMin, FramesInFlightMax);
+    if (maxFramesInFlight != maxFrames)
+        fmtx::Warn(fmt::format("{} frames in flight not supported, using {}", maxFrames, maxFramesInFlight));
+}
+
+void App::PresentMode(VkPresentModeKHR mode)
+{
+    swapChain.PreferPresentMode(mode);
+    // recreating now would pull the image of the frame being recorded away, EndFrame does it after present
+    presentModeChanged = swapChain.handle != VK_NULL_HANDLE && mode != swapChain.presentMode;
+}
 
 bool App::Init(SDL_Window *wnd)
 {
@@ -19,6 +55,16 @@ bool App::Init(SDL_Window *wnd)
     return ok;
 }
 
+bool App::InitHeadless(VkExtent2D extent)
+{
+    this->wnd      = nullptr;
+    headless       = true;
+    headlessExtent = extent;
+    bool ok        = InitGL();
+    if (!ok) ShutdownGL();
+    return ok;
+}
+
 void App::Shutdown()
 {
     fmtx::Info("Shutting down Vulkan");
@@ -27,13 +73,34 @@ void App::Shutdown()
 
 App::State App::BeginFrame()
 {
+    // time the CPU waits for the GPU, it belongs to the frame that is closed below
+    profiler.BeginCpuScope("Wait for frame");
     device.WaitForFences(1, &inFlightFences.handles[currentFrame]);
+    pacing.fenceWait = profiler.EndCpuScope();
+    pacing.frame     = frameClock.ElapsedMilliseconds();
+    frameClock.Restart();
+    profiler.BeginFrame(currentFrame);
+    stagingRing.Update();
+    if (!recorder.BeginFrame(currentFrame)) return State::Error;
+    pacing.acquire   = 0;
+    pacing.imageWait = 0;
+    pacing.present   = 0;
+
+    if (headless)
+    {
+        // one offscreen target per frame in flight, nothing to acquire
+        imageIndex = currentFrame;
+        inFlightFences.Reset(currentFrame, device);
+        return State::Ok;
+    }
 
     // VkResult nextResult = swapChain.AcquireNextImageWithTimeout(device, &imageIndex,
     // imageAvailableSemaphores.handles[currentFrame]);
+    profiler.BeginCpuScope("Acquire image");
     VkResult nextResult = swapChain.AcquireNextImage(
         device, &imageIndex, imageAvailableSemaphores.handles[currentFrame]
     );
+    pacing.acquire = profiler.EndCpuScope();
     if (nextResult == VK_TIMEOUT)
     {
         fmtx::Error("Failed to acquire swap chain image - timeout");
@@ -51,9 +118,12 @@ App::State App::BeginFrame()
         return State::Error;
     }
 
+    // with more images than frames in flight the image can still belong to a frame on another slot
     if (imagesInFlight[imageIndex] != VK_NULL_HANDLE)
     {
+        profiler.BeginCpuScope("Wait for image");
         device.WaitForFences(1, &imagesInFlight[imageIndex]);
+        pacing.imageWait = profiler.EndCpuScope();
     }
 
     imagesInFlight[imageIndex] = inFlightFences.handles[currentFrame];
@@ -65,6 +135,23 @@ App::State App::BeginFrame()
 
 App::State App::EndFrame()
 {
+    profiler.Submitted();
+    if (headless)
+    {
+        device.graphicsQueue.Clear();
+        if (device.graphicsQueue.Submit(commandBuffers.handles[currentFrame], inFlightFences.handles[currentFrame]) !=
+            VK_SUCCESS)
+        {
+            fmtx::Error("Failed to submit draw command buffer");
+            return State::Error;
+        }
+
+        lastImageIndex = imageIndex;
+        ++framesRendered;
+        currentFrame = (currentFrame + 1) % maxFramesInFlight;
+        return State::Ok;
+    }
+
     device.graphicsQueue.Clear();
     device.graphicsQueue.AddWaitSemaphore(imageAvailableSemaphores.handles[currentFrame]);
     device.graphicsQueue.AddSignalSemaphore(renderFinishedSemaphores.handles[imageIndex]);
@@ -76,15 +163,18 @@ App::State App::EndFrame()
         return State::Error;
     }
 
+    profiler.BeginCpuScope("Present");
     device.presentQueue.Clear();
     device.presentQueue.AddWaitSemaphore(renderFinishedSemaphores.handles[imageIndex]);
     device.presentQueue.AddSwapChain(swapChain.handle);
     device.presentQueue.AddImageIndex(imageIndex);
     VkResult presentResult = device.presentQueue.Present();
+    pacing.present         = profiler.EndCpuScope();
 
-    if (presentResult == VK_ERROR_OUT_OF_DATE_KHR || needRecreateSwapChain)
+    if (presentResult == VK_ERROR_OUT_OF_DATE_KHR || needRecreateSwapChain || presentModeChanged)
     {
-        if (!needRecreateSwapChain) fmtx::Error(fmt::format("Vulkan queue present returned out of date"));
+        if (presentResult == VK_ERROR_OUT_OF_DATE_KHR && !needRecreateSwapChain)
+            fmtx::Error(fmt::format("Vulkan queue present returned out of date"));
 
         needRecreateSwapChain = false;
         RecreateSwapChain();
@@ -101,10 +191,46 @@ App::State App::EndFrame()
         return State::Error;
     }
 
+    lastImageIndex = imageIndex;
+    ++framesRendered;
     currentFrame = (currentFrame + 1) % maxFramesInFlight;
     return State::Ok;
 }
 
+bool App::ReadPixels(io::Image &image)
+{
+    if (!headless || framesRendered == 0)
+    {
+        fmtx::Error("Readback needs a headless app with at least one rendered frame");
+        return false;
+    }
+
+    // the last frame is only waited for here, rendering itself never blocks on readback
+    device.WaitIdle();
+
+    auto &target = offscreenImages[lastImageIndex];
+    VkCommandBuffer commandBuffer;
+    if (commandPool.BeginSingleTimeCommands(device, &commandBuffer) != VK_SUCCESS)
+    {
+        fmtx::Error("Failed to begin single time commands");
+        return false;
+    }
+    target.CmdTransitionLayout(
+        commandBuffer, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
+    );
+    target.CmdCopyToBuffer(commandBuffer, readbackBuffer.handle, 0, swapChain.extent);
+    // the render pass starts from an undefined layout, the target needs no transition back
+    if (commandPool.EndSingleTimeCommands(device, device.graphicsQueue.handle, commandBuffer) != VK_SUCCESS)
+    {
+        fmtx::Error("Failed to end single time commands");
+        return false;
+    }
+
+    if (!image.Create(int32(swapChain.extent.width), int32(swapChain.extent.height))) return false;
+
+    return readbackBuffer.Read(allocator, image.GetPixelData(), image.Size());
+}
+
 bool App::Render(Mat4 mvp)
 {
     commandBuffers.Reset(currentFrame);
@@ -116,19 +242,25 @@ bool App::Render(Mat4 mvp)
     float time             = SDL_GetTicks() / 1000.0f;
     ubos[currentFrame].mvp = mvp;
 
-    uniformBuffersMemory[currentFrame].CopyRaw(device, &ubos[currentFrame], sizeof(ubos[currentFrame]));
+    uniformBuffers[currentFrame].Write(allocator, &ubos[currentFrame], sizeof(ubos[currentFrame]));
     commandBuffers.ClearColor({0.0f, 0.0f, 0.0f, 1.0f});
     commandBuffers.ClearDepthStencil();
     commandBuffers.CmdBeginRenderPass(currentFrame, renderPass, swapChainFramebuffers[imageIndex], swapChain.extent);
-    commandBuffers.CmdBindGraphicsPipeline(currentFrame, graphicsPipeline);
     commandBuffers.CmdViewport(currentFrame, {0, 0}, swapChain.extent);
     commandBuffers.CmdScissor(currentFrame, {0, 0}, swapChain.extent);
-    commandBuffers.CmdBindDescriptorSet(
-        currentFrame, graphicsPipeline, descriptorPool.descriptorSets[currentFrame].handle
-    );
-    commandBuffers.CmdBindVertexBuffer(currentFrame, vertexBuffer);
-    commandBuffers.CmdBindIndexBuffer(currentFrame, indexBuffer);
-    commandBuffers.CmdDrawIndexed(currentFrame, static_cast<uint32_t>(indices.size()));
+    // nothing to draw the mesh with until its pipeline finishes compiling
+    if (auto *pipeline = pipelineCompiler.Select(graphicsPipeline))
+    {
+        commandBuffers.CmdBeginDebugLabel(currentFrame, "Mesh", glm::value_ptr(CYAN));
+        commandBuffers.CmdBindGraphicsPipeline(currentFrame, *pipeline);
+        commandBuffers.CmdBindDescriptorSet(
+            currentFrame, *pipeline, descriptorPool.descriptorSets[currentFrame].handle
+        );
+        commandBuffers.CmdBindVertexBuffer(currentFrame, vertexBuffer);
+        commandBuffers.CmdBindIndexBuffer(currentFrame, indexBuffer);
+        commandBuffers.CmdDrawIndexed(currentFrame, indexCount);
+        commandBuffers.CmdEndDebugLabel(currentFrame);
+    }
 
     commandBuffers.CmdEndRenderPass(currentFrame);
     if (commandBuffers.End(currentFrame) != VK_SUCCESS)
@@ -142,11 +274,20 @@ bool App::Render(Mat4 mvp)
 
 bool App::InitGL()
 {
-    instance.SetExtensions(sdl::GetVulkanExtensions(wnd, true));
+    if (headless)
+    {
+        gl::CStrings extensions = {VK_EXT_DEBUG_UTILS_EXTENSION_NAME};
+#ifdef __APPLE__
+        extensions.emplace_back(VK_KHR_PORTABILITY_ENUMERATION_EXTENSION_NAME);
+#endif
+        instance.SetExtensions(extensions);
+    }
+    else
+        instance.SetExtensions(sdl::GetVulkanExtensions(wnd, true));
     instance.EnableValidationLayers();
     if (!instance.Create()) return false;
 
-    if (!surface.Create(instance, wnd)) return false;
+    if (!headless && !surface.Create(instance, wnd)) return false;
 
     auto devices   = gl::GetPhysicalDevices(instance, surface);
     physicalDevice = gl::SelectBestPhysicalDevice(devices);
@@ -156,45 +297,55 @@ bool App::InitGL()
         return false;
     }
 
-    device.RequireSwapchainExtension();
+    if (!headless) device.RequireSwapchainExtension();
     device.RequireDynamicRendering();
+    device.RequireTimelineSemaphore();
     device.EnableValidationLayers();
+    bool memoryBudget = physicalDevice.IsExtensionSupported({VK_EXT_MEMORY_BUDGET_EXTENSION_NAME});
+    if (memoryBudget) device.SetRequiredExtensions({VK_EXT_MEMORY_BUDGET_EXTENSION_NAME});
     if (!device.Create(physicalDevice)) return false;
 
     vk::InitFunctions(instance.handle, device.handle);
 
+    if (memoryBudget) allocator.EnableMemoryBudget();
     if (!allocator.Create(instance.handle, physicalDevice.handle, device.handle)) return false;
 
-    if (!swapChain.Create(device, surface, physicalDevice)) return false;
+    pipelineCache.label = "Pipeline Cache";
+    if (!pipelineCache.Create(device, physicalDevice, "pipeline_cache.bin")) return false;
+    if (!pipelineCompiler.Create(device, pipelineCache)) return false;
 
-    imageViews.resize(swapChain.images.size());
-    for (size_t i = 0; i < swapChain.images.size(); i++)
+    if (headless)
     {
-        imageViews[i].label = fmt::format("Swapchain Image View {}", i);
-        if (!imageViews[i].Create(device, swapChain.images[i], swapChain.imageFormat)) return false;
+        if (!CreateOffscreenTargets()) return false;
+    }
+    else
+    {
+        if (!swapChain.Create(device, surface, physicalDevice)) return false;
+
+        imageViews.resize(swapChain.images.size());
+        for (size_t i = 0; i < swapChain.images.size(); i++)
+        {
+            imageViews[i].label = fmt::format("Swapchain Image View {}", i);
+            if (!imageViews[i].Create(device, swapChain.images[i], swapChain.imageFormat)) return false;
+        }
     }
 
     depthImage.UsageDepthOnly();
     depthImage.label = "Depth Image";
-    if (!depthImage.Create(device, swapChain.extent, physicalDevice.depthFormat)) return false;
-    if (!depthImageMemory.Allocate(
-            physicalDevice, device, depthImage.MemoryRequirements(device), VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
-        ))
-        return false;
-    depthImage.BindMemory(device, depthImageMemory, 0);
+    if (!depthImage.Create(allocator, swapChain.extent, physicalDevice.depthFormat)) return false;
     depthImageView.AspectMaskDepth();
     depthImageView.label = "Depth Image View";
     if (!depthImageView.Create(device, depthImage, physicalDevice.depthFormat)) return false;
 
-    auto shaderVert = io::BinaryFile::Load("dummy.vert.spv");
-    auto shaderFrag = io::BinaryFile::Load("dummy.frag.spv");
+    auto shaderVert = io::MappedFile::Open("dummy.vert.spv");
+    auto shaderFrag = io::MappedFile::Open("dummy.frag.spv");
     if (shaderVert->IsEmpty() || shaderFrag->IsEmpty())
     {
         fmtx::Error("Failed to load shader files");
         return false;
     }
-    shaderModules.vert = gl::CreateShaderModule(device, shaderVert->Bytes());
-    shaderModules.frag = gl::CreateShaderModule(device, shaderFrag->Bytes());
+    shaderModules.vert = gl::CreateShaderModule(device, shaderVert->View());
+    shaderModules.frag = gl::CreateShaderModule(device, shaderFrag->View());
     if (shaderModules.vert == VK_NULL_HANDLE || shaderModules.frag == VK_NULL_HANDLE)
     {
         fmtx::Error("Failed to create shader modules");
@@ -205,8 +356,8 @@ bool App::InitGL()
     renderPass.label = "ColorPass";
     if (!renderPass.Create(device, shaderModules)) return false;
 
-    swapChainFramebuffers.resize(swapChain.images.size());
-    for (auto i = 0; i < swapChain.images.size(); i++)
+    swapChainFramebuffers.resize(imageViews.size());
+    for (auto i = 0; i < imageViews.size(); i++)
     {
         swapChainFramebuffers[i].ClearAttachments();
         swapChainFramebuffers[i].AddAttachment(imageViews[i]);
@@ -216,23 +367,13 @@ bool App::InitGL()
 
     VkDeviceSize uboBufferSize = sizeof(UniformBufferObject);
     uniformBuffers.resize(maxFramesInFlight);
-    uniformBuffersMemory.resize(maxFramesInFlight);
     ubos.resize(maxFramesInFlight);
     for (auto i = 0; i < maxFramesInFlight; i++)
     {
         uniformBuffers[i].Usage(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
         uniformBuffers[i].label = fmt::format("UBO {}", i);
-        if (!uniformBuffers[i].Create(device, uboBufferSize)) return false;
-        VkMemoryRequirements uboMemRequirements = uniformBuffers[i].MemoryRequirements(device);
-        if (!uniformBuffersMemory[i].Allocate(
-                physicalDevice,
-                device,
-                uboMemRequirements,
-                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
-            ))
-            return false;
-        uniformBuffers[i].BindMemory(device, uniformBuffersMemory[i], 0);
-        uniformBuffersMemory[i].Map(device, 0, uboBufferSize);
+        uniformBuffers[i].HostMapped();
+        if (!uniformBuffers[i].Create(allocator, uboBufferSize)) return false;
     }
 
     graphicsPipeline.AddShaderStage(VK_SHADER_STAGE_VERTEX_BIT, shaderModules.vert);
@@ -265,184 +406,83 @@ bool App::InitGL()
 
     if (!graphicsPipeline.CreateLayout(device)) return false;
 
-    if (!graphicsPipeline.Create(device)) return false;
+    graphicsPipeline.label = "Graphics Pipeline";
+    pipelineCompiler.Compile(graphicsPipeline);
 
     if (!commandPool.Create(device, physicalDevice.queueFamilyIndices.graphicsFamily.value())) return false;
 
-    shortLivedCommandPool.TransientOnly();
-    if (!shortLivedCommandPool.Create(device, physicalDevice.queueFamilyIndices.graphicsFamily.value())) return false;
+    if (!stagingRing.Create(device, allocator, VkDeviceSize(32) * 1024 * 1024)) return false;
 
     if (!commandBuffers.Allocate(device, commandPool, maxFramesInFlight)) return false;
 
+    if (!recorder.Create(device, physicalDevice.queueFamilyIndices.graphicsFamily.value(), maxFramesInFlight))
+        return false;
+
+    if (!profiler.Create(device, physicalDevice, maxFramesInFlight)) return false;
+    commandBuffers.AttachProfiler(&profiler);
+
     if (!imageAvailableSemaphores.Create(device, maxFramesInFlight)) return false;
 
     imagesInFlight.clear();
-    imagesInFlight.resize(swapChain.images.size(), VK_NULL_HANDLE);
-    if (!renderFinishedSemaphores.Create(device, swapChain.images.size())) return false;
+    imagesInFlight.resize(imageViews.size(), VK_NULL_HANDLE);
+    if (!renderFinishedSemaphores.Create(device, imageViews.size())) return false;
 
     if (!inFlightFences.Create(device, maxFramesInFlight)) return false;
 
-    vertices = {
-        {{-0.5f, -0.5f, 0.0f}, {1.0f, 0.0f, 0.0f}, {0.0f, 0.0f}},
-        {{0.5f, -0.5f, 0.0f}, {0.0f, 1.0f, 0.0f}, {1.0f, 0.0f}},
-        {{0.5f, 0.5f, 0.0f}, {0.0f, 0.0f, 1.0f}, {1.0f, 1.0f}},
-        {{-0.5f, 0.5f, 0.0f}, {1.0f, 1.0f, 1.0f}, {0.0f, 1.0f}},
+    // the texture is read on an I/O thread and decoded while the mesh loads, the reader finishes before the decoder
+    Parallel::Pool decoder(1);
+    io::AsyncReader reader;
+    auto pendingImage = io::Image::LoadAsync("viking_room.png", reader, decoder);
 
-        {{-0.5f, -0.5f, -0.5f}, {1.0f, 0.0f, 0.0f}, {0.0f, 0.0f}},
-        {{0.5f, -0.5f, -0.5f}, {0.0f, 1.0f, 0.0f}, {1.0f, 0.0f}},
-        {{0.5f, 0.5f, -0.5f}, {0.0f, 0.0f, 1.0f}, {1.0f, 1.0f}},
-        {{-0.5f, 0.5f, -0.5f}, {1.0f, 1.0f, 1.0f}, {0.0f, 1.0f}}
-    };
-    indices = {0, 1, 2, 2, 3, 0, 4, 5, 6, 6, 7, 4};
-
-    io::OBJ obj;
-    if (!obj.Load("viking_room.obj"))
+    // on a warm cache the mapped blobs are the staging source, nothing is parsed or copied in between
+    auto mesh = io::MeshFile::LoadCached("viking_room.obj");
+    if (mesh->IsEmpty())
     {
-        fmtx::Error("Failed to load obj");
+        fmtx::Error("Failed to load mesh");
         return false;
     }
-    auto mesh = obj.GetMesh();
-    vertices.clear();
-    indices.clear();
-    vertices.reserve(mesh.vertices.size());
-    indices.reserve(mesh.indices.size());
-    for (const auto &v : mesh.vertices) vertices.push_back({v.pos, v.color, v.texCoord});
-
-    for (const auto &i : mesh.indices) indices.push_back(i);
-
-    stagingBuffer.Usage(VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
-    if (!stagingBuffer.Create(device, sizeof(vertices[0]) * vertices.size())) return false;
-    VkMemoryRequirements memRequirements = stagingBuffer.MemoryRequirements(device);
-    if (!stagingBufferMemory.Allocate(
-            physicalDevice,
-            device,
-            memRequirements,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
-        ))
-        return false;
-
-    stagingBuffer.BindMemory(device, stagingBufferMemory, 0);
-    stagingBufferMemory.Map(device, 0, stagingBuffer.Size());
-    stagingBufferMemory.CopyRaw(device, vertices.data(), stagingBuffer.Size());
-    stagingBufferMemory.Unmap(device);
-
-    vertexBuffer.Usage(VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
-    vertexBuffer.label = "VertexBuffer";
-    if (!vertexBuffer.Create(device, stagingBuffer.Size())) return false;
-    if (!vertexBufferMemory.Allocate(physicalDevice, device, memRequirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT))
-        return false;
-    vertexBuffer.BindMemory(device, vertexBufferMemory, 0);
-
-    gl::CopyBuffer(
-        device,
-        shortLivedCommandPool.handle,
-        device.graphicsQueue.handle,
-        stagingBuffer,
-        vertexBuffer,
-        stagingBuffer.Size()
-    );
-
-    stagingBuffer.Destroy(device);
-    stagingBufferMemory.Free(device);
-
-    indexStagingBuffer.Usage(VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
-    indexStagingBuffer.label = "indexStagingBuffer";
-    if (!indexStagingBuffer.Create(device, sizeof(indices[0]) * indices.size())) return false;
-    auto indexMemRequirements = indexStagingBuffer.MemoryRequirements(device);
-    if (!indexStagingBufferMemory.Allocate(
-            physicalDevice,
-            device,
-            indexMemRequirements,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
-        ))
-        return false;
+    indexCount = mesh->IndexCount();
 
-    indexStagingBuffer.BindMemory(device, indexStagingBufferMemory, 0);
-    indexStagingBufferMemory.Map(device, 0, indexStagingBuffer.Size());
-    indexStagingBufferMemory.CopyRaw(device, indices.data(), indexStagingBuffer.Size());
-    indexStagingBufferMemory.Unmap(device);
-
-    indexBuffer.Usage(VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
-    indexBuffer.label = "IndexBuffer";
-    if (!indexBuffer.Create(device, indexStagingBuffer.Size())) return false;
-    if (!indexBufferMemory.Allocate(physicalDevice, device, indexMemRequirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT))
-        return false;
-
-    indexBuffer.BindMemory(device, indexBufferMemory, 0);
-
-    gl::CopyBuffer(
-        device,
-        shortLivedCommandPool.handle,
-        device.graphicsQueue.handle,
-        indexStagingBuffer,
-        indexBuffer,
-        indexStagingBuffer.Size()
-    );
-
-    indexStagingBuffer.Destroy(device);
-    indexStagingBufferMemory.Free(device);
-
-    gl::Buffer imageStagingBuffer;
-    gl::Memory imageStagingMemory;
-    io::Image rawImage;
-    if (!rawImage.Load("viking_room.png"))
+    auto rawImage = pendingImage.get();
+    if (rawImage->IsEmpty())
     {
         fmtx::Error("Failed to load image");
         return false;
     }
 
-    imageStagingBuffer.Usage(VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
-    if (!imageStagingBuffer.Create(device, rawImage.Size())) return false;
-
-    if (!imageStagingMemory.Allocate(
-            physicalDevice,
-            device,
-            imageStagingBuffer.MemoryRequirements(device),
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
-        ))
-        return false;
+    vertexBuffer.Usage(VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+    vertexBuffer.label = "VertexBuffer";
+    if (!vertexBuffer.Create(allocator, mesh->VertexDataSize())) return false;
 
-    imageStagingBuffer.BindMemory(device, imageStagingMemory, 0);
-    imageStagingMemory.Map(device, 0, rawImage.Size());
-    imageStagingMemory.CopyRaw(device, rawImage.GetPixelData(), rawImage.Size());
-    imageStagingMemory.Unmap(device);
+    indexBuffer.Usage(VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+    indexBuffer.label = "IndexBuffer";
+    if (!indexBuffer.Create(allocator, mesh->IndexDataSize())) return false;
 
-    texture.MipLevels(rawImage.RecommendedMipLevels());
+    texture.MipLevels(rawImage->RecommendedMipLevels());
     texture.Usage(VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT);
-    if (!texture.Create(device, rawImage.Extent(), VK_FORMAT_R8G8B8A8_SRGB)) return false;
-    if (!textureMemory.Allocate(
-            physicalDevice, device, texture.MemoryRequirements(device), VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+    if (!texture.Create(allocator, rawImage->Extent(), VK_FORMAT_R8G8B8A8_SRGB)) return false;
+
+    // all assets go out in one submission, frames are queued behind it so the CPU never waits for the copies
+    gl::UploadBatch uploads(stagingRing);
+    if (!uploads.CopyToBuffer(vertexBuffer, mesh->Vertices(), mesh->VertexDataSize())) return false;
+    if (!uploads.CopyToBuffer(indexBuffer, mesh->Indices(), mesh->IndexDataSize())) return false;
+    if (!uploads.CopyToImage(
+            texture,
+            rawImage->GetPixelData(),
+            rawImage->Size(),
+            rawImage->Extent(),
+            physicalDevice.TrySampledImageFilterLinear(VK_FORMAT_R8G8B8A8_SRGB)
         ))
         return false;
-
-    texture.BindMemory(device, textureMemory, 0);
-    texture.TransitionLayout(
-        device,
-        shortLivedCommandPool,
-        device.graphicsQueue.handle,
-        VK_IMAGE_LAYOUT_UNDEFINED,
-        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
-    );
-    texture.CopyFromBuffer(
-        device, shortLivedCommandPool, device.graphicsQueue.handle, imageStagingBuffer, rawImage.Extent()
-    );
-
-    imageStagingBuffer.Destroy(device);
-    imageStagingMemory.Free(device);
-
-    texture.GenerateMipmaps(
-        device,
-        shortLivedCommandPool,
-        device.graphicsQueue.handle,
-        physicalDevice.TrySampledImageFilterLinear(VK_FORMAT_R8G8B8A8_SRGB)
-    );
+    auto uploaded = uploads.Submit();
+    if (uploaded == 0 || !stagingRing.Acquire(uploaded)) return false;
 
     if (!textureView.Create(device, texture, VK_FORMAT_R8G8B8A8_SRGB)) return false;
 
     textureSampler.MaxAnisotropy(physicalDevice);
     textureSampler.LinearFilter();
     textureSampler.LinearMipmap();
-    textureSampler.MaxLod(rawImage.RecommendedMipLevels());
+    textureSampler.MaxLod(rawImage->RecommendedMipLevels());
     if (!textureSampler.Create(device)) return false;
 
     descriptorPool.AddPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, maxFramesInFlight);
@@ -466,6 +506,46 @@ bool App::InitGL()
     }
     fmtx::Info("Descriptor sets updated");
 
+    auto budget = allocator.DeviceLocalBudget();
+    fmtx::Info(fmt::format(
+        "GPU memory: {} allocations in {} blocks, {} MB used of {} MB budget",
+        budget.allocationCount,
+        budget.blockCount,
+        budget.usage / (1024 * 1024),
+        budget.budget / (1024 * 1024)
+    ));
+
+    return true;
+}
+
+bool App::CreateOffscreenTargets()
+{
+    // RGBA so a readback maps onto io::Image without swizzling
+    swapChain.extent      = headlessExtent;
+    swapChain.imageFormat = VK_FORMAT_R8G8B8A8_SRGB;
+
+    offscreenImages.resize(maxFramesInFlight);
+    imageViews.resize(maxFramesInFlight);
+    for (int i = 0; i < maxFramesInFlight; i++)
+    {
+        offscreenImages[i].Usage(VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT);
+        offscreenImages[i].label = fmt::format("Offscreen Image {}", i);
+        if (!offscreenImages[i].Create(allocator, swapChain.extent, swapChain.imageFormat)) return false;
+
+        imageViews[i].label = fmt::format("Offscreen Image View {}", i);
+        if (!imageViews[i].Create(device, offscreenImages[i], swapChain.imageFormat)) return false;
+    }
+
+    readbackBuffer.Usage(VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+    readbackBuffer.HostReadback();
+    readbackBuffer.label = "Readback Buffer";
+    if (!readbackBuffer.Create(allocator, VkDeviceSize(swapChain.extent.width) * swapChain.extent.height * 4))
+        return false;
+
+    fmtx::Info(fmt::format(
+        "Rendering headless into {}x{} offscreen images", swapChain.extent.width, swapChain.extent.height
+    ));
+
     return true;
 }
 
@@ -479,8 +559,7 @@ bool App::RecreateSwapChain()
     for (int i = 0; i < swapChainFramebuffers.size(); i++) swapChainFramebuffers[i].Destroy(device);
 
     depthImageView.Destroy(device);
-    depthImage.Destroy(device);
-    depthImageMemory.Free(device);
+    depthImage.Destroy(allocator);
 
     for (auto i = 0; i < imageViews.size(); i++) imageViews[i].Destroy(device);
 
@@ -488,7 +567,8 @@ bool App::RecreateSwapChain()
     imageViews.clear();
     swapChain.Destroy(device);
 
-    // recreate swap chain
+    // recreate swap chain, picks up a changed present mode as well
+    presentModeChanged = false;
     physicalDevice.QuerySwapChainSupport(surface);
 
     if (!swapChain.Create(device, surface, physicalDevice))
@@ -511,19 +591,11 @@ bool App::RecreateSwapChain()
 
     // recreate depth image
     depthImage.UsageDepthOnly();
-    if (!depthImage.Create(device, swapChain.extent, physicalDevice.depthFormat))
+    if (!depthImage.Create(allocator, swapChain.extent, physicalDevice.depthFormat))
     {
         fmtx::Error("Failed to recreate depth image");
         result = false;
     }
-    if (!depthImageMemory.Allocate(
-            physicalDevice, device, depthImage.MemoryRequirements(device), VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
-        ))
-    {
-        fmtx::Error("Failed to allocate depth image memory");
-        result = false;
-    }
-    depthImage.BindMemory(device, depthImageMemory, 0);
     depthImageView.AspectMaskDepth();
     if (!depthImageView.Create(device, depthImage, physicalDevice.depthFormat))
     {
@@ -564,23 +636,19 @@ void App::ShutdownGL()
 
     textureSampler.Destroy(device);
     textureView.Destroy(device);
-    texture.Destroy(device);
-    textureMemory.Free(device);
-    for (size_t i = 0; i < maxFramesInFlight; i++)
-    {
-        uniformBuffers[i].Destroy(device);
-        uniformBuffersMemory[i].Free(device);
-    }
-    indexBuffer.Destroy(device);
-    indexBufferMemory.Free(device);
-    vertexBuffer.Destroy(device);
-    vertexBufferMemory.Free(device);
+    texture.Destroy(allocator);
+    for (size_t i = 0; i < uniformBuffers.size(); i++) uniformBuffers[i].Destroy(allocator);
+    indexBuffer.Destroy(allocator);
+    vertexBuffer.Destroy(allocator);
     imageAvailableSemaphores.Destroy(device);
     renderFinishedSemaphores.Destroy(device);
     inFlightFences.Destroy(device);
     imagesInFlight.clear();
 
-    shortLivedCommandPool.Destroy(device);
+    stagingRing.Destroy();
+    pipelineCompiler.Destroy();
+    profiler.Destroy(device);
+    recorder.Destroy(device);
     commandPool.Destroy(device);
     for (int i = 0; i < swapChainFramebuffers.size(); i++) swapChainFramebuffers[i].Destroy(device);
     graphicsPipeline.Destroy(device);
@@ -591,10 +659,13 @@ void App::ShutdownGL()
     gl::DestroyShaderModule(device, shaderModules.vert);
     gl::DestroyShaderModule(device, shaderModules.frag);
     depthImageView.Destroy(device);
-    depthImage.Destroy(device);
-    depthImageMemory.Free(device);
+    depthImage.Destroy(allocator);
     for (auto i = 0; i < imageViews.size(); i++) imageViews[i].Destroy(device);
+    for (auto i = 0; i < offscreenImages.size(); i++) offscreenImages[i].Destroy(allocator);
+    readbackBuffer.Destroy(allocator);
     swapChain.Destroy(device);
+    pipelineCache.Save(device);
+    pipelineCache.Destroy(device);
 
     allocator.Destroy();
     device.Destroy();
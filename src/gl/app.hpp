@@ -26,12 +26,37 @@ public:
     {
         Mat4 mvp;
     };
+    // milliseconds the render thread spent blocked in the last frame
+    struct FramePacing
+    {
+        // slot reuse, the GPU is still maxFramesInFlight frames behind
+        double fenceWait = 0;
+        // presentation engine had no free image
+        double acquire = 0;
+        // acquired image is still rendered to by an older frame
+        double imageWait = 0;
+        double present   = 0;
+        // BeginFrame to BeginFrame
+        double frame = 0;
+
+        double Stalled() const { return fenceWait + acquire + imageWait; }
+    };
+    static constexpr int FramesInFlightMin = 1;
+    static constexpr int FramesInFlightMax = 4;
+
     App();
     ~App();
 
+    // 1 to 4, before Init, every per frame resource is sized by it
     void MaxFramesInFlight(int maxFrames);
     int MaxFramesInFlight() const { return maxFramesInFlight; }
+    // before Init or at runtime, the swap chain is recreated after the current frame is presented
+    void PresentMode(VkPresentModeKHR mode);
+    VkPresentModeKHR PresentMode() const { return swapChain.presentMode; }
+    const FramePacing &Pacing() const { return pacing; }
     bool Init(SDL_Window *wnd);
+    // no window, surface or swap chain, frames are rendered into offscreen images of the given size
+    bool InitHeadless(VkExtent2D extent);
     void Shutdown();
     bool Render(Mat4 mvp);
     State BeginFrame();
@@ -39,16 +64,32 @@ public:
     State EndFrame();
     void RequestRecreateSwapChain(bool recreate) { needRecreateSwapChain = recreate; }
     uint32_t ImageIndex() const { return imageIndex; }
+    bool IsHeadless() const { return headless; }
+    // 0 renders until the caller stops, otherwise Finished() turns true after that many frames
+    void MaxFrames(uint64_t frames) { maxFrames = frames; }
+    bool Finished() const { return maxFrames > 0 && framesRendered >= maxFrames; }
+    uint64_t FramesRendered() const { return framesRendered; }
+    // headless only, waits for the GPU and copies the last submitted frame into an RGBA image
+    bool ReadPixels(io::Image &image);
 
 private:
     bool InitGL();
     bool RecreateSwapChain();
+    bool CreateOffscreenTargets();
     void ShutdownGL();
 
 private:
     SDL_Window *wnd;
+    bool headless;
+    VkExtent2D headlessExtent;
     bool needRecreateSwapChain;
+    bool presentModeChanged;
     int maxFramesInFlight;
+    uint64_t maxFrames;
+    uint64_t framesRendered;
+    uint32_t lastImageIndex;
+    FramePacing pacing;
+    sdl::Stopwatch frameClock;
 
     std::uint32_t imageIndex;
     std::uint32_t currentFrame;
@@ -59,39 +100,37 @@ public:
     gl::Allocator allocator;
     gl::Surface surface;
     gl::PhysicalDevice physicalDevice;
+    // swapChain.extent and imageFormat describe the offscreen targets when headless
     gl::SwapChain swapChain;
+    std::vector<gl::Image> offscreenImages;
+    gl::Buffer readbackBuffer;
     gl::RenderPass renderPass;
     std::vector<gl::ImageView> imageViews;
     gl::ShaderModules shaderModules;
+    gl::PipelineCache pipelineCache;
+    gl::PipelineCompiler pipelineCompiler;
     gl::Pipeline graphicsPipeline;
     std::vector<gl::Framebuffer> swapChainFramebuffers;
     gl::CommandPool commandPool;
-    gl::CommandPool shortLivedCommandPool;
+    gl::StagingRing stagingRing;
     gl::CommandBuffer commandBuffers;
+    // secondary buffers for passes recorded on several threads, e.g. scene chunks inside renderPass
+    gl::CommandRecorder recorder;
+    gl::Profiler profiler;
     gl::Semaphore imageAvailableSemaphores;
     gl::Semaphore renderFinishedSemaphores;
     gl::Fence inFlightFences;
     std::vector<VkFence> imagesInFlight;
 
-    std::vector<Vertex> vertices;
-    std::vector<uint32> indices;
+    uint32_t indexCount;
     gl::Buffer vertexBuffer;
-    gl::Memory vertexBufferMemory;
-    gl::Buffer stagingBuffer;
-    gl::Memory stagingBufferMemory;
     gl::Buffer indexBuffer;
-    gl::Memory indexBufferMemory;
-    gl::Buffer indexStagingBuffer;
-    gl::Memory indexStagingBufferMemory;
     gl::Image texture;
-    gl::Memory textureMemory;
     gl::ImageView textureView;
     gl::Image depthImage;
-    gl::Memory depthImageMemory;
     gl::ImageView depthImageView;
     gl::Sampler textureSampler;
     std::vector<gl::Buffer> uniformBuffers;
-    std::vector<gl::Memory> uniformBuffersMemory;
     std::vector<UniformBufferObject> ubos;
     gl::DescriptorPool descriptorPool;
 };
@@ -1,89 +1,85 @@
 #include "buffer.hpp"
-#include "memory.hpp"
 #include "vulkan.hpp"
 
 namespace gl
 {
-Buffer::Buffer() : handle(VK_NULL_HANDLE), createInfo({})
+Buffer::Buffer() :
+    handle(VK_NULL_HANDLE),
+    createInfo({}),
+    allocationCreateInfo({}),
+    allocation(VK_NULL_HANDLE),
+    allocationInfo({})
 {
     createInfo.sType       = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
     createInfo.usage       = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
     createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    allocationCreateInfo.usage = VMA_MEMORY_USAGE_AUTO;
 }
 
 void Buffer::Usage(VkBufferUsageFlags usage) { createInfo.usage = usage; }
 
-bool Buffer::Create(const Device &device, VkDeviceSize size)
+void Buffer::HostMapped()
+{
+    allocationCreateInfo.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT |
+                                 VMA_ALLOCATION_CREATE_MAPPED_BIT;
+}
+
+void Buffer::HostReadback()
+{
+    allocationCreateInfo.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT;
+}
+
+bool Buffer::Create(const Allocator &allocator, VkDeviceSize size)
 {
     createInfo.size = size;
-    if (vkCreateBuffer(device.handle, &createInfo, nullptr, &handle) != VK_SUCCESS)
+    if (vmaCreateBuffer(allocator.handle, &createInfo, &allocationCreateInfo, &handle, &allocation, &allocationInfo) !=
+        VK_SUCCESS)
     {
         fmtx::Error("failed to create buffer");
         return false;
     }
 
-    if (!label.empty()) vk::SetObjectName(device.handle, (uint64_t)handle, VK_OBJECT_TYPE_BUFFER, label);
+    if (!label.empty())
+    {
+        vk::SetObjectName(allocator.device, (uint64_t)handle, VK_OBJECT_TYPE_BUFFER, label);
+        vmaSetAllocationName(allocator.handle, allocation, label.c_str());
+    }
 
     return true;
 }
 
-void Buffer::Destroy(const Device &device)
-{
-    if (handle != VK_NULL_HANDLE) vkDestroyBuffer(device.handle, handle, nullptr);
-}
-
-VkMemoryRequirements Buffer::MemoryRequirements(const Device &device) const
+void Buffer::Destroy(const Allocator &allocator)
 {
-    VkMemoryRequirements memRequirements;
-    vkGetBufferMemoryRequirements(device.handle, handle, &memRequirements);
-    return memRequirements;
+    if (handle != VK_NULL_HANDLE) vmaDestroyBuffer(allocator.handle, handle, allocation);
+    handle     = VK_NULL_HANDLE;
+    allocation = VK_NULL_HANDLE;
 }
 
 VkDeviceSize Buffer::Size() const { return createInfo.size; }
 
-void Buffer::BindMemory(const Device &device, const Memory &memory, VkDeviceSize offset)
+bool Buffer::Write(const Allocator &allocator, const void *src, VkDeviceSize size, VkDeviceSize offset)
 {
-    vkBindBufferMemory(device.handle, handle, memory.handle, offset);
+    if (allocationInfo.pMappedData == nullptr)
+    {
+        fmtx::Error("buffer memory not mapped");
+        return false;
+    }
+
+    memcpy(static_cast<char *>(allocationInfo.pMappedData) + offset, src, (size_t)size);
+    return vmaFlushAllocation(allocator.handle, allocation, offset, size) == VK_SUCCESS;
 }
 
-void CopyBuffer(
-    const Device &device,
-    VkCommandPool commandPool,
-    VkQueue queue,
-    const Buffer &srcBuffer,
-    Buffer &dstBuffer,
-    VkDeviceSize size
-)
+bool Buffer::Read(const Allocator &allocator, void *dst, VkDeviceSize size, VkDeviceSize offset) const
 {
-    VkCommandBufferAllocateInfo allocInfo{};
-    allocInfo.sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    allocInfo.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocInfo.commandPool        = commandPool;
-    allocInfo.commandBufferCount = 1;
-
-    VkCommandBuffer commandBuffer;
-    vkAllocateCommandBuffers(device.handle, &allocInfo, &commandBuffer);
-
-    VkCommandBufferBeginInfo beginInfo{};
-    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-
-    vkBeginCommandBuffer(commandBuffer, &beginInfo);
-
-    VkBufferCopy copyRegion{};
-    copyRegion.srcOffset = 0;
-    copyRegion.dstOffset = 0;
-    copyRegion.size      = size;
-    vkCmdCopyBuffer(commandBuffer, srcBuffer.handle, dstBuffer.handle, 1, &copyRegion);
-
-    vkEndCommandBuffer(commandBuffer);
-    VkSubmitInfo submitInfo{};
-    submitInfo.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers    = &commandBuffer;
+    if (allocationInfo.pMappedData == nullptr)
+    {
+        fmtx::Error("buffer memory not mapped");
+        return false;
+    }
 
-    vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE);
-    vkQueueWaitIdle(queue);
-    vkFreeCommandBuffers(device.handle, commandPool, 1, &commandBuffer);
+    if (vmaInvalidateAllocation(allocator.handle, allocation, offset, size) != VK_SUCCESS) return false;
+    memcpy(dst, static_cast<const char *>(allocationInfo.pMappedData) + offset, (size_t)size);
+    return true;
 }
 } // namespace gl
@@ -2,34 +2,35 @@
 
 #include "core.hpp"
 #include "device.hpp"
+#include "vma.hpp"
 
 namespace gl
 {
-class Memory;
-
+// Memory comes from the VMA allocator, buffers are sub-allocated from shared device memory blocks.
 class Buffer
 {
 public:
     VkBuffer handle;
     VkBufferCreateInfo createInfo;
+    VmaAllocationCreateInfo allocationCreateInfo;
+    VmaAllocation allocation;
+    VmaAllocationInfo allocationInfo;
     std::string label;
 
     Buffer();
 
     void Usage(VkBufferUsageFlags usage);
-    bool Create(const Device &device, VkDeviceSize size);
-    void Destroy(const Device &device);
-    VkMemoryRequirements MemoryRequirements(const Device &device) const;
+    // host visible and mapped for the whole buffer lifetime, meant for staging and uniform buffers
+    void HostMapped();
+    // host visible, mapped and cached for reading back what the GPU wrote
+    void HostReadback();
+    bool Create(const Allocator &allocator, VkDeviceSize size);
+    void Destroy(const Allocator &allocator);
     VkDeviceSize Size() const;
-    void BindMemory(const Device &device, const Memory &memory, VkDeviceSize offset);
+    void *MappedData() const { return allocationInfo.pMappedData; }
+    // copies into mapped memory, flushed when the memory type is not host coherent
+    bool Write(const Allocator &allocator, const void *src, VkDeviceSize size, VkDeviceSize offset = 0);
+    // copies out of mapped memory, invalidated first when the memory type is not host coherent
+    bool Read(const Allocator &allocator, void *dst, VkDeviceSize size, VkDeviceSize offset = 0) const;
 };
-
-void CopyBuffer(
-    const Device &device,
-    VkCommandPool commandPool,
-    VkQueue queue,
-    const Buffer &srcBuffer,
-    Buffer &dstBuffer,
-    VkDeviceSize size
-);
 } // namespace gl
@@ -3,7 +3,7 @@
 
 namespace gl
 {
-CommandBuffer::CommandBuffer() : allocInfo({}), clearValues(0)
+CommandBuffer::CommandBuffer() : allocInfo({}), clearValues(0), profiler(nullptr)
 {
     allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
     allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
@@ -26,7 +26,9 @@ bool CommandBuffer::Allocate(const Device &device, const CommandPool &commandPoo
 
 void CommandBuffer::Free(const Device &device, const CommandPool &commandPool)
 {
-    vkFreeCommandBuffers(device.handle, commandPool.handle, 1, handles.data());
+    if (!handles.empty())
+        vkFreeCommandBuffers(device.handle, commandPool.handle, static_cast<uint32_t>(handles.size()), handles.data());
+    handles.clear();
 }
 
 VkResult CommandBuffer::Begin(uint32_t cmdBufferIndex, VkCommandBufferUsageFlags flags)
@@ -36,10 +38,41 @@ VkResult CommandBuffer::Begin(uint32_t cmdBufferIndex, VkCommandBufferUsageFlags
     beginInfo.flags            = flags;
     beginInfo.pInheritanceInfo = nullptr;
 
+    auto result = vkBeginCommandBuffer(handles[cmdBufferIndex], &beginInfo);
+    if (result == VK_SUCCESS && profiler != nullptr && !IsSecondary())
+        profiler->CmdBeginFrame(handles[cmdBufferIndex], cmdBufferIndex);
+
+    return result;
+}
+
+VkResult CommandBuffer::BeginSecondary(
+    uint32_t cmdBufferIndex,
+    const RenderPass &renderPass,
+    const Framebuffer *framebuffer,
+    uint32_t subpass
+)
+{
+    VkCommandBufferInheritanceInfo inheritanceInfo{};
+    inheritanceInfo.sType       = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inheritanceInfo.renderPass  = renderPass.handle;
+    inheritanceInfo.subpass     = subpass;
+    inheritanceInfo.framebuffer = framebuffer != nullptr ? framebuffer->handle : VK_NULL_HANDLE;
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType            = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+    beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+    // frame timestamps belong to the primary buffer, a secondary only carries its debug label scopes
     return vkBeginCommandBuffer(handles[cmdBufferIndex], &beginInfo);
 }
 
-VkResult CommandBuffer::End(uint32_t cmdBufferIndex) { return vkEndCommandBuffer(handles[cmdBufferIndex]); }
+VkResult CommandBuffer::End(uint32_t cmdBufferIndex)
+{
+    if (profiler != nullptr && !IsSecondary()) profiler->CmdEndFrame(handles[cmdBufferIndex], cmdBufferIndex);
+
+    return vkEndCommandBuffer(handles[cmdBufferIndex]);
+}
 
 void CommandBuffer::Reset(uint32_t cmdBufferIndex, VkCommandBufferResetFlags flags)
 {
@@ -64,7 +97,8 @@ void CommandBuffer::CmdBeginRenderPass(
     uint32_t cmdBufferIndex,
     const RenderPass &renderPass,
     const Framebuffer &framebuffer,
-    VkExtent2D renderAreaExtent
+    VkExtent2D renderAreaExtent,
+    VkSubpassContents contents
 )
 {
     VkRenderPassBeginInfo renderPassInfo{};
@@ -76,7 +110,7 @@ void CommandBuffer::CmdBeginRenderPass(
     renderPassInfo.clearValueCount   = static_cast<uint32_t>(clearValues.size());
     renderPassInfo.pClearValues      = clearValues.data();
 
-    vkCmdBeginRenderPass(handles[cmdBufferIndex], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+    vkCmdBeginRenderPass(handles[cmdBufferIndex], &renderPassInfo, contents);
     clearValues.clear();
 }
 
@@ -109,6 +143,13 @@ void CommandBuffer::CmdEndRenderingKHR(uint32_t cmdBufferIndex) { vk::CmdEndRend
 
 void CommandBuffer::CmdEndRenderPass(uint32_t cmdBufferIndex) { vkCmdEndRenderPass(handles[cmdBufferIndex]); }
 
+void CommandBuffer::CmdExecuteCommands(uint32_t cmdBufferIndex, const std::vector<VkCommandBuffer> &secondaries)
+{
+    if (secondaries.empty()) return;
+
+    vkCmdExecuteCommands(handles[cmdBufferIndex], static_cast<uint32_t>(secondaries.size()), secondaries.data());
+}
+
 void CommandBuffer::CmdViewport(
     uint32_t cmdBufferIndex,
     VkOffset2D offset,
@@ -162,9 +203,14 @@ void CommandBuffer::CmdBindIndexBuffer(uint32_t cmdBufferIndex, const Buffer &bu
     vkCmdBindIndexBuffer(handles[cmdBufferIndex], buffer.handle, offset, VK_INDEX_TYPE_UINT32);
 }
 
-void CommandBuffer::CmdDrawIndexed(uint32_t cmdBufferIndex, uint32_t indexCount)
+void CommandBuffer::CmdDrawIndexed(
+    uint32_t cmdBufferIndex,
+    uint32_t indexCount,
+    uint32_t firstIndex,
+    int32_t vertexOffset
+)
 {
-    vkCmdDrawIndexed(handles[cmdBufferIndex], indexCount, 1, 0, 0, 0);
+    vkCmdDrawIndexed(handles[cmdBufferIndex], indexCount, 1, firstIndex, vertexOffset, 0);
 }
 
 void CommandBuffer::CmdBeginDebugLabel(uint32_t cmdBufferIndex, const char *label, const float *color)
@@ -175,9 +221,14 @@ void CommandBuffer::CmdBeginDebugLabel(uint32_t cmdBufferIndex, const char *labe
     for (int i = 0; i < 4; ++i) labelInfo.color[i] = color[i];
 
     vk::CmdBeginDebugUtilsLabelEXT(handles[cmdBufferIndex], &labelInfo);
+    if (profiler != nullptr) profiler->CmdBeginScope(handles[cmdBufferIndex], cmdBufferIndex, label);
 }
 
-void CommandBuffer::CmdEndDebugLabel(uint32_t cmdBufferIndex) { vk::CmdEndDebugUtilsLabelEXT(handles[cmdBufferIndex]); }
+void CommandBuffer::CmdEndDebugLabel(uint32_t cmdBufferIndex)
+{
+    if (profiler != nullptr) profiler->CmdEndScope(handles[cmdBufferIndex], cmdBufferIndex);
+    vk::CmdEndDebugUtilsLabelEXT(handles[cmdBufferIndex]);
+}
 
 void CommandBuffer::CmdInsertDebugLabel(uint32_t cmdBufferIndex, const char *label, const float *color)
 {
@@ -6,6 +6,7 @@
 #include "device.hpp"
 #include "framebuffer.hpp"
 #include "pipeline.hpp"
+#include "profiler.hpp"
 #include "render_pass.hpp"
 
 namespace gl
@@ -17,10 +18,22 @@ public:
     VkCommandBufferAllocateInfo allocInfo;
 
     CommandBuffer();
+    // before Allocate, secondary buffers are recorded on their own and run from a primary with CmdExecuteCommands
+    void Secondary() { allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY; }
+    bool IsSecondary() const { return allocInfo.level == VK_COMMAND_BUFFER_LEVEL_SECONDARY; }
     bool Allocate(const Device &device, const CommandPool &commandPool, uint32_t count);
     void Free(const Device &device, const CommandPool &commandPool);
+    // buffer i is timed on profiler slot i, debug labels become GPU scopes
+    void AttachProfiler(Profiler *profiler) { this->profiler = profiler; }
 
     VkResult Begin(uint32_t cmdBufferIndex, VkCommandBufferUsageFlags flags = 0);
+    // secondary buffer executed inside subpass of renderPass, the framebuffer is optional but lets drivers optimize
+    VkResult BeginSecondary(
+        uint32_t cmdBufferIndex,
+        const RenderPass &renderPass,
+        const Framebuffer *framebuffer = nullptr,
+        uint32_t subpass               = 0
+    );
     VkResult End(uint32_t cmdBufferIndex);
     void Reset(uint32_t cmdBufferIndex, VkCommandBufferResetFlags flags = 0);
     void ClearColor(VkClearColorValue color);
@@ -29,9 +42,12 @@ public:
         uint32_t cmdBufferIndex,
         const RenderPass &renderPass,
         const Framebuffer &framebuffer,
-        VkExtent2D renderAreaExtent
+        VkExtent2D renderAreaExtent,
+        VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE
     );
     void CmdEndRenderPass(uint32_t cmdBufferIndex);
+    // render pass has to be begun with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS
+    void CmdExecuteCommands(uint32_t cmdBufferIndex, const std::vector<VkCommandBuffer> &secondaries);
     void CmdBeginRenderingKHR(uint32_t cmdBufferIndex, VkExtent2D renderAreaExtent, VkImageView imageView);
     void CmdEndRenderingKHR(uint32_t cmdBufferIndex);
     void
@@ -41,12 +57,18 @@ public:
     void CmdBindDescriptorSet(uint32_t cmdBufferIndex, const Pipeline &pipeline, VkDescriptorSet descriptorSet);
     void CmdBindVertexBuffer(uint32_t cmdBufferIndex, const Buffer &buffer, VkDeviceSize offset = 0);
     void CmdBindIndexBuffer(uint32_t cmdBufferIndex, const Buffer &buffer, VkDeviceSize offset = 0);
-    void CmdDrawIndexed(uint32_t cmdBufferIndex, uint32_t indexCount);
+    void CmdDrawIndexed(
+        uint32_t cmdBufferIndex,
+        uint32_t indexCount,
+        uint32_t firstIndex  = 0,
+        int32_t vertexOffset = 0
+    );
     void CmdBeginDebugLabel(uint32_t cmdBufferIndex, const char *label, const float *color);
     void CmdEndDebugLabel(uint32_t cmdBufferIndex);
     void CmdInsertDebugLabel(uint32_t cmdBufferIndex, const char *label, const float *color);
 
 private:
     std::vector<VkClearValue> clearValues;
+    Profiler *profiler;
 };
 } // namespace gl
@@ -25,6 +25,11 @@ bool CommandPool::Create(const Device &device, uint32_t queueFamilyIndex)
 
 void CommandPool::Destroy(const Device &device) { vkDestroyCommandPool(device.handle, handle, nullptr); }
 
+VkResult CommandPool::Reset(const Device &device, VkCommandPoolResetFlags flags) const
+{
+    return vkResetCommandPool(device.handle, handle, flags);
+}
+
 VkResult CommandPool::BeginSingleTimeCommands(const Device &device, VkCommandBuffer *commandBuffer) const
 {
     VkCommandBufferAllocateInfo allocInfo{};
@@ -50,8 +55,14 @@ VkResult CommandPool::EndSingleTimeCommands(const Device &device, VkQueue queue,
     submitInfo.commandBufferCount = 1;
     submitInfo.pCommandBuffers    = &commandBuffer;
 
-    vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE);
-    vkQueueWaitIdle(queue);
+    // wait for this submission only, other work on the queue keeps running
+    VkFenceCreateInfo fenceInfo{};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    VkFence fence   = VK_NULL_HANDLE;
+    if (result == VK_SUCCESS) result = vkCreateFence(device.handle, &fenceInfo, nullptr, &fence);
+    if (result == VK_SUCCESS) result = vkQueueSubmit(queue, 1, &submitInfo, fence);
+    if (result == VK_SUCCESS) result = vkWaitForFences(device.handle, 1, &fence, VK_TRUE, UINT64_MAX);
+    vkDestroyFence(device.handle, fence, nullptr);
     vkFreeCommandBuffers(device.handle, handle, 1, &commandBuffer);
 
     return result;
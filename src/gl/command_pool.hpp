@@ -15,6 +15,8 @@ public:
     void TransientOnly();
     bool Create(const Device &device, uint32_t queueFamilyIndex);
     void Destroy(const Device &device);
+    // returns every buffer allocated from the pool to the initial state, none of them may be pending
+    VkResult Reset(const Device &device, VkCommandPoolResetFlags flags = 0) const;
     VkResult BeginSingleTimeCommands(const Device &device, VkCommandBuffer *commandBuffer) const;
     VkResult EndSingleTimeCommands(const Device &device, VkQueue queue, VkCommandBuffer commandBuffer) const;
 };
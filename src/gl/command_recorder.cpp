@@ -0,0 +1,139 @@
+#include "command_recorder.hpp"
+#include "vulkan.hpp"
+#include <algorithm>
+
+namespace gl
+{
+CommandRecorder::CommandRecorder() : device(nullptr), frame(0) {}
+
+bool CommandRecorder::Create(
+    const Device &device,
+    uint32_t queueFamilyIndex,
+    uint32_t framesInFlight,
+    uint32 threads
+)
+{
+    this->device = &device;
+    frame        = 0;
+
+    lanes.resize(std::max(1u, threads == 0 ? Parallel::ThreadCount() : threads));
+    for (auto &lane : lanes)
+    {
+        lane.pools.resize(framesInFlight);
+        lane.commandBuffers.resize(framesInFlight);
+        lane.used.assign(framesInFlight, 0);
+        for (auto &pool : lane.pools)
+        {
+            // buffers are never reset one by one, the whole pool is
+            pool.TransientOnly();
+            if (!pool.Create(device, queueFamilyIndex)) return false;
+        }
+        for (auto &commandBuffer : lane.commandBuffers) commandBuffer.Secondary();
+    }
+
+    // lane 0 is recorded by the calling thread
+    if (lanes.size() > 1) pool = std::make_unique<Parallel::Pool>(uint32(lanes.size() - 1));
+    fmtx::Info(fmt::format("Command recorder uses {} lanes", lanes.size()));
+
+    return true;
+}
+
+void CommandRecorder::Destroy(const Device &device)
+{
+    pool.reset();
+    // destroying a pool frees its buffers
+    for (auto &lane : lanes)
+    {
+        for (auto &commandPool : lane.pools) commandPool.Destroy(device);
+    }
+    lanes.clear();
+}
+
+bool CommandRecorder::BeginFrame(uint32_t frame)
+{
+    this->frame = frame;
+    for (auto &lane : lanes)
+    {
+        if (frame >= lane.pools.size()) return false;
+        if (lane.pools[frame].Reset(*device) != VK_SUCCESS)
+        {
+            fmtx::Error("Failed to reset command pool");
+            return false;
+        }
+        lane.used[frame] = 0;
+    }
+
+    return true;
+}
+
+std::vector<VkCommandBuffer> CommandRecorder::Record(
+    uint32_t chunks,
+    const RenderPass &renderPass,
+    const Framebuffer &framebuffer,
+    const RecordFn &record
+)
+{
+    std::vector<VkCommandBuffer> recorded(chunks, VK_NULL_HANDLE);
+    if (chunks == 0 || lanes.empty()) return recorded;
+
+    auto used    = std::min<uint32_t>(Lanes(), chunks);
+    auto perLane = (chunks + used - 1) / used;
+
+    std::vector<std::future<bool>> pending;
+    pending.reserve(used);
+    for (uint32_t i = 1; i < used; ++i)
+    {
+        auto begin = i * perLane;
+        auto end   = std::min(chunks, begin + perLane);
+        if (begin >= end) break;
+
+        auto *lane = &lanes[i];
+        pending.push_back(pool->Submit([&, lane, begin, end]() {
+            return recordLane(*lane, begin, end, renderPass, framebuffer, record, recorded);
+        }));
+    }
+    bool recordOk = recordLane(lanes[0], 0, std::min(chunks, perLane), renderPass, framebuffer, record, recorded);
+    for (auto &future : pending) recordOk = future.get() && recordOk;
+
+    if (!recordOk)
+    {
+        fmtx::Error("Failed to record secondary command buffers");
+        recorded.clear();
+    }
+
+    return recorded;
+}
+
+bool CommandRecorder::recordLane(
+    Lane &lane,
+    uint32_t begin,
+    uint32_t end,
+    const RenderPass &renderPass,
+    const Framebuffer &framebuffer,
+    const RecordFn &record,
+    std::vector<VkCommandBuffer> &recorded
+)
+{
+    auto &commandBuffer = lane.commandBuffers[frame];
+    auto &used          = lane.used[frame];
+    auto needed         = used + (end - begin);
+    if (commandBuffer.handles.size() < needed)
+    {
+        // buffers recorded earlier this frame stay valid, only the missing ones are allocated
+        CommandBuffer more;
+        more.Secondary();
+        if (!more.Allocate(*device, lane.pools[frame], uint32_t(needed - commandBuffer.handles.size()))) return false;
+        commandBuffer.handles.insert(commandBuffer.handles.end(), more.handles.begin(), more.handles.end());
+    }
+
+    for (auto chunk = begin; chunk < end; ++chunk, ++used)
+    {
+        if (commandBuffer.BeginSecondary(used, renderPass, &framebuffer) != VK_SUCCESS) return false;
+        record(chunk, commandBuffer, used);
+        if (commandBuffer.End(used) != VK_SUCCESS) return false;
+        recorded[chunk] = commandBuffer.handles[used];
+    }
+
+    return true;
+}
+} // namespace gl
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "../core/parallel.hpp"
+#include "command_buffer.hpp"
+#include "command_pool.hpp"
+#include "core.hpp"
+#include "device.hpp"
+#include "framebuffer.hpp"
+#include "render_pass.hpp"
+
+namespace gl
+{
+// Records secondary command buffers for a render pass on several threads.
+// Command pools are externally synchronized, so every lane owns one pool per frame in flight and is recorded by a
+// single thread at a time. The calling thread records lane 0, the others run on a worker pool.
+// Pools of a frame are reset at once in BeginFrame instead of resetting buffers one by one.
+class CommandRecorder
+{
+public:
+    // records chunk into commandBuffer.handles[index], already begun inside the render pass
+    using RecordFn = std::function<void(uint32_t chunk, CommandBuffer &commandBuffer, uint32_t index)>;
+
+    CommandRecorder();
+    // threads = 0 uses one lane per core
+    bool Create(const Device &device, uint32_t queueFamilyIndex, uint32_t framesInFlight, uint32 threads = 0);
+    void Destroy(const Device &device);
+    // the previous submission of frame has to be finished, buffers recorded for it are recycled
+    bool BeginFrame(uint32_t frame);
+    // chunks are split into contiguous ranges across lanes, callbacks run concurrently and may only record into
+    // the buffer they are given. Returns the buffers in chunk order for CmdExecuteCommands, empty on failure.
+    std::vector<VkCommandBuffer> Record(
+        uint32_t chunks,
+        const RenderPass &renderPass,
+        const Framebuffer &framebuffer,
+        const RecordFn &record
+    );
+    uint32 Lanes() const { return uint32(lanes.size()); }
+
+private:
+    struct Lane
+    {
+        // per frame in flight
+        std::vector<CommandPool> pools;
+        std::vector<CommandBuffer> commandBuffers;
+        std::vector<uint32_t> used;
+    };
+
+    bool recordLane(
+        Lane &lane,
+        uint32_t begin,
+        uint32_t end,
+        const RenderPass &renderPass,
+        const Framebuffer &framebuffer,
+        const RecordFn &record,
+        std::vector<VkCommandBuffer> &recorded
+    );
+
+private:
+    const Device *device;
+    std::unique_ptr<Parallel::Pool> pool;
+    std::vector<Lane> lanes;
+    uint32_t frame;
+};
+} // namespace gl
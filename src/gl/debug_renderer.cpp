@@ -1,11 +1,19 @@
 #include "debug_renderer.hpp"
 
 #include "../deps/fmt.hpp"
+#include "app.hpp"
+#include <atomic>
+#include <chrono>
 
 #define IMDD_IMPLEMENTATION
 #include "../vendor/imdd/imdd.h"
 #include "../vendor/imdd/imdd_draw_vulkan.h"
 
+static_assert(
+    IMDD_VULKAN_FRAME_COUNT >= gl::App::FramesInFlightMax,
+    "imdd would rewrite buffers of a frame still in flight"
+);
+
 #define IMDD_VERIFY(STMT)                                                                                              \
     do                                                                                                                 \
     {                                                                                                                  \
@@ -31,127 +39,158 @@ static void imdd_vk_verify(VkResult imdd_vk_result) { IMDD_VK_VERIFY(imdd_vk_res
 
 namespace gl
 {
-DebugRenderer::DebugRenderer() : store(nullptr), ctx(nullptr), memory(nullptr), device(nullptr), style(Style::Filled) {}
+// frames are numbered across all renderers so a chain cached by a thread never outlives its frame
+static std::atomic<uint64_t> nextFrame{1};
 
-DebugRenderer::~DebugRenderer() { Shutdown(); }
+// sink for shapes when no block can be allocated, imdd drops everything reserved past its zero capacity
+static imdd_shape_store_t droppedShapes = {};
 
-bool DebugRenderer::Init(const Device &device, const PhysicalDevice &physicalDevice, const RenderPass &renderPass)
+DebugRenderer::DebugRenderer()
+    : device(nullptr), physicalDevice(nullptr), renderPass(nullptr), pipelineCompiler(nullptr), usedChains(0),
+      frame(nextFrame++), capacity(0), highWaterMark(0), windowPeak(0), windowChains(0), windowFrames(0), ctx(nullptr)
 {
-    this->device = &device;
+}
 
-    ctx = new imdd_vulkan_context_t;
+DebugRenderer::~DebugRenderer() { Shutdown(); }
 
-    auto shapeCount       = 1024;
-    uint32_t shapeMemSize = IMDD_APPROX_SHAPE_SIZE_IN_BYTES * shapeCount;
-    memory                = malloc(shapeMemSize);
-    if (memory == nullptr)
+bool DebugRenderer::Init(
+    const Device &device,
+    const PhysicalDevice &physicalDevice,
+    const RenderPass &renderPass,
+    PipelineCompiler &pipelineCompiler
+)
+{
+    this->device           = &device;
+    this->physicalDevice   = &physicalDevice;
+    this->renderPass       = &renderPass;
+    this->pipelineCompiler = &pipelineCompiler;
+
+#if !defined(IMDD_NO_SIMD)
+    // SSE path is picked at compile time, refuse to run instead of crashing on an illegal instruction
+    if (!CPU::HasSSE2())
     {
-        fmtx::Error("Failed to allocate memory for debug renderer");
+        fmtx::Error(fmt::format("Debug renderer was built with SSE but CPU supports only {}", CPU::Describe()));
         return false;
     }
-    fmtx::Debug("Memory allocated for debug renderer");
+#endif
+    fmtx::Debug(fmt::format("Debug renderer uses {} backend", Backend()));
 
-    store = imdd_init(memory, shapeMemSize);
-    if (store == nullptr)
-    {
-        fmtx::Error("Failed to init debug renderer");
-        return false;
-    }
+    // chain of the render thread, other threads get theirs on first shape
+    chains.push_back(std::make_unique<ShapeChain>());
+    if (!chains.back()->AddBlock()) return false;
     fmtx::Debug("Debug renderer initialized");
 
-    {
-        imdd_vulkan_fp_t fp;
-        IMDD_VULKAN_SET_GLOBAL_FP(&fp);
-
-        imdd_vulkan_init(
-            ctx, shapeCount, shapeCount, shapeCount, &fp, imdd_vk_verify, physicalDevice.handle, device.handle, 0
-        );
+    // pipelines compile alongside the app's, shapes are not drawn until the context is ready
+    pendingContext = pipelineCompiler.Submit([this]() {
+        if (!createContext(InitialShapeCount)) return false;
         fmtx::Debug("Debug render Vulkan backend initialized");
-    }
-
-    imdd_vulkan_create_pipelines(ctx, device.handle, renderPass.handle, VK_SAMPLE_COUNT_1_BIT);
-
-    vkDestroyShaderModule(device.handle, ctx->instance_filled_vert, nullptr);
-    vkDestroyShaderModule(device.handle, ctx->instance_wire_vert, nullptr);
-    vkDestroyShaderModule(device.handle, ctx->array_filled_vert, nullptr);
-    vkDestroyShaderModule(device.handle, ctx->array_wire_vert, nullptr);
-    vkDestroyShaderModule(device.handle, ctx->filled_frag, nullptr);
-    vkDestroyShaderModule(device.handle, ctx->wire_frag, nullptr);
+        return true;
+    });
 
     return true;
 }
 
+const char *DebugRenderer::Backend()
+{
+#if !defined(IMDD_NO_SIMD)
+    return "SSE";
+#else
+    return "scalar";
+#endif
+}
+
 void DebugRenderer::Shutdown()
 {
-    if (store != nullptr)
+    if (pendingContext.valid()) pendingContext.wait();
+    pendingContext = {};
+
+    if (ctx != nullptr)
     {
         fmtx::Info("Shutting down debug renderer");
         device->WaitIdle();
+        destroyContext();
+    }
 
-        for (int i = 0; i < IMDD_STYLE_COUNT; ++i)
-        {
-            vkDestroyBuffer(device->handle, ctx->mesh_buffers[i].index_staging_buffer, nullptr);
-            vkDestroyBuffer(device->handle, ctx->mesh_buffers[i].vertex_staging_buffer, nullptr);
-            vkDestroyBuffer(device->handle, ctx->mesh_buffers[i].index_buffer, nullptr);
-            vkDestroyBuffer(device->handle, ctx->mesh_buffers[i].vertex_buffer, nullptr);
-        }
-        for (int i = 0; i < IMDD_VULKAN_FRAME_COUNT; ++i)
-        {
-            vkDestroyBuffer(device->handle, ctx->frames[i].instance_transform_buffer, nullptr);
-            vkDestroyBuffer(device->handle, ctx->frames[i].instance_color_buffer, nullptr);
-            vkDestroyBuffer(device->handle, ctx->frames[i].filled_vertex_buffer, nullptr);
-            vkDestroyBuffer(device->handle, ctx->frames[i].wire_vertex_buffer, nullptr);
-        }
-        for (int i = 0; i < IMDD_VULKAN_DESCRIPTOR_COUNT; ++i)
+    chains.clear();
+    usedChains = 0;
+    frame      = nextFrame++;
+}
+
+void DebugRenderer::Begin()
+{
+    for (uint32_t i = 0; i < usedChains; ++i) chains[i]->Reset();
+    usedChains = 0;
+    frame      = nextFrame++;
+}
+
+void DebugRenderer::End(VkCommandBuffer commandBuffer)
+{
+    if (!contextReady()) return;
+
+    uint32_t shapeCount = 0;
+    frameStores.clear();
+    for (uint32_t c = 0; c < usedChains; ++c)
+    {
+        auto &chain = *chains[c];
+        for (uint32_t i = 0; i < chain.blocks.size() && i <= chain.activeBlock; ++i)
         {
-            vkDestroyBuffer(device->handle, ctx->descriptors[i].common_uniform_buffer, nullptr);
+            auto *store = chain.blocks[i].store;
+            shapeCount += std::min(uint32_t(imdd_atomic_load(&store->header_count)), store->header_capacity);
+            frameStores.push_back(store);
         }
+        chain.peakBlocks = std::max(chain.peakBlocks, chain.activeBlock + 1);
+    }
+
+    windowPeak   = std::max(windowPeak, shapeCount);
+    windowChains = std::max(windowChains, usedChains);
 
-        vkFreeMemory(device->handle, ctx->device_memory, nullptr);
-        vkFreeMemory(device->handle, ctx->host_memory, nullptr);
+    // grow before the update so this frame is drawn complete
+    if (shapeCount > capacity) resize(shapeCount);
 
-        for (int i = 0; i < IMDD_VULKAN_PIPELINE_COUNT; ++i)
+    if (++windowFrames == ShrinkFrameCount)
+    {
+        // chains and blocks not touched during the window are released, GPU buffers shrink when mostly unused
+        if (chains.size() > std::max(windowChains, 1u)) chains.resize(std::max(windowChains, 1u));
+        for (auto &chain : chains)
         {
-            vkDestroyPipeline(device->handle, ctx->pipelines[i], nullptr);
+            // first block stays even after a window without shapes, Reserve() starts from it
+            const auto keep = std::min(std::max<size_t>(chain->peakBlocks, 1), chain->blocks.size());
+            for (auto i = keep; i < chain->blocks.size(); ++i) free(chain->blocks[i].memory);
+            chain->blocks.resize(keep);
+            if (chain->activeBlock >= keep) chain->activeBlock = 0;
+            chain->peakBlocks = 0;
         }
-        vkDestroyPipelineLayout(device->handle, ctx->common_pipeline_layout, nullptr);
-        vkDestroyDescriptorSetLayout(device->handle, ctx->common_descriptor_set_layout, nullptr);
-        vkDestroyDescriptorPool(device->handle, ctx->descriptor_pool, nullptr);
 
-        delete ctx;
-        free(memory);
+        if (windowPeak * 4 < capacity && capacity > InitialShapeCount) resize(windowPeak);
 
-        memory = nullptr;
-        ctx    = nullptr;
-        store  = nullptr;
+        highWaterMark = windowPeak;
+        windowPeak    = 0;
+        windowChains  = 0;
+        windowFrames  = 0;
     }
-}
 
-void DebugRenderer::Begin()
-{
-    imdd_reset(store);
-    style = Style::Filled;
-}
-
-void DebugRenderer::End(VkCommandBuffer commandBuffer)
-{
-    imdd_vulkan_update(ctx, &store, 1, device->handle, commandBuffer);
+    resizeNextFrame();
+    imdd_vulkan_update(ctx, frameStores.data(), uint32_t(frameStores.size()), device->handle, commandBuffer);
 }
 
 void DebugRenderer::CmdDraw(const Camera &camera, VkCommandBuffer commandBuffer)
 {
+    if (!contextReady()) return;
+
     auto P = camera.ViewProjection();
 
     imdd_vulkan_draw(ctx, glm::value_ptr(P), device->handle, commandBuffer);
 }
 
-void DebugRenderer::Filled(bool filled) { style = filled ? Style::Filled : Style::Wire; }
+void DebugRenderer::Filled(bool filled) { threadShapes().style = filled ? Style::Filled : Style::Wire; }
 
 void DebugRenderer::Point(const Vec3 &p, const Vec3 &color, float size) const
 {
     imdd_v4 min = {p.x - size / 2, p.y - size / 2, p.z - size / 2, 0};
     imdd_v4 max = {p.x + size / 2, p.y + size / 2, p.z + size / 2, 0};
-    imdd_aabb(store, imdd_style_enum_t(style), IMDD_ZMODE_TEST, min, max, toColor(color));
+
+    auto &shapes = threadShapes();
+    imdd_aabb(shapes.Reserve(), imdd_style_enum_t(shapes.style), IMDD_ZMODE_TEST, min, max, toColor(color));
 }
 
 void DebugRenderer::Circle(const Vec3 &center, const Vec3 &planeNormal, float radius, const Vec3 &color) const
@@ -161,7 +200,14 @@ void DebugRenderer::Circle(const Vec3 &center, const Vec3 &planeNormal, float ra
 
 void DebugRenderer::Sphere(const Vec3 &p, float radius, const Vec3 &color) const
 {
-    imdd_sphere(store, imdd_style_enum_t(style), IMDD_ZMODE_TEST, imdd_v4({p.x, p.y, p.z, radius}), toColor(color));
+    auto &shapes = threadShapes();
+    imdd_sphere(
+        shapes.Reserve(),
+        imdd_style_enum_t(shapes.style),
+        IMDD_ZMODE_TEST,
+        imdd_v4({p.x, p.y, p.z, radius}),
+        toColor(color)
+    );
 }
 
 void DebugRenderer::Plane(
@@ -200,14 +246,16 @@ void DebugRenderer::Line(const Vec3 &from, const Vec3 &to, const Vec3 &color) co
 {
     imdd_v4 start = {from.x, from.y, from.z, 0};
     imdd_v4 end   = {to.x, to.y, to.z, 0};
-    imdd_line(store, IMDD_ZMODE_TEST, start, end, toColor(color));
+    imdd_line(threadShapes().Reserve(), IMDD_ZMODE_TEST, start, end, toColor(color));
 }
 
 void DebugRenderer::Box(const Vec3 &center, const Vec3 &size, const Vec3 &color) const
 {
     imdd_v4 min = {center.x - size.x / 2, center.y - size.y / 2, center.z - size.z / 2, 0};
     imdd_v4 max = {center.x + size.x / 2, center.y + size.y / 2, center.z + size.z / 2, 0};
-    imdd_aabb(store, imdd_style_enum_t(style), IMDD_ZMODE_TEST, min, max, toColor(color));
+
+    auto &shapes = threadShapes();
+    imdd_aabb(shapes.Reserve(), imdd_style_enum_t(shapes.style), IMDD_ZMODE_TEST, min, max, toColor(color));
 }
 
 void DebugRenderer::AxisTriad(const Mat4 &transform, float size) const
@@ -281,7 +329,8 @@ void DebugRenderer::Cone(const Vec3 &origin, const Vec3 &dir, const Vec3 &color,
     imdd_v4 z    = toVec(d * -length);
     imdd_v4 apex = toVec(origin + d * length);
 
-    imdd_cone(store, imdd_style_enum_t(style), IMDD_ZMODE_TEST, x, y, z, apex, toColor(color));
+    auto &shapes = threadShapes();
+    imdd_cone(shapes.Reserve(), imdd_style_enum_t(shapes.style), IMDD_ZMODE_TEST, x, y, z, apex, toColor(color));
 }
 
 void DebugRenderer::Cylinder(const Vec3 &origin, const Vec3 &dir, const Vec3 &color, float radius, float length) const
@@ -298,7 +347,10 @@ void DebugRenderer::Cylinder(const Vec3 &origin, const Vec3 &dir, const Vec3 &co
     imdd_v4 z    = toVec(d * -length * 0.5f);
     imdd_v4 apex = toVec(origin + d * length * 0.5f);
 
-    imdd_cylinder(store, imdd_style_enum_t(style), IMDD_ZMODE_TEST, x, y, z, apex, toColor(color));
+    auto &shapes = threadShapes();
+    imdd_cylinder(
+        shapes.Reserve(), imdd_style_enum_t(shapes.style), IMDD_ZMODE_TEST, x, y, z, apex, toColor(color)
+    );
 }
 
 uint32_t DebugRenderer::toColor(const Vec3 &color) const
@@ -307,4 +359,177 @@ uint32_t DebugRenderer::toColor(const Vec3 &color) const
 }
 
 imdd_v4 DebugRenderer::toVec(const Vec3 &v, float w) const { return imdd_v4({v.x, v.y, v.z, w}); }
+
+DebugRenderer::ShapeChain &DebugRenderer::threadShapes() const
+{
+    thread_local uint64_t cachedFrame    = 0;
+    thread_local ShapeChain *cachedChain = nullptr;
+    if (cachedFrame == frame) return *cachedChain;
+
+    std::lock_guard<std::mutex> lock(chainsMutex);
+
+    // same thread alternating between renderers finds its chain again
+    auto thread = std::this_thread::get_id();
+    for (uint32_t i = 0; i < usedChains; ++i)
+    {
+        if (chains[i]->thread != thread) continue;
+        cachedFrame = frame;
+        cachedChain = chains[i].get();
+        return *cachedChain;
+    }
+
+    if (usedChains == chains.size()) chains.push_back(std::make_unique<ShapeChain>());
+    cachedFrame         = frame;
+    cachedChain         = chains[usedChains++].get();
+    cachedChain->thread = thread;
+    return *cachedChain;
+}
+
+DebugRenderer::ShapeChain::~ShapeChain()
+{
+    for (auto &block : blocks) free(block.memory);
+}
+
+imdd_shape_store_tag *DebugRenderer::ShapeChain::Reserve()
+{
+    // every shape call writes one header and at most 4 data quadwords
+    auto fits = [](imdd_shape_store_tag *store)
+    {
+        return imdd_atomic_load(&store->header_count) < store->header_capacity &&
+               imdd_atomic_load(&store->data_qw_count) + 4 <= store->data_qw_capacity;
+    };
+
+    if (!blocks.empty() && fits(blocks[activeBlock].store)) return blocks[activeBlock].store;
+    if (activeBlock + 1 < blocks.size()) return blocks[++activeBlock].store;
+    if (!AddBlock()) return blocks.empty() ? &droppedShapes : blocks[activeBlock].store;
+
+    activeBlock = uint32_t(blocks.size() - 1);
+    return blocks[activeBlock].store;
+}
+
+bool DebugRenderer::ShapeChain::AddBlock()
+{
+    uint32_t shapeCount   = InitialShapeCount << std::min(uint32_t(blocks.size()), MaxBlockShift);
+    uint32_t shapeMemSize = IMDD_APPROX_SHAPE_SIZE_IN_BYTES * shapeCount;
+    void *memory          = malloc(shapeMemSize);
+    if (memory == nullptr)
+    {
+        fmtx::Error("Failed to allocate memory for debug renderer");
+        return false;
+    }
+
+    auto *store = imdd_init(memory, shapeMemSize);
+    if (store == nullptr)
+    {
+        free(memory);
+        fmtx::Error("Failed to init debug renderer");
+        return false;
+    }
+
+    blocks.push_back({memory, store});
+    return true;
+}
+
+void DebugRenderer::ShapeChain::Reset()
+{
+    for (uint32_t i = 0; i < blocks.size() && i <= activeBlock; ++i) imdd_reset(blocks[i].store);
+    thread      = std::thread::id();
+    activeBlock = 0;
+    style       = Style::Filled;
+}
+
+bool DebugRenderer::createContext(uint32_t shapeCapacity)
+{
+    ctx      = new imdd_vulkan_context_t;
+    capacity = shapeCapacity;
+
+    imdd_vulkan_fp_t fp;
+    IMDD_VULKAN_SET_GLOBAL_FP(&fp);
+
+    // every shape becomes at most one instance, triangle or line
+    imdd_vulkan_init(ctx, capacity, capacity, capacity, &fp, imdd_vk_verify, physicalDevice->handle, device->handle, 0);
+    sdl::Stopwatch stopwatch;
+    auto result = imdd_vulkan_create_pipelines(
+        ctx, device->handle, pipelineCompiler->Cache().handle, renderPass->handle, VK_SAMPLE_COUNT_1_BIT
+    );
+
+    vkDestroyShaderModule(device->handle, ctx->instance_filled_vert, nullptr);
+    vkDestroyShaderModule(device->handle, ctx->instance_wire_vert, nullptr);
+    vkDestroyShaderModule(device->handle, ctx->array_filled_vert, nullptr);
+    vkDestroyShaderModule(device->handle, ctx->array_wire_vert, nullptr);
+    vkDestroyShaderModule(device->handle, ctx->filled_frag, nullptr);
+    vkDestroyShaderModule(device->handle, ctx->wire_frag, nullptr);
+
+    if (result != VK_SUCCESS)
+    {
+        // pipelines not created are null handles, which destroyContext skips
+        fmtx::Error(fmt::format("Failed to create debug renderer pipelines: {}", int(result)));
+        destroyContext();
+        return false;
+    }
+    fmtx::Info(fmt::format("Created debug renderer pipelines in {:.2f} ms", stopwatch.ElapsedMilliseconds()));
+
+    return true;
+}
+
+void DebugRenderer::destroyContext()
+{
+    for (int i = 0; i < IMDD_STYLE_COUNT; ++i)
+    {
+        vkDestroyBuffer(device->handle, ctx->mesh_buffers[i].index_staging_buffer, nullptr);
+        vkDestroyBuffer(device->handle, ctx->mesh_buffers[i].vertex_staging_buffer, nullptr);
+        vkDestroyBuffer(device->handle, ctx->mesh_buffers[i].index_buffer, nullptr);
+        vkDestroyBuffer(device->handle, ctx->mesh_buffers[i].vertex_buffer, nullptr);
+    }
+    for (uint32_t i = 0; i < IMDD_VULKAN_FRAME_COUNT; ++i) imdd_vulkan_destroy_frame(ctx, device->handle, i);
+    for (int i = 0; i < IMDD_VULKAN_DESCRIPTOR_COUNT; ++i)
+    {
+        vkDestroyBuffer(device->handle, ctx->descriptors[i].common_uniform_buffer, nullptr);
+    }
+
+    vkFreeMemory(device->handle, ctx->device_memory, nullptr);
+    vkFreeMemory(device->handle, ctx->host_memory, nullptr);
+
+    for (int i = 0; i < IMDD_VULKAN_PIPELINE_COUNT; ++i)
+    {
+        vkDestroyPipeline(device->handle, ctx->pipelines[i], nullptr);
+    }
+    vkDestroyPipelineLayout(device->handle, ctx->common_pipeline_layout, nullptr);
+    vkDestroyDescriptorSetLayout(device->handle, ctx->common_descriptor_set_layout, nullptr);
+    vkDestroyDescriptorPool(device->handle, ctx->descriptor_pool, nullptr);
+
+    delete ctx;
+    ctx = nullptr;
+}
+
+bool DebugRenderer::contextReady()
+{
+    if (pendingContext.valid())
+    {
+        if (pendingContext.wait_for(std::chrono::seconds(0)) != std::future_status::ready) return false;
+        pendingContext = {};
+    }
+
+    return ctx != nullptr;
+}
+
+void DebugRenderer::resize(uint32_t shapeCount)
+{
+    uint32_t newCapacity = InitialShapeCount;
+    while (newCapacity < shapeCount) newCapacity *= 2;
+    if (newCapacity == capacity) return;
+
+    fmtx::Debug(fmt::format("Resizing debug renderer buffers from {} to {} shapes", capacity, newCapacity));
+    capacity = newCapacity;
+}
+
+void DebugRenderer::resizeNextFrame()
+{
+    // the slot the update writes next was last drawn IMDD_VULKAN_FRAME_COUNT frames ago, its fence has been waited
+    // for, so only its buffers are reallocated and pipelines keep running
+    auto next = imdd_vulkan_next_frame(ctx);
+    if (ctx->frames[next].instance_capacity == capacity) return;
+
+    imdd_vulkan_resize_frame(ctx, device->handle, next, capacity, capacity, capacity);
+}
 } // namespace gl
\ No newline at end of file
@@ -3,6 +3,9 @@
 #include "../core/all.hpp"
 #include "../gl/vulkan.hpp"
 #include "../vendor/imdd/imdd_simd.h"
+#include <memory>
+#include <mutex>
+#include <thread>
 
 struct imdd_vulkan_context_t;
 struct imdd_shape_store_tag;
@@ -11,6 +14,8 @@ static void imdd_vk_verify(VkResult imdd_vk_result);
 
 namespace gl
 {
+// Shape calls may come from any thread between Begin and End, every thread records into its own chain of imdd
+// stores which End merges. Begin, End and CmdDraw stay on the render thread, with recording threads done by End.
 class DebugRenderer
 {
 public:
@@ -20,15 +25,29 @@ public:
         Wire
     };
 
+public:
+    // frames after which unused capacity is released
+    static constexpr uint32_t ShrinkFrameCount = 300;
+
 public:
     DebugRenderer();
     ~DebugRenderer();
 
-    bool Init(const Device &device, const PhysicalDevice &physicalDevice, const RenderPass &renderPass);
+    bool Init(
+        const Device &device,
+        const PhysicalDevice &physicalDevice,
+        const RenderPass &renderPass,
+        PipelineCompiler &pipelineCompiler
+    );
     void Shutdown();
     void Begin();
     void End(VkCommandBuffer commandBuffer);
     void CmdDraw(const Camera &camera, VkCommandBuffer commandBuffer);
+    // most shapes recorded in a single frame recently, GPU buffers are sized after it
+    uint32_t HighWaterMark() const { return std::max(highWaterMark, windowPeak); }
+    uint32_t Capacity() const { return capacity; }
+    // imdd backend picked at compile time, "SSE" or "scalar"
+    static const char *Backend();
 
     void Filled(bool filled = true);
     void Point(const Vec3 &p, const Vec3 &color = WHITE, float size = 0.02f) const;
@@ -68,14 +87,62 @@ public:
     // WHITE, const Vec2 &offset = Vec2(0, 0)) const;
 
 private:
+    struct ShapeBlock
+    {
+        void *memory;
+        imdd_shape_store_tag *store;
+    };
+
+    // blocks of one recording thread, filled in order
+    struct ShapeChain
+    {
+        std::thread::id thread;
+        std::vector<ShapeBlock> blocks;
+        uint32_t activeBlock = 0;
+        uint32_t peakBlocks  = 0;
+        Style style          = Style::Filled;
+
+        ~ShapeChain();
+        // store with room for one more shape, moves to the next block or adds one when the active one is full
+        imdd_shape_store_tag *Reserve();
+        bool AddBlock();
+        void Reset();
+    };
+
+    // GPU capacity at start and size of the first store block, later blocks double up to MaxBlockShift times
+    static constexpr uint32_t InitialShapeCount = 1024;
+    static constexpr uint32_t MaxBlockShift     = 10;
+
     uint32_t toColor(const Vec3 &color) const;
     imdd_v4 toVec(const Vec3 &v, float w = 0) const;
+    // chain of the calling thread for the current frame, lock is only taken on its first shape
+    ShapeChain &threadShapes() const;
+    // false when pipeline creation failed, ctx is left null then
+    bool createContext(uint32_t shapeCapacity);
+    // false while the initial context is still being created on the pipeline compiler
+    bool contextReady();
+    void destroyContext();
+    // sets the capacity every frame slot is brought to, see resizeNextFrame
+    void resize(uint32_t shapeCount);
+    // reallocates the buffers of the slot the next update writes when its capacity differs
+    void resizeNextFrame();
 
 private:
-    Style style;
     const Device *device;
-    void *memory;
-    imdd_shape_store_tag *store;
+    const PhysicalDevice *physicalDevice;
+    const RenderPass *renderPass;
+    const PipelineCompiler *pipelineCompiler;
+    PipelineCompiler::Future pendingContext;
+    mutable std::mutex chainsMutex;
+    mutable std::vector<std::unique_ptr<ShapeChain>> chains;
+    mutable uint32_t usedChains;
+    uint64_t frame;
+    std::vector<imdd_shape_store_tag *> frameStores;
+    uint32_t capacity;
+    uint32_t highWaterMark;
+    uint32_t windowPeak;
+    uint32_t windowChains;
+    uint32_t windowFrames;
     imdd_vulkan_context_t *ctx;
 };
 } // namespace gl
\ No newline at end of file
@@ -11,8 +11,10 @@ Device::Device() :
     deviceFeatures({}),
     graphicsQueue(VK_NULL_HANDLE),
     presentQueue(VK_NULL_HANDLE),
+    transferQueue(VK_NULL_HANDLE),
     createInfo({}),
-    DynamicRenderingEnabled(false)
+    DynamicRenderingEnabled(false),
+    TimelineSemaphoreEnabled(false)
 {
     createInfo.sType                 = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
     createInfo.pNext                 = nullptr;
@@ -35,10 +37,16 @@ bool Device::Create(const PhysicalDevice &physicalDevice)
 
     for (const auto &layer : validationLayers) fmtx::Debug(fmt::format("Validation layer: {}", layer));
 
+    const auto &families    = physicalDevice.queueFamilyIndices;
+    uint32_t transferFamily = families.transferFamily.value_or(families.graphicsFamily.value());
+    // headless devices never present, the present queue aliases the graphics one
+    uint32_t presentFamily  = families.presentFamily.value_or(families.graphicsFamily.value());
+
     std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
     std::set<uint32_t> uniqueQueueFamilies = {
-        physicalDevice.queueFamilyIndices.graphicsFamily.value(),
-        physicalDevice.queueFamilyIndices.presentFamily.value()
+        families.graphicsFamily.value(),
+        presentFamily,
+        transferFamily
     };
     float queuePriority = 1.0f;
     for (uint32_t queueFamily : uniqueQueueFamilies)
@@ -51,13 +59,24 @@ bool Device::Create(const PhysicalDevice &physicalDevice)
         queueCreateInfos.push_back(queueCreateInfo);
     }
 
+    // feature structs have to outlive vkCreateDevice, each enabled one is pushed to the front of the chain
+    VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamicRenderingFeature{};
+    VkPhysicalDeviceTimelineSemaphoreFeatures timelineSemaphoreFeature{};
+    createInfo.pNext = nullptr;
     if (DynamicRenderingEnabled)
     {
-        VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamicRenderingFeature{};
         dynamicRenderingFeature.sType            = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
         dynamicRenderingFeature.dynamicRendering = VK_TRUE;
+        dynamicRenderingFeature.pNext            = const_cast<void *>(createInfo.pNext);
         createInfo.pNext                         = &dynamicRenderingFeature;
     }
+    if (TimelineSemaphoreEnabled)
+    {
+        timelineSemaphoreFeature.sType             = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+        timelineSemaphoreFeature.timelineSemaphore = VK_TRUE;
+        timelineSemaphoreFeature.pNext             = const_cast<void *>(createInfo.pNext);
+        createInfo.pNext                           = &timelineSemaphoreFeature;
+    }
 
     createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
     createInfo.pQueueCreateInfos    = queueCreateInfos.data();
@@ -69,8 +88,12 @@ bool Device::Create(const PhysicalDevice &physicalDevice)
         return false;
     }
 
-    vkGetDeviceQueue(handle, physicalDevice.queueFamilyIndices.graphicsFamily.value(), 0, &graphicsQueue.handle);
-    vkGetDeviceQueue(handle, physicalDevice.queueFamilyIndices.presentFamily.value(), 0, &presentQueue.handle);
+    graphicsQueue.familyIndex = families.graphicsFamily.value();
+    presentQueue.familyIndex  = presentFamily;
+    transferQueue.familyIndex = transferFamily;
+    vkGetDeviceQueue(handle, graphicsQueue.familyIndex, 0, &graphicsQueue.handle);
+    vkGetDeviceQueue(handle, presentQueue.familyIndex, 0, &presentQueue.handle);
+    vkGetDeviceQueue(handle, transferQueue.familyIndex, 0, &transferQueue.handle);
 
     fmtx::Info("Logical device created");
 
@@ -104,6 +127,8 @@ void Device::RequireDynamicRendering()
     DynamicRenderingEnabled            = true;
 }
 
+void Device::RequireTimelineSemaphore() { TimelineSemaphoreEnabled = true; }
+
 void Device::SetRequiredExtensions(const CStrings &extensions)
 {
     for (const auto &ext : extensions) requiredExtensions.emplace_back(ext);
@@ -14,9 +14,12 @@ public:
     VkDevice handle;
     Queue graphicsQueue;
     Queue presentQueue;
+    // dedicated transfer queue when the device has one, otherwise the graphics queue
+    Queue transferQueue;
     std::vector<const char *> requiredExtensions;
     std::vector<const char *> validationLayers;
     bool DynamicRenderingEnabled;
+    bool TimelineSemaphoreEnabled;
 
     Device();
     bool Create(const PhysicalDevice &physicalDevice);
@@ -25,6 +28,8 @@ public:
     VkResult WaitForFences(uint32_t count, const VkFence *pFences) const;
     void RequireSwapchainExtension();
     void RequireDynamicRendering();
+    void RequireTimelineSemaphore();
+    bool HasDedicatedTransferQueue() const { return transferQueue.familyIndex != graphicsQueue.familyIndex; }
     void SetRequiredExtensions(const CStrings &extensions);
     void EnableValidationLayers();
     void UpdateDescriptorSets(const std::vector<VkWriteDescriptorSet> &descriptorWrites);
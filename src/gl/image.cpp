@@ -3,7 +3,7 @@
 
 namespace gl
 {
-Image::Image() : createInfo({})
+Image::Image() : handle(VK_NULL_HANDLE), createInfo({}), allocationCreateInfo({}), allocation(VK_NULL_HANDLE)
 {
     createInfo.sType         = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
     createInfo.imageType     = VK_IMAGE_TYPE_2D;
@@ -15,6 +15,8 @@ Image::Image() : createInfo({})
     createInfo.sharingMode   = VK_SHARING_MODE_EXCLUSIVE;
     createInfo.samples       = VK_SAMPLE_COUNT_1_BIT;
     createInfo.flags         = 0;
+
+    allocationCreateInfo.usage = VMA_MEMORY_USAGE_AUTO;
 }
 
 void Image::Usage(VkImageUsageFlags usage) { createInfo.usage = usage; }
@@ -25,14 +27,24 @@ void Image::Samples(VkSampleCountFlagBits samples) { createInfo.samples = sample
 
 void Image::UsageDepthOnly() { Usage(VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT); }
 
-bool Image::Create(const Device &device, VkExtent2D extent, VkFormat format)
+bool Image::Create(const Allocator &allocator, VkExtent2D extent, VkFormat format)
 {
     createInfo.extent.width  = extent.width;
     createInfo.extent.height = extent.height;
     createInfo.format        = format;
-    if (vkCreateImage(device.handle, &createInfo, nullptr, &handle) == VK_SUCCESS)
+
+    // attachments are recreated with the swap chain, keeping them out of shared blocks avoids fragmentation
+    if (createInfo.usage & (VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT))
+        allocationCreateInfo.flags |= VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT;
+
+    if (vmaCreateImage(allocator.handle, &createInfo, &allocationCreateInfo, &handle, &allocation, nullptr) ==
+        VK_SUCCESS)
     {
-        if (label.empty()) vk::SetObjectName(device.handle, (uint64_t)handle, VK_OBJECT_TYPE_IMAGE, label);
+        if (!label.empty())
+        {
+            vk::SetObjectName(allocator.device, (uint64_t)handle, VK_OBJECT_TYPE_IMAGE, label);
+            vmaSetAllocationName(allocator.handle, allocation, label.c_str());
+        }
 
         return true;
     }
@@ -41,18 +53,11 @@ bool Image::Create(const Device &device, VkExtent2D extent, VkFormat format)
     return false;
 }
 
-void Image::Destroy(const Device &device) { vkDestroyImage(device.handle, handle, nullptr); }
-
-bool Image::BindMemory(const Device &device, const Memory &memory, VkDeviceSize offset)
-{
-    return vkBindImageMemory(device.handle, handle, memory.handle, offset) == VK_SUCCESS;
-}
-
-VkMemoryRequirements Image::MemoryRequirements(const Device &device) const
+void Image::Destroy(const Allocator &allocator)
 {
-    VkMemoryRequirements memRequirements;
-    vkGetImageMemoryRequirements(device.handle, handle, &memRequirements);
-    return memRequirements;
+    if (handle != VK_NULL_HANDLE) vmaDestroyImage(allocator.handle, handle, allocation);
+    handle     = VK_NULL_HANDLE;
+    allocation = VK_NULL_HANDLE;
 }
 
 bool Image::CopyFromBuffer(
@@ -71,20 +76,7 @@ bool Image::CopyFromBuffer(
         return false;
     }
 
-    VkBufferImageCopy region{};
-    region.bufferOffset      = 0;
-    region.bufferRowLength   = 0;
-    region.bufferImageHeight = 0;
-
-    region.imageSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
-    region.imageSubresource.mipLevel       = 0;
-    region.imageSubresource.baseArrayLayer = 0;
-    region.imageSubresource.layerCount     = 1;
-
-    region.imageOffset = {0, 0, 0};
-    region.imageExtent = {imageSize.width, imageSize.height, 1};
-
-    vkCmdCopyBufferToImage(commandBuffer, buffer.handle, handle, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+    CmdCopyFromBuffer(commandBuffer, buffer.handle, 0, imageSize);
 
     result = commandPool.EndSingleTimeCommands(device, queue, commandBuffer);
     if (result != VK_SUCCESS)
@@ -111,6 +103,109 @@ bool Image::TransitionLayout(
         return false;
     }
 
+    bool recorded = CmdTransitionLayout(commandBuffer, oldLayout, newLayout);
+
+    result = commandPool.EndSingleTimeCommands(device, queue, commandBuffer);
+    if (result != VK_SUCCESS)
+    {
+        fmtx::Error("Failed to end single time commands");
+        return false;
+    }
+    return recorded;
+}
+
+bool Image::GenerateMipmaps(const Device &device, const CommandPool &commandPool, VkQueue queue, VkFilter filter)
+{
+    VkCommandBuffer commandBuffer;
+    auto result = commandPool.BeginSingleTimeCommands(device, &commandBuffer);
+    if (result != VK_SUCCESS)
+    {
+        fmtx::Error("Failed to begin single time commands");
+        return false;
+    }
+
+    CmdGenerateMipmaps(commandBuffer, filter);
+
+    result = commandPool.EndSingleTimeCommands(device, queue, commandBuffer);
+    if (result != VK_SUCCESS)
+    {
+        fmtx::Error("Failed to end single time commands");
+        return false;
+    }
+    return true;
+}
+
+void Image::CmdCopyFromBuffer(
+    VkCommandBuffer commandBuffer,
+    VkBuffer buffer,
+    VkDeviceSize bufferOffset,
+    VkExtent2D imageSize
+) const
+{
+    VkBufferImageCopy region{};
+    region.bufferOffset      = bufferOffset;
+    region.bufferRowLength   = 0;
+    region.bufferImageHeight = 0;
+
+    region.imageSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel       = 0;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount     = 1;
+
+    region.imageOffset = {0, 0, 0};
+    region.imageExtent = {imageSize.width, imageSize.height, 1};
+
+    vkCmdCopyBufferToImage(commandBuffer, buffer, handle, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+}
+
+void Image::CmdCopyToBuffer(
+    VkCommandBuffer commandBuffer,
+    VkBuffer buffer,
+    VkDeviceSize bufferOffset,
+    VkExtent2D imageSize
+) const
+{
+    VkBufferImageCopy region{};
+    region.bufferOffset      = bufferOffset;
+    region.bufferRowLength   = 0;
+    region.bufferImageHeight = 0;
+
+    region.imageSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel       = 0;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount     = 1;
+
+    region.imageOffset = {0, 0, 0};
+    region.imageExtent = {imageSize.width, imageSize.height, 1};
+
+    vkCmdCopyImageToBuffer(commandBuffer, handle, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, buffer, 1, &region);
+
+    // make the copy visible to the host once the submission's fence is waited on
+    VkBufferMemoryBarrier barrier{};
+    barrier.sType               = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.srcAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask       = VK_ACCESS_HOST_READ_BIT;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.buffer              = buffer;
+    barrier.offset              = bufferOffset;
+    barrier.size                = VK_WHOLE_SIZE;
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_HOST_BIT,
+        0,
+        0,
+        nullptr,
+        1,
+        &barrier,
+        0,
+        nullptr
+    );
+}
+
+bool Image::CmdTransitionLayout(VkCommandBuffer commandBuffer, VkImageLayout oldLayout, VkImageLayout newLayout) const
+{
     VkImageMemoryBarrier barrier{};
     barrier.sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
     barrier.oldLayout           = oldLayout;
@@ -163,6 +258,14 @@ bool Image::TransitionLayout(
         pipelineSrcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
         pipelineDstStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
     }
+    else if (oldLayout == VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL && newLayout == VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL)
+    {
+        barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+        pipelineSrcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        pipelineDstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    }
     else
     {
         fmtx::Error("unsupported layout transition");
@@ -173,25 +276,11 @@ bool Image::TransitionLayout(
         commandBuffer, pipelineSrcStageMask, pipelineDstStageMask, 0, 0, nullptr, 0, nullptr, 1, &barrier
     );
 
-    result = commandPool.EndSingleTimeCommands(device, queue, commandBuffer);
-    if (result != VK_SUCCESS)
-    {
-        fmtx::Error("Failed to end single time commands");
-        return false;
-    }
     return true;
 }
 
-bool Image::GenerateMipmaps(const Device &device, const CommandPool &commandPool, VkQueue queue, VkFilter filter)
+void Image::CmdGenerateMipmaps(VkCommandBuffer commandBuffer, VkFilter filter) const
 {
-    VkCommandBuffer commandBuffer;
-    auto result = commandPool.BeginSingleTimeCommands(device, &commandBuffer);
-    if (result != VK_SUCCESS)
-    {
-        fmtx::Error("Failed to begin single time commands");
-        return false;
-    }
-
     VkImageMemoryBarrier barrier{};
     barrier.sType                           = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
     barrier.image                           = handle;
@@ -289,13 +378,5 @@ bool Image::GenerateMipmaps(const Device &device, const CommandPool &commandPool
         1,
         &barrier
     );
-
-    result = commandPool.EndSingleTimeCommands(device, queue, commandBuffer);
-    if (result != VK_SUCCESS)
-    {
-        fmtx::Error("Failed to end single time commands");
-        return false;
-    }
-    return true;
 }
 } // namespace gl
@@ -4,15 +4,18 @@
 #include "command_pool.hpp"
 #include "core.hpp"
 #include "device.hpp"
-#include "memory.hpp"
+#include "vma.hpp"
 
 namespace gl
 {
+// Memory comes from the VMA allocator, large images and attachments may get a dedicated allocation.
 class Image
 {
 public:
     VkImage handle;
     VkImageCreateInfo createInfo;
+    VmaAllocationCreateInfo allocationCreateInfo;
+    VmaAllocation allocation;
     std::string label;
 
     Image();
@@ -20,10 +23,8 @@ public:
     void MipLevels(uint32_t mipLevels);
     void Samples(VkSampleCountFlagBits samples);
     void UsageDepthOnly();
-    bool Create(const Device &device, VkExtent2D extent, VkFormat format);
-    void Destroy(const Device &device);
-    bool BindMemory(const Device &device, const Memory &memory, VkDeviceSize offset);
-    VkMemoryRequirements MemoryRequirements(const Device &device) const;
+    bool Create(const Allocator &allocator, VkExtent2D extent, VkFormat format);
+    void Destroy(const Allocator &allocator);
     bool CopyFromBuffer(
         const Device &device,
         const CommandPool &commandPool,
@@ -44,5 +45,23 @@ public:
         VkQueue queue,
         VkFilter filter = VK_FILTER_NEAREST
     );
+
+    // recording only, for batching into a caller owned command buffer
+    void CmdCopyFromBuffer(
+        VkCommandBuffer commandBuffer,
+        VkBuffer buffer,
+        VkDeviceSize bufferOffset,
+        VkExtent2D imageSize
+    ) const;
+    // first mip level into a tightly packed buffer, the image has to be in TRANSFER_SRC_OPTIMAL
+    void CmdCopyToBuffer(
+        VkCommandBuffer commandBuffer,
+        VkBuffer buffer,
+        VkDeviceSize bufferOffset,
+        VkExtent2D imageSize
+    ) const;
+    bool CmdTransitionLayout(VkCommandBuffer commandBuffer, VkImageLayout oldLayout, VkImageLayout newLayout) const;
+    // expects every level in TRANSFER_DST_OPTIMAL, leaves them all in SHADER_READ_ONLY_OPTIMAL
+    void CmdGenerateMipmaps(VkCommandBuffer commandBuffer, VkFilter filter = VK_FILTER_NEAREST) const;
 };
 } // namespace gl
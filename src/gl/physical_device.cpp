@@ -5,14 +5,23 @@
 
 namespace gl
 {
-PhysicalDevice::PhysicalDevice() : handle(VK_NULL_HANDLE), depthFormat(VK_FORMAT_UNDEFINED) {}
+PhysicalDevice::PhysicalDevice() :
+    handle(VK_NULL_HANDLE),
+    depthFormat(VK_FORMAT_UNDEFINED),
+    timelineSemaphore(false),
+    presentable(false)
+{
+}
 
 bool PhysicalDevice::IsDiscreteGPU() const { return properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU; }
 
 bool PhysicalDevice::IsValid() const
 {
     bool valid    = handle != VK_NULL_HANDLE;
-    bool complete = queueFamilyIndices.graphicsFamily.has_value() && queueFamilyIndices.presentFamily.has_value();
+    bool complete = queueFamilyIndices.graphicsFamily.has_value() &&
+                    (queueFamilyIndices.presentFamily.has_value() || !presentable);
+    if (!presentable) return valid && complete && features.samplerAnisotropy && timelineSemaphore;
+
     bool deviceExtensionsSupported = IsExtensionSupported({VK_KHR_SWAPCHAIN_EXTENSION_NAME});
     bool swapChainAdequate         = false;
     bool formatAvailable           = false;
@@ -30,7 +39,7 @@ bool PhysicalDevice::IsValid() const
         }
     }
     return valid && complete && deviceExtensionsSupported && swapChainAdequate && formatAvailable &&
-           features.samplerAnisotropy;
+           features.samplerAnisotropy && timelineSemaphore;
 }
 
 bool PhysicalDevice::IsExtensionSupported(const gl::CStrings &checkExtensions) const
@@ -47,6 +56,8 @@ bool PhysicalDevice::IsExtensionSupported(const gl::CStrings &checkExtensions) c
 
 void PhysicalDevice::QuerySwapChainSupport(const gl::Surface &surface)
 {
+    if (surface.handle == VK_NULL_HANDLE) return;
+
     vkGetPhysicalDeviceSurfaceCapabilitiesKHR(handle, surface.handle, &swapChainSupport.capabilities);
     uint32_t formatCount;
     vkGetPhysicalDeviceSurfaceFormatsKHR(handle, surface.handle, &formatCount, nullptr);
@@ -79,11 +90,20 @@ void PhysicalDevice::QueryQueueFamilies(const gl::Surface &surface)
         if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) queueFamilyIndices.graphicsFamily = familyIndex;
 
         VkBool32 presentSupport = false;
-        vkGetPhysicalDeviceSurfaceSupportKHR(handle, familyIndex, surface.handle, &presentSupport);
+        if (surface.handle != VK_NULL_HANDLE)
+            vkGetPhysicalDeviceSurfaceSupportKHR(handle, familyIndex, surface.handle, &presentSupport);
 
         if (presentSupport) queueFamilyIndices.presentFamily = familyIndex;
 
-        //
+        // prefer a transfer only family (DMA engine) over one that also does compute
+        bool transferOnly = (queueFamily.queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)) == 0;
+        bool noGraphics   = (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) == 0;
+        if ((queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT) && noGraphics)
+        {
+            if (!queueFamilyIndices.transferFamily.has_value() || transferOnly)
+                queueFamilyIndices.transferFamily = familyIndex;
+        }
+
         ++familyIndex;
     }
 }
@@ -160,6 +180,15 @@ std::vector<PhysicalDevice> GetPhysicalDevices(const gl::Instance &instance, con
         vkGetPhysicalDeviceProperties(devices[i].handle, &devices[i].properties);
         vkGetPhysicalDeviceFeatures(devices[i].handle, &devices[i].features);
 
+        VkPhysicalDeviceTimelineSemaphoreFeatures timelineSemaphoreFeatures{};
+        timelineSemaphoreFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+        VkPhysicalDeviceFeatures2 features2{};
+        features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features2.pNext = &timelineSemaphoreFeatures;
+        vkGetPhysicalDeviceFeatures2(devices[i].handle, &features2);
+        devices[i].timelineSemaphore = timelineSemaphoreFeatures.timelineSemaphore == VK_TRUE;
+
+        devices[i].presentable = surface.handle != VK_NULL_HANDLE;
         devices[i].QuerySwapChainSupport(surface);
         devices[i].QueryQueueFamilies(surface);
         vkGetPhysicalDeviceMemoryProperties(devices[i].handle, &devices[i].memProperties);
@@ -215,6 +244,10 @@ PhysicalDevice SelectBestPhysicalDevice(const std::vector<PhysicalDevice> &devic
     fmtx::Info(fmt::format("Selected device: {}", best.properties.deviceName));
     fmtx::Info(fmt::format("Selected device API version: {}", best.properties.apiVersion));
     fmtx::Info(fmt::format("Selected device driver version: {}", best.properties.driverVersion));
+    if (best.queueFamilyIndices.transferFamily.has_value())
+        fmtx::Info(fmt::format("Selected device transfer queue family: {}", *best.queueFamilyIndices.transferFamily));
+    else
+        fmtx::Info("Selected device has no dedicated transfer queue, uploads use the graphics queue");
 
     return best;
 }
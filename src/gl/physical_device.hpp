@@ -9,6 +9,8 @@ struct QueueFamilyIndices
 {
     std::optional<uint32_t> graphicsFamily;
     std::optional<uint32_t> presentFamily;
+    // transfer capable family without graphics, copies there run alongside rendering
+    std::optional<uint32_t> transferFamily;
 };
 
 struct SwapChainSupportDetails
@@ -31,6 +33,9 @@ public:
     SwapChainSupportDetails swapChainSupport;
     VkPhysicalDeviceMemoryProperties memProperties;
     VkFormat depthFormat;
+    bool timelineSemaphore;
+    // queried against a surface, without one (headless) presentation and swap chain support are not required
+    bool presentable;
 
     PhysicalDevice();
 
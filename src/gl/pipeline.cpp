@@ -51,11 +51,13 @@ Pipeline::Pipeline() :
     colorBlendStateCreateInfo.blendConstants[3] = 0.0f; // Optional
 }
 
-bool Pipeline::Create(const gl::Device &device)
+bool Pipeline::Create(const gl::Device &device, const PipelineCache &pipelineCache)
 {
-    if (vkCreateGraphicsPipelines(device.handle, VK_NULL_HANDLE, 1, &createInfo, nullptr, &handle) == VK_SUCCESS)
+    sdl::Stopwatch stopwatch;
+    auto result = vkCreateGraphicsPipelines(device.handle, pipelineCache.handle, 1, &createInfo, nullptr, &handle);
+    if (result == VK_SUCCESS)
     {
-        fmtx::Info("Created graphics pipeline");
+        fmtx::Info(fmt::format("Created graphics pipeline in {:.2f} ms", stopwatch.ElapsedMilliseconds()));
 
         if (!label.empty()) vk::SetObjectName(device.handle, (uint64_t)handle, VK_OBJECT_TYPE_PIPELINE, label);
 
@@ -2,6 +2,7 @@
 
 #include "core.hpp"
 #include "device.hpp"
+#include "pipeline_cache.hpp"
 #include "render_pass.hpp"
 #include <unordered_map>
 
@@ -34,7 +35,7 @@ public:
 
     Pipeline();
 
-    bool Create(const gl::Device &device);
+    bool Create(const gl::Device &device, const PipelineCache &pipelineCache);
     void Destroy(const gl::Device &device);
     void Label(const std::string &str);
     bool CreateLayout(const gl::Device &device);
@@ -0,0 +1,124 @@
+#include "pipeline_cache.hpp"
+#include "vulkan.hpp"
+#include <cstring>
+
+namespace gl
+{
+PipelineCache::PipelineCache() : handle(VK_NULL_HANDLE), createInfo({}), properties({}), warm(false)
+{
+    createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+}
+
+bool PipelineCache::Create(const Device &device, const PhysicalDevice &physicalDevice, const std::string &filename)
+{
+    this->filename = filename;
+    properties     = physicalDevice.properties;
+    warm           = false;
+
+    // mapped only until the driver has copied the data in, Save replaces the file later
+    auto file = io::MappedFile::Open(filename);
+    if (file->IsEmpty())
+        fmtx::Info(fmt::format("Pipeline cache {} not found, starting cold", filename));
+    else if (!isCompatible(file->View()))
+        fmtx::Warn(fmt::format("Pipeline cache {} was written by another device or driver, starting cold", filename));
+    else
+        warm = true;
+
+    auto data                  = warm ? file->View().Sub(sizeof(FileHeader)) : io::ByteView();
+    createInfo.initialDataSize = data.Size();
+    createInfo.pInitialData    = data.Data();
+
+    auto result = vkCreatePipelineCache(device.handle, &createInfo, nullptr, &handle);
+    if (result != VK_SUCCESS && warm)
+    {
+        // driver refused the data after all, a cold cache is still better than none
+        fmtx::Warn(fmt::format("Pipeline cache {} rejected by driver, starting cold", filename));
+        warm                       = false;
+        createInfo.initialDataSize = 0;
+        createInfo.pInitialData    = nullptr;
+        result                     = vkCreatePipelineCache(device.handle, &createInfo, nullptr, &handle);
+    }
+    createInfo.pInitialData = nullptr;
+    if (result != VK_SUCCESS)
+    {
+        fmtx::Error("Failed to create pipeline cache");
+        return false;
+    }
+
+    if (!label.empty()) vk::SetObjectName(device.handle, (uint64_t)handle, VK_OBJECT_TYPE_PIPELINE_CACHE, label);
+    if (warm)
+        fmtx::Info(fmt::format("Pipeline cache loaded from {}, {} KB", filename, createInfo.initialDataSize / 1024));
+
+    return true;
+}
+
+void PipelineCache::Destroy(const Device &device)
+{
+    if (handle != VK_NULL_HANDLE) vkDestroyPipelineCache(device.handle, handle, nullptr);
+    handle = VK_NULL_HANDLE;
+}
+
+bool PipelineCache::Save(const Device &device) const
+{
+    if (handle == VK_NULL_HANDLE) return false;
+
+    size_t dataSize = 0;
+    if (vkGetPipelineCacheData(device.handle, handle, &dataSize, nullptr) != VK_SUCCESS)
+    {
+        fmtx::Error("Failed to query pipeline cache size");
+        return false;
+    }
+
+    std::vector<char> bytes(sizeof(FileHeader) + dataSize);
+    if (vkGetPipelineCacheData(device.handle, handle, &dataSize, bytes.data() + sizeof(FileHeader)) != VK_SUCCESS)
+    {
+        fmtx::Error("Failed to read pipeline cache data");
+        return false;
+    }
+    bytes.resize(sizeof(FileHeader) + dataSize);
+
+    auto fileHeader = header(dataSize);
+    std::memcpy(bytes.data(), &fileHeader, sizeof(FileHeader));
+
+    if (!io::BinaryFile::Save(filename, bytes.data(), bytes.size()))
+    {
+        fmtx::Error(fmt::format("Failed to save pipeline cache to {}", filename));
+        return false;
+    }
+    fmtx::Info(fmt::format("Pipeline cache saved to {}, {} KB", filename, dataSize / 1024));
+
+    return true;
+}
+
+PipelineCache::FileHeader PipelineCache::header(VkDeviceSize dataSize) const
+{
+    FileHeader fileHeader{};
+    fileHeader.magic         = Magic;
+    fileHeader.version       = Version;
+    fileHeader.vendorID      = properties.vendorID;
+    fileHeader.deviceID      = properties.deviceID;
+    fileHeader.driverVersion = properties.driverVersion;
+    fileHeader.dataSize      = dataSize;
+    std::memcpy(fileHeader.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE);
+
+    return fileHeader;
+}
+
+bool PipelineCache::isCompatible(io::ByteView bytes) const
+{
+    if (bytes.Size() < sizeof(FileHeader) + sizeof(VkPipelineCacheHeaderVersionOne)) return false;
+
+    FileHeader fileHeader;
+    std::memcpy(&fileHeader, bytes.Data(), sizeof(FileHeader));
+    auto expected = header(bytes.Size() - sizeof(FileHeader));
+    if (std::memcmp(&fileHeader, &expected, sizeof(FileHeader)) != 0) return false;
+
+    // the driver header repeats the device identity, a truncated or foreign blob fails here
+    VkPipelineCacheHeaderVersionOne driverHeader;
+    std::memcpy(&driverHeader, bytes.Data() + sizeof(FileHeader), sizeof(driverHeader));
+
+    return driverHeader.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+           driverHeader.vendorID == properties.vendorID && driverHeader.deviceID == properties.deviceID &&
+           std::memcmp(driverHeader.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+} // namespace gl
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "../io/binary.hpp"
+#include "core.hpp"
+#include "device.hpp"
+#include "physical_device.hpp"
+
+namespace gl
+{
+// VkPipelineCache kept on disk between runs, shared by every pipeline the app creates.
+// The file starts with a header of the device it was written on. Data from another GPU, driver version or
+// cache UUID is ignored and the cache starts cold instead of handing the driver a blob it may reject.
+class PipelineCache
+{
+public:
+    VkPipelineCache handle;
+    VkPipelineCacheCreateInfo createInfo;
+    std::string label;
+
+    PipelineCache();
+    bool Create(const Device &device, const PhysicalDevice &physicalDevice, const std::string &filename);
+    void Destroy(const Device &device);
+    bool Save(const Device &device) const;
+    // true when pipelines are created from data loaded from disk
+    bool IsWarm() const { return warm; }
+
+private:
+    struct FileHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t vendorID;
+        uint32_t deviceID;
+        uint32_t driverVersion;
+        uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+        uint32_t reserved; // keeps the struct free of padding so headers compare bytewise
+        uint64_t dataSize;
+    };
+
+    static constexpr uint32_t Magic   = 0x48435044; // "DPCH"
+    static constexpr uint32_t Version = 1;
+
+    FileHeader header(VkDeviceSize dataSize) const;
+    bool isCompatible(io::ByteView bytes) const;
+
+private:
+    std::string filename;
+    VkPhysicalDeviceProperties properties;
+    bool warm;
+};
+} // namespace gl
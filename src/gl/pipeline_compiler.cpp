@@ -0,0 +1,125 @@
+#include "pipeline_compiler.hpp"
+#include "vulkan.hpp"
+#include <algorithm>
+#include <chrono>
+
+namespace gl
+{
+PipelineCompiler::PipelineCompiler() : device(nullptr), pipelineCache(nullptr), failed(false) {}
+
+PipelineCompiler::~PipelineCompiler() { Destroy(); }
+
+bool PipelineCompiler::Create(const Device &device, const PipelineCache &pipelineCache, uint32 threads)
+{
+    this->device        = &device;
+    this->pipelineCache = &pipelineCache;
+
+    pool = std::make_unique<Parallel::Pool>(threads == 0 ? Parallel::ThreadCount() : threads);
+    fmtx::Info(fmt::format("Pipeline compiler uses {} threads", pool->Size()));
+
+    return true;
+}
+
+void PipelineCompiler::Destroy()
+{
+    // pool destructor finishes queued jobs before joining
+    pool.reset();
+    entries.clear();
+    jobs.clear();
+    failed = false;
+}
+
+PipelineCompiler::Future PipelineCompiler::Compile(Pipeline &pipeline, const Pipeline *placeholder)
+{
+    auto future = Submit([this, &pipeline]() { return pipeline.Create(*device, *pipelineCache); });
+    entries[&pipeline] = Entry{future, placeholder};
+
+    return future;
+}
+
+std::vector<PipelineCompiler::Future> PipelineCompiler::Compile(
+    const std::vector<Pipeline *> &pipelines,
+    const Pipeline *placeholder
+)
+{
+    std::vector<Future> futures;
+    futures.reserve(pipelines.size());
+    for (auto *pipeline : pipelines) futures.push_back(Compile(*pipeline, placeholder));
+
+    return futures;
+}
+
+PipelineCompiler::Future PipelineCompiler::Submit(std::function<bool()> job)
+{
+    if (!pool)
+    {
+        fmtx::Error("Pipeline compiler used before Create");
+        std::promise<bool> failed;
+        failed.set_value(false);
+        return failed.get_future().share();
+    }
+
+    // finished jobs are dropped so the list only grows with work in flight, Wait still reports their failures
+    auto finished = std::remove_if(
+        jobs.begin(),
+        jobs.end(),
+        [this](const Future &job)
+        {
+            if (!isReady(job)) return false;
+            failed |= !job.get();
+            return true;
+        }
+    );
+    jobs.erase(finished, jobs.end());
+
+    auto future = pool->Submit(std::move(job)).share();
+    jobs.push_back(future);
+
+    return future;
+}
+
+const Pipeline *PipelineCompiler::Select(const Pipeline &pipeline) const
+{
+    auto it = entries.find(&pipeline);
+    if (it == entries.end()) return pipeline.handle != VK_NULL_HANDLE ? &pipeline : nullptr;
+
+    const auto &entry = it->second;
+    if (isReady(entry.future) && entry.future.get()) return &pipeline;
+
+    return entry.placeholder;
+}
+
+bool PipelineCompiler::IsReady(const Pipeline &pipeline) const
+{
+    auto it = entries.find(&pipeline);
+    if (it == entries.end()) return pipeline.handle != VK_NULL_HANDLE;
+
+    return isReady(it->second.future) && it->second.future.get();
+}
+
+bool PipelineCompiler::Wait()
+{
+    sdl::Stopwatch stopwatch;
+    auto pending = Pending();
+
+    bool ok = !failed;
+    for (auto &job : jobs) ok = job.get() && ok;
+    jobs.clear();
+    failed = false;
+
+    if (pending > 0)
+        fmtx::Info(fmt::format("Waited {:.2f} ms for {} pipeline jobs", stopwatch.ElapsedMilliseconds(), pending));
+
+    return ok;
+}
+
+uint32 PipelineCompiler::Pending() const
+{
+    return uint32(std::count_if(jobs.begin(), jobs.end(), [](const Future &job) { return !isReady(job); }));
+}
+
+bool PipelineCompiler::isReady(const Future &future)
+{
+    return future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+} // namespace gl
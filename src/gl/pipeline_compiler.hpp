@@ -0,0 +1,59 @@
+#pragma once
+
+#include "../core/parallel.hpp"
+#include "core.hpp"
+#include "device.hpp"
+#include "pipeline.hpp"
+#include "pipeline_cache.hpp"
+#include <unordered_map>
+
+namespace gl
+{
+// Compiles pipelines on a pool of worker threads against one shared pipeline cache.
+// A pipeline handed to Compile must have its layout created and must not be touched until its future is ready,
+// the render thread asks Select() which pipeline to bind meanwhile.
+// Compile and Select are meant for the render thread, compilation itself runs concurrently.
+class PipelineCompiler
+{
+public:
+    using Future = std::shared_future<bool>;
+
+    PipelineCompiler();
+    ~PipelineCompiler();
+    // threads = 0 uses one worker per core
+    bool Create(const Device &device, const PipelineCache &pipelineCache, uint32 threads = 0);
+    // waits for compilation in progress
+    void Destroy();
+    // placeholder must be compiled and share the pipeline layout, it is bound until the pipeline is ready
+    Future Compile(Pipeline &pipeline, const Pipeline *placeholder = nullptr);
+    std::vector<Future> Compile(const std::vector<Pipeline *> &pipelines, const Pipeline *placeholder = nullptr);
+    // any other pipeline creation, e.g. third party renderers creating their own pipelines against Cache()
+    Future Submit(std::function<bool()> job);
+    // the pipeline once compiled, its placeholder until then or when compilation failed, nullptr without one
+    const Pipeline *Select(const Pipeline &pipeline) const;
+    bool IsReady(const Pipeline &pipeline) const;
+    // blocks until every job finished, false when any of them failed
+    bool Wait();
+    uint32 Pending() const;
+    const PipelineCache &Cache() const { return *pipelineCache; }
+
+private:
+    struct Entry
+    {
+        Future future;
+        const Pipeline *placeholder;
+    };
+
+    static bool isReady(const Future &future);
+
+private:
+    const Device *device;
+    const PipelineCache *pipelineCache;
+    std::unique_ptr<Parallel::Pool> pool;
+    std::unordered_map<const Pipeline *, Entry> entries;
+    // unfinished jobs plus finished ones not yet pruned by Submit
+    std::vector<Future> jobs;
+    // a job pruned since the last Wait failed
+    bool failed;
+};
+} // namespace gl
@@ -0,0 +1,363 @@
+#include "profiler.hpp"
+#include "../io/binary.hpp"
+#include "vulkan.hpp"
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+namespace gl
+{
+static double Percentile(const std::vector<double> &sorted, double p)
+{
+    if (sorted.empty()) return 0;
+    auto index = size_t(std::ceil(p * double(sorted.size())));
+    return sorted[std::min(sorted.size() - 1, index > 0 ? index - 1 : 0)];
+}
+
+static std::string EscapeJson(const std::string &str)
+{
+    std::string escaped;
+    escaped.reserve(str.size());
+    for (char c : str)
+    {
+        if (c == '"' || c == '\\')
+            escaped += {'\\', c};
+        else if (uint8_t(c) < 0x20)
+            escaped += fmt::format("\\u{:04x}", int(c));
+        else
+            escaped += c;
+    }
+    return escaped;
+}
+
+Profiler::CpuScope::CpuScope(Profiler &profiler, const char *name) : profiler(profiler)
+{
+    profiler.BeginCpuScope(name);
+}
+
+Profiler::CpuScope::~CpuScope() { profiler.EndCpuScope(); }
+
+Profiler::Profiler() : device(nullptr), queryPool(VK_NULL_HANDLE), timestampPeriod(0), frameNumber(0), frameOpen(false)
+{
+}
+
+bool Profiler::Create(
+    const Device &device,
+    const PhysicalDevice &physicalDevice,
+    uint32_t framesInFlight,
+    uint32_t historySize
+)
+{
+    this->device    = &device;
+    timestampPeriod = physicalDevice.properties.limits.timestampPeriod;
+    slots.assign(framesInFlight, Slot{});
+    history.assign(std::max(historySize, 1u), Frame{});
+    clock.Restart();
+
+    auto graphicsFamily = physicalDevice.queueFamilyIndices.graphicsFamily.value();
+    if (physicalDevice.queueFamilies[graphicsFamily].timestampValidBits == 0 || timestampPeriod <= 0)
+    {
+        fmtx::Warn("Graphics queue does not support timestamps, profiling CPU only");
+        return true;
+    }
+
+    VkQueryPoolCreateInfo createInfo{};
+    createInfo.sType      = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    createInfo.queryType  = VK_QUERY_TYPE_TIMESTAMP;
+    createInfo.queryCount = QueriesPerSlot * framesInFlight;
+    if (vkCreateQueryPool(device.handle, &createInfo, nullptr, &queryPool) != VK_SUCCESS)
+    {
+        fmtx::Error("Failed to create timestamp query pool");
+        return false;
+    }
+    vk::SetObjectName(device.handle, (uint64_t)queryPool, VK_OBJECT_TYPE_QUERY_POOL, "Profiler Timestamps");
+
+    fmtx::Info(fmt::format("Profiler keeps {} frames, GPU timestamp period {} ns", history.size(), timestampPeriod));
+
+    return true;
+}
+
+void Profiler::Destroy(const Device &device)
+{
+    if (queryPool != VK_NULL_HANDLE) vkDestroyQueryPool(device.handle, queryPool, nullptr);
+    queryPool = VK_NULL_HANDLE;
+    slots.clear();
+    cpuStack.clear();
+    frameOpen = false;
+}
+
+void Profiler::BeginFrame(uint32_t slot)
+{
+    if (slot < slots.size()) resolve(slot);
+
+    auto time = now();
+    if (frameOpen)
+    {
+        auto &frame = history[frameNumber % history.size()];
+        frame.cpu   = time - frame.start;
+        ++frameNumber;
+    }
+
+    // scopes left open by the previous frame are dropped
+    cpuStack.clear();
+
+    auto &frame       = history[frameNumber % history.size()];
+    frame.number      = frameNumber;
+    frame.start       = time;
+    frame.submit      = time;
+    frame.cpu         = 0;
+    frame.gpu         = 0;
+    frame.gpuResolved = false;
+    frame.cpuScopes.clear();
+    frame.gpuScopes.clear();
+    frameOpen = true;
+}
+
+void Profiler::Finish()
+{
+    if (frameOpen)
+    {
+        auto &frame = history[frameNumber % history.size()];
+        frame.cpu   = now() - frame.start;
+        ++frameNumber;
+        frameOpen = false;
+    }
+    cpuStack.clear();
+
+    for (uint32_t slot = 0; slot < slots.size(); ++slot) resolve(slot);
+}
+
+void Profiler::Submitted()
+{
+    if (frameOpen) history[frameNumber % history.size()].submit = now();
+}
+
+void Profiler::BeginCpuScope(const char *name)
+{
+    if (!frameOpen) return;
+    cpuStack.push_back({name, uint32_t(cpuStack.size()), now()});
+}
+
+double Profiler::EndCpuScope()
+{
+    if (!frameOpen || cpuStack.empty()) return 0;
+
+    auto scope = std::move(cpuStack.back());
+    cpuStack.pop_back();
+    auto duration = now() - scope.start;
+    history[frameNumber % history.size()].cpuScopes.push_back(
+        {std::move(scope.name), scope.depth, scope.start, duration}
+    );
+
+    return duration;
+}
+
+void Profiler::CmdBeginFrame(VkCommandBuffer commandBuffer, uint32_t slot)
+{
+    if (queryPool == VK_NULL_HANDLE || slot >= slots.size()) return;
+
+    // a slot may be recorded more than once before submission, only the last recording counts
+    auto &pending    = slots[slot];
+    pending.frame    = frameNumber;
+    pending.recorded = true;
+    pending.scopes.clear();
+    pending.open.clear();
+
+    vkCmdResetQueryPool(commandBuffer, queryPool, slot * QueriesPerSlot, QueriesPerSlot);
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool, slot * QueriesPerSlot);
+}
+
+void Profiler::CmdEndFrame(VkCommandBuffer commandBuffer, uint32_t slot)
+{
+    if (queryPool == VK_NULL_HANDLE || slot >= slots.size() || !slots[slot].recorded) return;
+
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, slot * QueriesPerSlot + 1);
+}
+
+void Profiler::CmdBeginScope(VkCommandBuffer commandBuffer, uint32_t slot, const char *name)
+{
+    if (queryPool == VK_NULL_HANDLE || slot >= slots.size() || !slots[slot].recorded) return;
+
+    auto &pending = slots[slot];
+    if (pending.scopes.size() == MaxGpuScopes)
+    {
+        // still tracked so the matching end is ignored as well
+        pending.open.push_back(UINT32_MAX);
+        return;
+    }
+
+    uint32_t query = slot * QueriesPerSlot + 2 + uint32_t(pending.scopes.size()) * 2;
+    pending.open.push_back(uint32_t(pending.scopes.size()));
+    pending.scopes.push_back({name, uint32_t(pending.open.size() - 1), query});
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool, query);
+}
+
+void Profiler::CmdEndScope(VkCommandBuffer commandBuffer, uint32_t slot)
+{
+    if (queryPool == VK_NULL_HANDLE || slot >= slots.size() || slots[slot].open.empty()) return;
+
+    auto &pending = slots[slot];
+    auto scope    = pending.open.back();
+    pending.open.pop_back();
+    if (scope == UINT32_MAX) return;
+
+    vkCmdWriteTimestamp(
+        commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, pending.scopes[scope].query + 1
+    );
+}
+
+void Profiler::resolve(uint32_t slot)
+{
+    auto &pending = slots[slot];
+    if (queryPool == VK_NULL_HANDLE || !pending.recorded) return;
+    pending.recorded = false;
+
+    // the frame fell out of the ring while in flight
+    if (frameNumber - pending.frame >= history.size()) return;
+    auto &frame = history[pending.frame % history.size()];
+    if (frame.number != pending.frame) return;
+
+    // value and availability per query, unsubmitted or unbalanced queries are simply unavailable
+    uint32_t count = 2 + 2 * uint32_t(pending.scopes.size());
+    std::vector<uint64_t> results(count * 2, 0);
+    auto result = vkGetQueryPoolResults(
+        device->handle,
+        queryPool,
+        slot * QueriesPerSlot,
+        count,
+        results.size() * sizeof(uint64_t),
+        results.data(),
+        2 * sizeof(uint64_t),
+        VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT
+    );
+    if (result != VK_SUCCESS && result != VK_NOT_READY) return;
+
+    auto available = [&](uint32_t query) { return results[query * 2 + 1] != 0; };
+    auto timestamp = [&](uint32_t query) { return results[query * 2]; };
+    auto toMs      = [&](uint64_t from, uint64_t to) { return double(to - from) * timestampPeriod / 1e6; };
+    if (!available(0) || !available(1)) return;
+
+    auto begin        = timestamp(0);
+    frame.gpu         = toMs(begin, timestamp(1));
+    frame.gpuResolved = true;
+    for (uint32_t i = 0; i < pending.scopes.size(); ++i)
+    {
+        uint32_t query = 2 + i * 2;
+        if (!available(query) || !available(query + 1)) continue;
+
+        const auto &scope = pending.scopes[i];
+        frame.gpuScopes.push_back(
+            {scope.name, scope.depth, toMs(begin, timestamp(query)), toMs(timestamp(query), timestamp(query + 1))}
+        );
+    }
+}
+
+std::vector<const Profiler::Frame *> Profiler::History() const
+{
+    std::vector<const Frame *> frames;
+    uint64_t count = std::min<uint64_t>(frameNumber, history.size() - 1);
+    frames.reserve(count);
+    for (uint64_t number = frameNumber - count; number < frameNumber; ++number)
+        frames.push_back(&history[number % history.size()]);
+
+    return frames;
+}
+
+std::vector<Profiler::Stats> Profiler::Summarize() const
+{
+    std::vector<Stats> stats;
+    std::vector<std::vector<double>> samples;
+    std::unordered_map<std::string, size_t> cpuIndex;
+    std::unordered_map<std::string, size_t> gpuIndex;
+
+    auto add = [&](std::unordered_map<std::string, size_t> &index, const std::string &name, bool gpu, double ms) {
+        auto it = index.find(name);
+        if (it == index.end())
+        {
+            it = index.emplace(name, stats.size()).first;
+            stats.push_back({name, gpu, 0, 0, 0, 0, 0, 0});
+            samples.emplace_back();
+        }
+        samples[it->second].push_back(ms);
+    };
+
+    auto frames = History();
+    for (const auto *frame : frames) add(cpuIndex, "Frame", false, frame->cpu);
+    for (const auto *frame : frames)
+        if (frame->gpuResolved) add(gpuIndex, "Frame", true, frame->gpu);
+
+    // a scope hit several times in a frame counts once with its total
+    std::unordered_map<std::string, double> perFrame;
+    std::vector<std::string> order;
+    auto sumScopes = [&](const std::vector<Scope> &scopes, std::unordered_map<std::string, size_t> &index, bool gpu) {
+        perFrame.clear();
+        order.clear();
+        for (const auto &scope : scopes)
+        {
+            if (perFrame.emplace(scope.name, 0).second) order.push_back(scope.name);
+            perFrame[scope.name] += scope.duration;
+        }
+        for (const auto &name : order) add(index, name, gpu, perFrame[name]);
+    };
+    for (const auto *frame : frames) sumScopes(frame->cpuScopes, cpuIndex, false);
+    for (const auto *frame : frames) sumScopes(frame->gpuScopes, gpuIndex, true);
+
+    for (size_t i = 0; i < stats.size(); ++i)
+    {
+        auto &values = samples[i];
+        std::sort(values.begin(), values.end());
+        double sum = 0;
+        for (auto value : values) sum += value;
+
+        stats[i].count   = uint32_t(values.size());
+        stats[i].average = values.empty() ? 0 : sum / double(values.size());
+        stats[i].p50     = Percentile(values, 0.50);
+        stats[i].p95     = Percentile(values, 0.95);
+        stats[i].p99     = Percentile(values, 0.99);
+        stats[i].max     = values.empty() ? 0 : values.back();
+    }
+
+    return stats;
+}
+
+bool Profiler::ExportChromeTrace(const std::string &filename) const
+{
+    // complete events in microseconds, CPU on thread 1 and GPU on thread 2 of one process.
+    // GPU clocks are not calibrated against the CPU, each GPU frame is placed at the submit of its CPU frame.
+    std::string json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    json += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n";
+    json += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}";
+
+    auto event = [&json](const std::string &name, const char *category, double start, double duration, int tid) {
+        json += fmt::format(
+            ",\n{{\"name\":\"{}\",\"cat\":\"{}\",\"ph\":\"X\",\"ts\":{:.3f},\"dur\":{:.3f},\"pid\":1,\"tid\":{}}}",
+            EscapeJson(name),
+            category,
+            start * 1000.0,
+            duration * 1000.0,
+            tid
+        );
+    };
+
+    for (const auto *frame : History())
+    {
+        event(fmt::format("Frame {}", frame->number), "frame", frame->start, frame->cpu, 1);
+        for (const auto &scope : frame->cpuScopes) event(scope.name, "cpu", scope.start, scope.duration, 1);
+
+        if (!frame->gpuResolved) continue;
+        event(fmt::format("Frame {}", frame->number), "frame", frame->submit, frame->gpu, 2);
+        for (const auto &scope : frame->gpuScopes)
+            event(scope.name, "gpu", frame->submit + scope.start, scope.duration, 2);
+    }
+    json += "\n]}\n";
+
+    if (!io::BinaryFile::Save(filename, json.data(), json.size()))
+    {
+        fmtx::Error(fmt::format("Failed to write trace {}", filename));
+        return false;
+    }
+    fmtx::Info(fmt::format("Trace written to {}", filename));
+
+    return true;
+}
+} // namespace gl
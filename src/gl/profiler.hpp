@@ -0,0 +1,132 @@
+#pragma once
+
+#include "core.hpp"
+#include "device.hpp"
+#include "physical_device.hpp"
+
+namespace gl
+{
+// CPU scopes and GPU timestamps of the last historySize frames.
+// GPU work is timed per frame in flight slot: CommandBuffer::Begin/End write the frame timestamps and every debug
+// label region becomes a scope. Results of a slot are read back when it comes around again, after its fence.
+// Single threaded, scopes are recorded on the render thread only.
+class Profiler
+{
+public:
+    // times in milliseconds, CPU starts are relative to Create, GPU starts to the GPU start of their frame
+    struct Scope
+    {
+        std::string name;
+        uint32_t depth;
+        double start;
+        double duration;
+    };
+
+    struct Frame
+    {
+        uint64_t number  = 0;
+        double start     = 0;
+        double submit    = 0;
+        double cpu       = 0;
+        double gpu       = 0;
+        bool gpuResolved = false;
+        std::vector<Scope> cpuScopes;
+        std::vector<Scope> gpuScopes;
+    };
+
+    struct Stats
+    {
+        std::string name;
+        bool gpu;
+        uint32_t count;
+        double average;
+        double p50;
+        double p95;
+        double p99;
+        double max;
+    };
+
+    class CpuScope
+    {
+    public:
+        CpuScope(Profiler &profiler, const char *name);
+        ~CpuScope();
+
+    private:
+        Profiler &profiler;
+    };
+
+    Profiler();
+    bool Create(
+        const Device &device,
+        const PhysicalDevice &physicalDevice,
+        uint32_t framesInFlight,
+        uint32_t historySize = 240
+    );
+    void Destroy(const Device &device);
+    // closes the running frame and starts the next one on slot, the slot's fence has to be signaled already
+    void BeginFrame(uint32_t slot);
+    // closes the running frame and reads back every slot, the device has to be idle
+    void Finish();
+    // marks when the frame was handed to the queue, GPU scopes are placed from there in traces
+    void Submitted();
+    void BeginCpuScope(const char *name);
+    // returns the duration of the closed scope in milliseconds, 0 when nothing was recorded
+    double EndCpuScope();
+
+    // recording, CommandBuffer calls these for every primary command buffer it begins
+    void CmdBeginFrame(VkCommandBuffer commandBuffer, uint32_t slot);
+    void CmdEndFrame(VkCommandBuffer commandBuffer, uint32_t slot);
+    void CmdBeginScope(VkCommandBuffer commandBuffer, uint32_t slot, const char *name);
+    void CmdEndScope(VkCommandBuffer commandBuffer, uint32_t slot);
+
+    // finished frames, oldest first
+    std::vector<const Frame *> History() const;
+    // frame totals first, then scopes summed per frame, in order of first appearance
+    std::vector<Stats> Summarize() const;
+    bool ExportChromeTrace(const std::string &filename) const;
+    bool HasGpuTimestamps() const { return queryPool != VK_NULL_HANDLE; }
+
+private:
+    static constexpr uint32_t MaxGpuScopes   = 64;
+    // frame begin and end followed by begin and end of each scope
+    static constexpr uint32_t QueriesPerSlot = 2 + 2 * MaxGpuScopes;
+
+    struct PendingScope
+    {
+        std::string name;
+        uint32_t depth;
+        uint32_t query;
+    };
+
+    struct Slot
+    {
+        uint64_t frame = 0;
+        bool recorded  = false;
+        std::vector<PendingScope> scopes;
+        std::vector<uint32_t> open;
+    };
+
+    struct OpenScope
+    {
+        std::string name;
+        uint32_t depth;
+        double start;
+    };
+
+    void resolve(uint32_t slot);
+    double now() const { return clock.ElapsedMilliseconds(); }
+
+private:
+    const Device *device;
+    VkQueryPool queryPool;
+    // nanoseconds per timestamp tick
+    double timestampPeriod;
+    sdl::Stopwatch clock;
+    std::vector<Slot> slots;
+    std::vector<Frame> history;
+    std::vector<OpenScope> cpuStack;
+    uint64_t frameNumber;
+    bool frameOpen;
+};
+} // namespace gl
@@ -2,7 +2,7 @@
 
 namespace gl
 {
-Queue::Queue(VkQueue handle) : handle(handle), submitInfo({}), presentInfo({})
+Queue::Queue(VkQueue handle) : handle(handle), familyIndex(0), submitInfo({}), presentInfo({})
 {
     submitInfo.sType  = VK_STRUCTURE_TYPE_SUBMIT_INFO;
     presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -8,6 +8,7 @@ class Queue
 {
 public:
     VkQueue handle;
+    uint32_t familyIndex;
     VkSubmitInfo submitInfo;
     VkPresentInfoKHR presentInfo;
     std::vector<VkPipelineStageFlags> waitStages;
@@ -25,6 +25,33 @@ bool Semaphore::Create(const Device &device, uint32_t count)
     return true;
 }
 
+bool Semaphore::CreateTimeline(const Device &device, uint32_t count, uint64_t initialValue)
+{
+    handles.resize(count);
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        VkSemaphoreTypeCreateInfo typeInfo{};
+        typeInfo.sType         = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+        typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+        typeInfo.initialValue  = initialValue;
+
+        VkSemaphoreCreateInfo createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        createInfo.pNext = &typeInfo;
+
+        if (vkCreateSemaphore(device.handle, &createInfo, nullptr, &handles[i]) != VK_SUCCESS)
+        {
+            fmtx::Error("Failed to create timeline semaphore");
+            return false;
+        }
+    }
+
+    fmtx::Info("Created timeline semaphores");
+
+    return true;
+}
+
 void Semaphore::Destroy(const Device &device)
 {
     for (auto &handle : handles)
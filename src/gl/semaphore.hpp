@@ -12,6 +12,8 @@ public:
 
     Semaphore();
     bool Create(const Device &device, uint32_t count);
+    // counting semaphores, signaled and waited on with increasing 64 bit values
+    bool CreateTimeline(const Device &device, uint32_t count, uint64_t initialValue = 0);
     void Destroy(const Device &device);
 };
 } // namespace gl
\ No newline at end of file
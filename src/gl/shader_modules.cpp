@@ -1,12 +1,12 @@
 #include "shader_modules.hpp"
 
-VkShaderModule gl::CreateShaderModule(const gl::Device &device, const std::vector<char> &code)
+VkShaderModule gl::CreateShaderModule(const gl::Device &device, io::ByteView code)
 {
     VkShaderModule handle;
     VkShaderModuleCreateInfo createInfo{};
     createInfo.sType    = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    createInfo.codeSize = code.size();
-    createInfo.pCode    = reinterpret_cast<const uint32_t *>(code.data());
+    createInfo.codeSize = code.Size();
+    createInfo.pCode    = code.As<uint32_t>();
 
     if (vkCreateShaderModule(device.handle, &createInfo, nullptr, &handle) != VK_SUCCESS)
         return VK_NULL_HANDLE;
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "../io/binary.hpp"
 #include "core.hpp"
 #include "device.hpp"
 
@@ -11,6 +12,7 @@ struct ShaderModules
     VkShaderModule frag;
 };
 
-VkShaderModule CreateShaderModule(const gl::Device &device, const std::vector<char> &code);
+// code has to be 4 byte aligned, which file mappings and vectors are
+VkShaderModule CreateShaderModule(const gl::Device &device, io::ByteView code);
 void DestroyShaderModule(const gl::Device &device, const VkShaderModule &handle);
 } // namespace gl
\ No newline at end of file
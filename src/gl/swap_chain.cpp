@@ -3,6 +3,7 @@
 #include "image.hpp"
 #include "vulkan.hpp"
 #include <algorithm>
+#include <cctype>
 
 namespace gl
 {
@@ -46,7 +47,23 @@ VkExtent2D SelectSwapExtent(const VkSurfaceCapabilitiesKHR &capabilities, SDL_Wi
     }
 }
 
-SwapChain::SwapChain() {}
+static VkPresentModeKHR SelectPresentMode(const std::vector<VkPresentModeKHR> &available, VkPresentModeKHR preferred)
+{
+    if (std::find(available.begin(), available.end(), preferred) != available.end()) return preferred;
+
+    // guaranteed to be available
+    fmtx::Warn(fmt::format("{} not supported by the surface, falling back to FIFO", PresentModeName(preferred)));
+    return VK_PRESENT_MODE_FIFO_KHR;
+}
+
+SwapChain::SwapChain() :
+    handle(VK_NULL_HANDLE),
+    imageFormat(VK_FORMAT_UNDEFINED),
+    extent({0, 0}),
+    presentMode(VK_PRESENT_MODE_FIFO_KHR),
+    preferredPresentMode(VK_PRESENT_MODE_FIFO_KHR)
+{
+}
 
 bool SwapChain::Create(const Device &device, const Surface &surface, const PhysicalDevice &physicalDevice)
 {
@@ -55,10 +72,9 @@ bool SwapChain::Create(const Device &device, const Surface &surface, const Physi
     gl::SwapChainSupportDetails swapChainSupport = physicalDevice.swapChainSupport;
     // at this point we know that this format is available
     VkSurfaceFormatKHR surfaceFormat = {VK_FORMAT_B8G8R8A8_SRGB, VK_COLOR_SPACE_SRGB_NONLINEAR_KHR};
-    // guaranteed to be available
-    VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR;
-    extent                       = SelectSwapExtent(swapChainSupport.capabilities, surface.window);
-    uint32_t imageCount          = swapChainSupport.capabilities.minImageCount + 1;
+    presentMode         = SelectPresentMode(swapChainSupport.presentModes, preferredPresentMode);
+    extent              = SelectSwapExtent(swapChainSupport.capabilities, surface.window);
+    uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
     if (swapChainSupport.capabilities.maxImageCount > 0 && imageCount > swapChainSupport.capabilities.maxImageCount)
         imageCount = swapChainSupport.capabilities.maxImageCount;
 
@@ -103,7 +119,7 @@ bool SwapChain::Create(const Device &device, const Surface &surface, const Physi
     }
     imageFormat = surfaceFormat.format;
 
-    fmtx::Info("Swap chain created");
+    fmtx::Info(fmt::format("Swap chain created, {}", PresentModeName(presentMode)));
 
     std::vector<VkImage> imageHandles;
 
@@ -127,6 +143,7 @@ bool SwapChain::Create(const Device &device, const Surface &surface, const Physi
 void SwapChain::Destroy(const Device &device)
 {
     if (handle != VK_NULL_HANDLE) vkDestroySwapchainKHR(device.handle, handle, nullptr);
+    handle = VK_NULL_HANDLE;
 }
 
 VkResult
@@ -145,4 +162,35 @@ VkResult SwapChain::AcquireNextImageWithTimeout(
     uint64_t timeout = 16'666'666ull;
     return vkAcquireNextImageKHR(device.handle, handle, timeout, semaphore, fence, imageIndex);
 }
+
+const char *PresentModeName(VkPresentModeKHR mode)
+{
+    switch (mode)
+    {
+    case VK_PRESENT_MODE_IMMEDIATE_KHR:
+        return "Immediate";
+    case VK_PRESENT_MODE_MAILBOX_KHR:
+        return "Mailbox";
+    case VK_PRESENT_MODE_FIFO_KHR:
+        return "FIFO";
+    case VK_PRESENT_MODE_FIFO_RELAXED_KHR:
+        return "FIFO relaxed";
+    default:
+        return "Unknown";
+    }
+}
+
+std::optional<VkPresentModeKHR> ParsePresentMode(const std::string &name)
+{
+    std::string lower(name);
+    std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return std::tolower(c); });
+    std::replace(lower.begin(), lower.end(), ' ', '-');
+
+    if (lower == "immediate") return VK_PRESENT_MODE_IMMEDIATE_KHR;
+    if (lower == "mailbox") return VK_PRESENT_MODE_MAILBOX_KHR;
+    if (lower == "fifo" || lower == "vsync") return VK_PRESENT_MODE_FIFO_KHR;
+    if (lower == "fifo-relaxed") return VK_PRESENT_MODE_FIFO_RELAXED_KHR;
+
+    return std::nullopt;
+}
 } // namespace gl
@@ -16,9 +16,14 @@ public:
     std::vector<Image> images;
     VkFormat imageFormat;
     VkExtent2D extent;
+    // mode the swap chain was created with, may differ from the preferred one when the surface lacks it
+    VkPresentModeKHR presentMode;
 
     SwapChain();
 
+    // FIFO (vsync, default), MAILBOX (lowest latency without tearing) or IMMEDIATE (tears), applied on Create
+    void PreferPresentMode(VkPresentModeKHR mode) { preferredPresentMode = mode; }
+    VkPresentModeKHR PreferredPresentMode() const { return preferredPresentMode; }
     bool Create(const Device &device, const Surface &surface, const PhysicalDevice &physicalDevice);
     void Destroy(const Device &device);
     VkResult AcquireNextImage(
@@ -33,5 +38,12 @@ public:
         VkSemaphore semaphore,
         VkFence fence = VK_NULL_HANDLE
     ) const;
+
+private:
+    VkPresentModeKHR preferredPresentMode;
 };
+
+const char *PresentModeName(VkPresentModeKHR mode);
+// accepts the names of PresentModeName and the short forms fifo, fifo-relaxed, mailbox and immediate
+std::optional<VkPresentModeKHR> ParsePresentMode(const std::string &name);
 } // namespace gl
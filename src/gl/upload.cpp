@@ -0,0 +1,537 @@
+#include "upload.hpp"
+#include "vulkan.hpp"
+#include <algorithm>
+
+namespace gl
+{
+// everything that may read an uploaded buffer: vertex and index fetch, uniform and storage reads
+static constexpr VkAccessFlags BufferReadAccess = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT |
+                                                  VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+static constexpr VkPipelineStageFlags BufferReadStages = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT |
+                                                         VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+                                                         VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+
+// release and acquire halves use the same barrier, only access masks and stages differ
+static VkBufferMemoryBarrier BufferOwnershipBarrier(
+    const Device &device,
+    VkBuffer buffer,
+    VkDeviceSize offset,
+    VkDeviceSize size
+)
+{
+    VkBufferMemoryBarrier barrier{};
+    barrier.sType               = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.srcQueueFamilyIndex = device.transferQueue.familyIndex;
+    barrier.dstQueueFamilyIndex = device.graphicsQueue.familyIndex;
+    barrier.buffer              = buffer;
+    barrier.offset              = offset;
+    barrier.size                = size;
+
+    return barrier;
+}
+
+static VkImageMemoryBarrier ImageOwnershipBarrier(const Device &device, const Image &image, VkImageLayout newLayout)
+{
+    VkImageMemoryBarrier barrier{};
+    barrier.sType                           = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.oldLayout                       = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout                       = newLayout;
+    barrier.srcQueueFamilyIndex             = device.transferQueue.familyIndex;
+    barrier.dstQueueFamilyIndex             = device.graphicsQueue.familyIndex;
+    barrier.image                           = image.handle;
+    barrier.subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel   = 0;
+    barrier.subresourceRange.levelCount     = image.createInfo.mipLevels;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount     = 1;
+
+    return barrier;
+}
+
+StagingRing::StagingRing() : device(nullptr), allocator(nullptr), dedicated(false), head(0), tail(0), lastTicket(0) {}
+
+bool StagingRing::Create(const Device &device, const Allocator &allocator, VkDeviceSize size)
+{
+    this->device    = &device;
+    this->allocator = &allocator;
+    dedicated       = device.HasDedicatedTransferQueue();
+
+    // wrapping keeps offsets aligned only when the capacity is a multiple of the alignment
+    size = (size + UploadBatch::CopyAlignment - 1) / UploadBatch::CopyAlignment * UploadBatch::CopyAlignment;
+
+    buffer.Usage(VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+    buffer.HostMapped();
+    buffer.label = label.empty() ? "StagingRing" : label;
+    if (!buffer.Create(allocator, size)) return false;
+
+    if (!commandPool.Create(device, device.transferQueue.familyIndex)) return false;
+    if (!transferTimeline.CreateTimeline(device, 1)) return false;
+    if (dedicated)
+    {
+        if (!acquirePool.Create(device, device.graphicsQueue.familyIndex)) return false;
+        if (!acquireTimeline.CreateTimeline(device, 1)) return false;
+    }
+
+    fmtx::Info(fmt::format(
+        "Staging ring created, {} KB on the {} queue", size / 1024, dedicated ? "dedicated transfer" : "graphics"
+    ));
+
+    return true;
+}
+
+void StagingRing::Destroy()
+{
+    if (device == nullptr) return;
+
+    while (!inFlight.empty() && retireOldest(true));
+    for (const auto &submission : acquiring) reached(acquireTimeline.handles[0], submission.ticket, true);
+    inFlight.clear();
+    acquiring.clear();
+    freeCommandBuffers.clear();
+    freeAcquireCommandBuffers.clear();
+
+    if (commandPool.handle != VK_NULL_HANDLE) commandPool.Destroy(*device);
+    if (acquirePool.handle != VK_NULL_HANDLE) acquirePool.Destroy(*device);
+    commandPool.handle = VK_NULL_HANDLE;
+    acquirePool.handle = VK_NULL_HANDLE;
+    transferTimeline.Destroy(*device);
+    acquireTimeline.Destroy(*device);
+    buffer.Destroy(*allocator);
+
+    head   = 0;
+    tail   = 0;
+    device = nullptr;
+}
+
+void StagingRing::Update()
+{
+    while (!inFlight.empty() && retireOldest(false));
+
+    while (!acquiring.empty() && reached(acquireTimeline.handles[0], acquiring.front().ticket, false))
+    {
+        vkResetCommandBuffer(acquiring.front().commandBuffer, 0);
+        freeAcquireCommandBuffers.push_back(acquiring.front().commandBuffer);
+        acquiring.pop_front();
+    }
+}
+
+bool StagingRing::Acquire(Ticket ticket)
+{
+    // on a single queue submission order already puts graphics work behind the copies
+    if (!dedicated) return true;
+
+    for (auto &submission : inFlight)
+    {
+        if (submission.ticket > ticket) break;
+        if (!submission.acquired && !submitAcquire(submission)) return false;
+    }
+
+    return true;
+}
+
+bool StagingRing::IsComplete(Ticket ticket)
+{
+    Update();
+
+    return reached(dedicated ? acquireTimeline.handles[0] : transferTimeline.handles[0], ticket, false);
+}
+
+bool StagingRing::Wait(Ticket ticket)
+{
+    if (ticket > lastTicket)
+    {
+        fmtx::Error(fmt::format("Upload ticket {} was never submitted", ticket));
+        return false;
+    }
+
+    while (!inFlight.empty() && inFlight.front().ticket <= ticket)
+        if (!retireOldest(true)) return false;
+
+    return reached(dedicated ? acquireTimeline.handles[0] : transferTimeline.handles[0], ticket, true);
+}
+
+bool StagingRing::allocate(UploadBatch &batch, VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize &offset)
+{
+    const uint64_t capacity = buffer.Size();
+    if (size > capacity)
+    {
+        fmtx::Error(fmt::format("Upload of {} bytes does not fit staging ring of {} bytes", size, capacity));
+        return false;
+    }
+
+    for (;;)
+    {
+        if (head == tail) head = tail = 0;
+
+        uint64_t start = (head + alignment - 1) / alignment * alignment;
+        // allocations never wrap around the end of the buffer
+        if (start % capacity + size > capacity) start = (start / capacity + 1) * capacity;
+        if (start + size - tail <= capacity)
+        {
+            head   = start + size;
+            offset = start % capacity;
+            return true;
+        }
+
+        // space is reclaimed oldest submission first, the batch itself goes out when nothing else is left
+        if (!inFlight.empty())
+        {
+            if (!retireOldest(true)) return false;
+        }
+        else if (!batch.IsEmpty())
+        {
+            if (batch.flush() == 0) return false;
+        }
+        else
+        {
+            fmtx::Error("Staging ring is held by another upload batch");
+            return false;
+        }
+    }
+}
+
+bool StagingRing::retireOldest(bool wait)
+{
+    auto &submission = inFlight.front();
+    if (!reached(transferTimeline.handles[0], submission.ticket, wait)) return false;
+
+    // transfer is done so the acquire never stalls the graphics queue
+    if (dedicated && !submission.acquired && !submitAcquire(submission)) return false;
+
+    vkResetCommandBuffer(submission.commandBuffer, 0);
+    freeCommandBuffers.push_back(submission.commandBuffer);
+    tail = submission.end;
+    inFlight.pop_front();
+
+    return true;
+}
+
+bool StagingRing::submitAcquire(Submission &submission)
+{
+    // a submission without resources still signals so acquire timeline values stay contiguous
+    VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+    if (!submission.ownership.empty())
+    {
+        commandBuffer = acquireCommandBuffer(*device, acquirePool, freeAcquireCommandBuffers);
+        if (commandBuffer == VK_NULL_HANDLE) return false;
+
+        for (const auto &resource : submission.ownership)
+        {
+            if (resource.image == nullptr)
+            {
+                auto barrier = BufferOwnershipBarrier(*device, resource.buffer, resource.offset, resource.size);
+                barrier.srcAccessMask = 0;
+                barrier.dstAccessMask = BufferReadAccess;
+                vkCmdPipelineBarrier(
+                    commandBuffer,
+                    VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                    BufferReadStages,
+                    0,
+                    0,
+                    nullptr,
+                    1,
+                    &barrier,
+                    0,
+                    nullptr
+                );
+                continue;
+            }
+
+            auto layout = resource.mipmaps ? VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
+                                           : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            auto barrier = ImageOwnershipBarrier(*device, *resource.image, layout);
+            barrier.srcAccessMask = 0;
+            barrier.dstAccessMask = resource.mipmaps ? VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT
+                                                     : VK_ACCESS_SHADER_READ_BIT;
+            vkCmdPipelineBarrier(
+                commandBuffer,
+                VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                resource.mipmaps ? VK_PIPELINE_STAGE_TRANSFER_BIT : VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                0,
+                0,
+                nullptr,
+                0,
+                nullptr,
+                1,
+                &barrier
+            );
+            if (resource.mipmaps) resource.image->CmdGenerateMipmaps(commandBuffer, resource.mipFilter);
+        }
+
+        if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+        {
+            fmtx::Error("Failed to record upload acquire");
+            return false;
+        }
+    }
+
+    VkTimelineSemaphoreSubmitInfo timelineInfo{};
+    timelineInfo.sType                     = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.waitSemaphoreValueCount   = 1;
+    timelineInfo.pWaitSemaphoreValues      = &submission.ticket;
+    timelineInfo.signalSemaphoreValueCount = 1;
+    timelineInfo.pSignalSemaphoreValues    = &submission.ticket;
+
+    VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.pNext                = &timelineInfo;
+    submitInfo.waitSemaphoreCount   = 1;
+    submitInfo.pWaitSemaphores      = &transferTimeline.handles[0];
+    submitInfo.pWaitDstStageMask    = &waitStage;
+    submitInfo.commandBufferCount   = commandBuffer != VK_NULL_HANDLE ? 1 : 0;
+    submitInfo.pCommandBuffers      = &commandBuffer;
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores    = &acquireTimeline.handles[0];
+
+    if (vkQueueSubmit(device->graphicsQueue.handle, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+    {
+        fmtx::Error("Failed to submit upload acquire");
+        return false;
+    }
+
+    submission.acquired = true;
+    if (commandBuffer != VK_NULL_HANDLE) acquiring.push_back({submission.ticket, commandBuffer});
+
+    return true;
+}
+
+bool StagingRing::reached(VkSemaphore timeline, Ticket ticket, bool wait) const
+{
+    if (wait)
+    {
+        VkSemaphoreWaitInfo waitInfo{};
+        waitInfo.sType          = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+        waitInfo.semaphoreCount = 1;
+        waitInfo.pSemaphores    = &timeline;
+        waitInfo.pValues        = &ticket;
+        if (vkWaitSemaphores(device->handle, &waitInfo, UINT64_MAX) != VK_SUCCESS)
+        {
+            fmtx::Error("Failed to wait for upload timeline");
+            return false;
+        }
+        return true;
+    }
+
+    uint64_t value = 0;
+    return vkGetSemaphoreCounterValue(device->handle, timeline, &value) == VK_SUCCESS && value >= ticket;
+}
+
+VkCommandBuffer StagingRing::acquireCommandBuffer(
+    const Device &device,
+    const CommandPool &pool,
+    std::vector<VkCommandBuffer> &freeList
+)
+{
+    VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+    if (!freeList.empty())
+    {
+        commandBuffer = freeList.back();
+        freeList.pop_back();
+    }
+    else
+    {
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandPool        = pool.handle;
+        allocInfo.commandBufferCount = 1;
+
+        if (vkAllocateCommandBuffers(device.handle, &allocInfo, &commandBuffer) != VK_SUCCESS)
+        {
+            fmtx::Error("Failed to allocate upload command buffer");
+            return VK_NULL_HANDLE;
+        }
+    }
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+    {
+        fmtx::Error("Failed to begin upload command buffer");
+        freeList.push_back(commandBuffer);
+        return VK_NULL_HANDLE;
+    }
+
+    return commandBuffer;
+}
+
+StagingRing::Ticket StagingRing::submit(VkCommandBuffer commandBuffer, std::vector<Ownership> &ownership)
+{
+    Ticket ticket = lastTicket + 1;
+
+    VkTimelineSemaphoreSubmitInfo timelineInfo{};
+    timelineInfo.sType                     = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.signalSemaphoreValueCount = 1;
+    timelineInfo.pSignalSemaphoreValues    = &ticket;
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.pNext                = &timelineInfo;
+    submitInfo.commandBufferCount   = 1;
+    submitInfo.pCommandBuffers      = &commandBuffer;
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores    = &transferTimeline.handles[0];
+
+    if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS ||
+        vkQueueSubmit(device->transferQueue.handle, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+    {
+        fmtx::Error("Failed to submit uploads");
+        vkResetCommandBuffer(commandBuffer, 0);
+        freeCommandBuffers.push_back(commandBuffer);
+        ownership.clear();
+        return 0;
+    }
+
+    lastTicket = ticket;
+    inFlight.push_back({ticket, commandBuffer, head, std::move(ownership), false});
+    ownership.clear();
+
+    return ticket;
+}
+
+UploadBatch::UploadBatch(StagingRing &ring) :
+    ring(ring),
+    commandBuffer(VK_NULL_HANDLE),
+    ticket(0),
+    bufferWrites(false)
+{
+}
+
+UploadBatch::~UploadBatch()
+{
+    if (!IsEmpty()) Submit();
+}
+
+bool UploadBatch::CopyToBuffer(Buffer &dst, const void *data, VkDeviceSize size, VkDeviceSize dstOffset)
+{
+    // larger than the ring goes through in pieces, each piece waits for the previous ones to free space
+    auto bytes = static_cast<const char *>(data);
+    for (VkDeviceSize copied = 0; copied < size;)
+    {
+        VkDeviceSize chunk = std::min(size - copied, ring.Capacity());
+        VkDeviceSize offset;
+        if (!ring.allocate(*this, chunk, CopyAlignment, offset)) return false;
+        if (!ring.buffer.Write(*ring.allocator, bytes + copied, chunk, offset)) return false;
+        if (!begin()) return false;
+
+        VkBufferCopy region{};
+        region.srcOffset = offset;
+        region.dstOffset = dstOffset + copied;
+        region.size      = chunk;
+        vkCmdCopyBuffer(commandBuffer, ring.buffer.handle, dst.handle, 1, &region);
+
+        // every piece is released on its own, a later piece may already be in another submission
+        if (ring.dedicated)
+        {
+            auto barrier          = BufferOwnershipBarrier(*ring.device, dst.handle, region.dstOffset, chunk);
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = 0;
+            vkCmdPipelineBarrier(
+                commandBuffer,
+                VK_PIPELINE_STAGE_TRANSFER_BIT,
+                VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                0,
+                0,
+                nullptr,
+                1,
+                &barrier,
+                0,
+                nullptr
+            );
+            ownership.push_back({dst.handle, region.dstOffset, chunk, nullptr, false, VK_FILTER_NEAREST});
+        }
+        else
+            bufferWrites = true;
+
+        copied += chunk;
+    }
+
+    return true;
+}
+
+bool UploadBatch::CopyToImage(Image &dst, const void *data, VkDeviceSize size, VkExtent2D extent, VkFilter mipFilter)
+{
+    VkDeviceSize offset;
+    if (!ring.allocate(*this, size, CopyAlignment, offset)) return false;
+    if (!ring.buffer.Write(*ring.allocator, data, size, offset)) return false;
+    if (!begin()) return false;
+
+    if (!dst.CmdTransitionLayout(commandBuffer, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL))
+        return false;
+    dst.CmdCopyFromBuffer(commandBuffer, ring.buffer.handle, offset, extent);
+
+    bool mipmaps = dst.createInfo.mipLevels > 1;
+    if (ring.dedicated)
+    {
+        // transfer queues cannot blit, the graphics side generates the mip chain after acquiring every level
+        auto layout  = mipmaps ? VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        auto barrier = ImageOwnershipBarrier(*ring.device, dst, layout);
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = 0;
+        vkCmdPipelineBarrier(
+            commandBuffer,
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+            0,
+            0,
+            nullptr,
+            0,
+            nullptr,
+            1,
+            &barrier
+        );
+        ownership.push_back({VK_NULL_HANDLE, 0, 0, &dst, mipmaps, mipFilter});
+
+        return true;
+    }
+
+    if (!mipmaps)
+        return dst.CmdTransitionLayout(
+            commandBuffer, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+        );
+
+    dst.CmdGenerateMipmaps(commandBuffer, mipFilter);
+
+    return true;
+}
+
+StagingRing::Ticket UploadBatch::Submit()
+{
+    if (IsEmpty()) return ticket;
+
+    return flush();
+}
+
+bool UploadBatch::begin()
+{
+    if (commandBuffer == VK_NULL_HANDLE)
+        commandBuffer = StagingRing::acquireCommandBuffer(*ring.device, ring.commandPool, ring.freeCommandBuffers);
+
+    return commandBuffer != VK_NULL_HANDLE;
+}
+
+StagingRing::Ticket UploadBatch::flush()
+{
+    // with a dedicated queue the acquire barriers make buffers visible, here one barrier covers every copy
+    if (bufferWrites)
+    {
+        VkMemoryBarrier barrier{};
+        barrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = BufferReadAccess;
+
+        vkCmdPipelineBarrier(
+            commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, BufferReadStages, 0, 1, &barrier, 0, nullptr, 0, nullptr
+        );
+    }
+
+    auto submitted = ring.submit(commandBuffer, ownership);
+    commandBuffer  = VK_NULL_HANDLE;
+    bufferWrites   = false;
+    if (submitted != 0) ticket = submitted;
+
+    return submitted;
+}
+} // namespace gl
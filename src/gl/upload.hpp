@@ -0,0 +1,144 @@
+#pragma once
+
+#include "buffer.hpp"
+#include "command_pool.hpp"
+#include "core.hpp"
+#include "device.hpp"
+#include "image.hpp"
+#include "semaphore.hpp"
+#include "vma.hpp"
+#include <deque>
+
+namespace gl
+{
+class UploadBatch;
+
+// Persistently mapped staging memory shared by every upload.
+// Copies run on the device transfer queue and every submission signals a timeline semaphore with its ticket.
+// Staging space is handed out in submission order and reclaimed once that value is reached.
+// With a dedicated transfer queue the copied resources are released to the graphics family and acquired there
+// by a second submission waiting on the transfer timeline. Mipmaps are generated on the graphics side
+// because transfer queues cannot blit. Without one everything is recorded into the single graphics submission.
+// Single threaded, only one UploadBatch may record into a ring at a time.
+class StagingRing
+{
+public:
+    // submissions are numbered in order, a ticket is complete once its resources are usable by graphics work
+    using Ticket = uint64_t;
+
+    std::string label;
+
+    StagingRing();
+    bool Create(const Device &device, const Allocator &allocator, VkDeviceSize size);
+    void Destroy();
+    // non blocking, hands finished transfers over to the graphics queue and recycles what the GPU is done with
+    void Update();
+    // graphics submissions made after this see the resources of ticket, the GPU waits for the transfer, not the CPU
+    bool Acquire(Ticket ticket);
+    bool IsComplete(Ticket ticket);
+    bool Wait(Ticket ticket);
+    bool IsDedicated() const { return dedicated; }
+    VkDeviceSize Capacity() const { return buffer.Size(); }
+    // bytes owned by recorded or in flight uploads
+    VkDeviceSize Used() const { return head - tail; }
+
+private:
+    friend class UploadBatch;
+
+    // resource whose ownership moves from the transfer to the graphics queue family
+    struct Ownership
+    {
+        VkBuffer buffer;
+        VkDeviceSize offset;
+        VkDeviceSize size;
+        const Image *image;
+        bool mipmaps;
+        VkFilter mipFilter;
+    };
+
+    struct Submission
+    {
+        Ticket ticket;
+        VkCommandBuffer commandBuffer;
+        uint64_t end; // ring position just past the last byte read by this submission
+        std::vector<Ownership> ownership;
+        bool acquired;
+    };
+
+    struct AcquireSubmission
+    {
+        Ticket ticket;
+        VkCommandBuffer commandBuffer;
+    };
+
+    // ring positions only grow, the buffer offset is position % capacity
+    bool allocate(UploadBatch &batch, VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize &offset);
+    bool retireOldest(bool wait);
+    bool submitAcquire(Submission &submission);
+    bool reached(VkSemaphore timeline, Ticket ticket, bool wait) const;
+    static VkCommandBuffer acquireCommandBuffer(
+        const Device &device,
+        const CommandPool &pool,
+        std::vector<VkCommandBuffer> &freeList
+    );
+    Ticket submit(VkCommandBuffer commandBuffer, std::vector<Ownership> &ownership);
+
+private:
+    const Device *device;
+    const Allocator *allocator;
+    bool dedicated;
+    Buffer buffer;
+    CommandPool commandPool;
+    CommandPool acquirePool;
+    Semaphore transferTimeline;
+    Semaphore acquireTimeline;
+    std::deque<Submission> inFlight;
+    std::deque<AcquireSubmission> acquiring;
+    std::vector<VkCommandBuffer> freeCommandBuffers;
+    std::vector<VkCommandBuffer> freeAcquireCommandBuffers;
+    uint64_t head;
+    uint64_t tail;
+    Ticket lastTicket;
+};
+
+// Records many buffer and image uploads into one command buffer submitted once.
+// Source data is copied into the staging ring immediately and can be released as soon as a call returns.
+// When the ring runs out of space the recorded part is submitted early and recording continues in a new command buffer.
+// Anything still recorded is submitted when the batch goes out of scope.
+// Destination resources must use exclusive sharing and stay alive until their ticket completes.
+class UploadBatch
+{
+public:
+    explicit UploadBatch(StagingRing &ring);
+    ~UploadBatch();
+
+    bool CopyToBuffer(Buffer &dst, const void *data, VkDeviceSize size, VkDeviceSize dstOffset = 0);
+    // fills the first mip level and generates the rest, the image ends up in SHADER_READ_ONLY_OPTIMAL
+    bool CopyToImage(
+        Image &dst,
+        const void *data,
+        VkDeviceSize size,
+        VkExtent2D extent,
+        VkFilter mipFilter = VK_FILTER_LINEAR
+    );
+    // ticket of the last submission made by this batch, 0 when nothing was ever recorded
+    StagingRing::Ticket Submit();
+    bool IsEmpty() const { return commandBuffer == VK_NULL_HANDLE; }
+
+private:
+    friend class StagingRing;
+
+    // buffer offsets of image copies must be a multiple of the texel size and of 4
+    static constexpr VkDeviceSize CopyAlignment = 16;
+
+    bool begin();
+    StagingRing::Ticket flush();
+
+private:
+    StagingRing &ring;
+    VkCommandBuffer commandBuffer;
+    StagingRing::Ticket ticket;
+    bool bufferWrites;
+    std::vector<StagingRing::Ownership> ownership;
+};
+} // namespace gl
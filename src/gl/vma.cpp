@@ -14,7 +14,7 @@ bool Allocator::Create(VkInstance instance, VkPhysicalDevice physicalDevice, VkD
     vulkanFunctions.vkGetDeviceProcAddr   = &vkGetDeviceProcAddr;
 
     VmaAllocatorCreateInfo allocatorCreateInfo = {};
-    allocatorCreateInfo.flags                  = VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT;
+    allocatorCreateInfo.flags                  = memoryBudget ? VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT : 0;
     allocatorCreateInfo.vulkanApiVersion       = VK_API_VERSION_1_3;
     allocatorCreateInfo.physicalDevice         = physicalDevice;
     allocatorCreateInfo.device                 = device;
@@ -27,6 +27,7 @@ bool Allocator::Create(VkInstance instance, VkPhysicalDevice physicalDevice, VkD
         fmtx::Error("Fail to create Allocator");
         return false;
     }
+    this->device = device;
     fmtx::Info("Vulkan allocator created");
 
     return true;
@@ -35,6 +36,49 @@ bool Allocator::Create(VkInstance instance, VkPhysicalDevice physicalDevice, VkD
 void Allocator::Destroy()
 {
     if (handle != VK_NULL_HANDLE) vmaDestroyAllocator(handle);
+    handle = VK_NULL_HANDLE;
+}
+
+std::vector<Allocator::Budget> Allocator::HeapBudgets() const
+{
+    const VkPhysicalDeviceMemoryProperties *properties;
+    vmaGetMemoryProperties(handle, &properties);
+
+    VmaBudget budgets[VK_MAX_MEMORY_HEAPS];
+    vmaGetHeapBudgets(handle, budgets);
+
+    std::vector<Budget> result(properties->memoryHeapCount);
+    for (uint32_t i = 0; i < properties->memoryHeapCount; ++i)
+    {
+        result[i].usage           = budgets[i].usage;
+        result[i].budget          = budgets[i].budget;
+        result[i].allocationBytes = budgets[i].statistics.allocationBytes;
+        result[i].allocationCount = budgets[i].statistics.allocationCount;
+        result[i].blockCount      = budgets[i].statistics.blockCount;
+    }
+
+    return result;
+}
+
+Allocator::Budget Allocator::DeviceLocalBudget() const
+{
+    const VkPhysicalDeviceMemoryProperties *properties;
+    vmaGetMemoryProperties(handle, &properties);
+
+    Budget total;
+    auto heaps = HeapBudgets();
+    for (uint32_t i = 0; i < heaps.size(); ++i)
+    {
+        if (!(properties->memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)) continue;
+
+        total.usage += heaps[i].usage;
+        total.budget += heaps[i].budget;
+        total.allocationBytes += heaps[i].allocationBytes;
+        total.allocationCount += heaps[i].allocationCount;
+        total.blockCount += heaps[i].blockCount;
+    }
+
+    return total;
 }
 
 } // namespace gl
@@ -3,6 +3,7 @@
 #define VMA_STATIC_VULKAN_FUNCTIONS 0
 #define VMA_DYNAMIC_VULKAN_FUNCTIONS 1
 #define VMA_VULKAN_VERSION 1003000
+#include <vector>
 #include <vk_mem_alloc.h>
 
 namespace gl
@@ -11,13 +12,32 @@ namespace gl
 class Allocator
 {
 public:
+    // bytes of one memory heap, budget is how much the process can use before the driver starts evicting
+    struct Budget
+    {
+        VkDeviceSize usage           = 0;
+        VkDeviceSize budget          = 0;
+        VkDeviceSize allocationBytes = 0;
+        uint32_t allocationCount     = 0;
+        uint32_t blockCount          = 0;
+    };
+
     VmaAllocator handle;
+    VkDevice device;
 
 public:
-    Allocator() {};
+    Allocator() : handle(VK_NULL_HANDLE), device(VK_NULL_HANDLE), memoryBudget(false) {};
 
+    // requires VK_EXT_memory_budget enabled on the device, otherwise budgets are estimated from heap sizes
+    void EnableMemoryBudget() { memoryBudget = true; }
     bool Create(VkInstance instance, VkPhysicalDevice physicalDevice, VkDevice device);
     void Destroy();
+    std::vector<Budget> HeapBudgets() const;
+    // sum over device local heaps
+    Budget DeviceLocalBudget() const;
+
+private:
+    bool memoryBudget;
 };
 
 } // namespace gl
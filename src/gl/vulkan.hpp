@@ -5,6 +5,7 @@
 #include "buffer.hpp"
 #include "command_buffer.hpp"
 #include "command_pool.hpp"
+#include "command_recorder.hpp"
 #include "core.hpp"
 #include "descriptor_pool.hpp"
 #include "device.hpp"
@@ -13,9 +14,11 @@
 #include "image.hpp"
 #include "image_view.hpp"
 #include "instance.hpp"
-#include "memory.hpp"
 #include "physical_device.hpp"
 #include "pipeline.hpp"
+#include "pipeline_cache.hpp"
+#include "pipeline_compiler.hpp"
+#include "profiler.hpp"
 #include "queue.hpp"
 #include "render_pass.hpp"
 #include "sampler.hpp"
@@ -23,6 +26,7 @@
 #include "shader_modules.hpp"
 #include "surface.hpp"
 #include "swap_chain.hpp"
+#include "upload.hpp"
 #include "vma.hpp"
 #include <optional>
 #include <string>
@@ -1,4 +1,16 @@
 #include "binary.hpp"
+#include <cstdio>
+
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 namespace io
 {
@@ -21,4 +33,133 @@ BinaryFile::Ptr BinaryFile::Load(const std::string &filename)
 
     return ptr;
 }
+
+bool BinaryFile::Save(const std::string &filename, const void *data, size_t size)
+{
+    auto tempFilename = filename + ".tmp";
+    {
+        std::ofstream file(tempFilename, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) return false;
+
+        file.write(static_cast<const char *>(data), size);
+        if (!file.good()) return false;
+    }
+
+    if (std::rename(tempFilename.c_str(), filename.c_str()) == 0) return true;
+
+    // rename does not replace an existing file on Windows
+    std::remove(filename.c_str());
+    return std::rename(tempFilename.c_str(), filename.c_str()) == 0;
+}
+
+AsyncReader::AsyncReader() : thread(std::make_unique<Parallel::Pool>(1)) {}
+
+AsyncReader::~AsyncReader() { thread.reset(); }
+
+std::future<bool> AsyncReader::Read(const std::string &filename, ChunkFn onChunk, DoneFn onDone, size_t chunkSize)
+{
+    return thread->Submit(
+        [this, filename, onChunk = std::move(onChunk), onDone = std::move(onDone), chunkSize]()
+        { return read(filename, onChunk, onDone, chunkSize); }
+    );
+}
+
+std::future<BinaryFile::Ptr> AsyncReader::Load(const std::string &filename)
+{
+    return thread->Submit([filename]() { return BinaryFile::Load(filename); });
+}
+
+void AsyncReader::Wait() { thread->Wait(); }
+
+bool AsyncReader::read(const std::string &filename, const ChunkFn &onChunk, const DoneFn &onDone, size_t chunkSize)
+{
+    size_t bytesRead = 0;
+    auto finish      = [&](bool ok)
+    {
+        if (onDone) onDone(ok, bytesRead);
+        return ok;
+    };
+
+    std::ifstream file(filename, std::ios::ate | std::ios::binary);
+    if (!file.is_open()) return finish(false);
+
+    auto fileSize = size_t(file.tellg());
+    file.seekg(0);
+
+    buffer.resize(std::max<size_t>(1, std::min(chunkSize, fileSize)));
+    while (bytesRead < fileSize)
+    {
+        auto offset = bytesRead;
+        auto count  = std::min(buffer.size(), fileSize - offset);
+        if (!file.read(buffer.data(), count)) return finish(false);
+        bytesRead += count;
+        if (!onChunk(ByteView(buffer.data(), count), offset, fileSize)) return finish(false);
+    }
+
+    return finish(true);
+}
+
+#ifdef _WIN32
+MappedFile::MappedFile() : data(nullptr), size(0), file(INVALID_HANDLE_VALUE), mapping(nullptr) {}
+
+MappedFile::~MappedFile()
+{
+    if (data != nullptr) UnmapViewOfFile(data);
+    if (mapping != nullptr) CloseHandle(mapping);
+    if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+}
+
+MappedFile::Ptr MappedFile::Open(const std::string &filename)
+{
+    Ptr ptr(new MappedFile());
+
+    ptr->file = CreateFileA(
+        filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr
+    );
+    if (ptr->file == INVALID_HANDLE_VALUE) return ptr;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(ptr->file, &fileSize) || fileSize.QuadPart == 0) return ptr;
+
+    ptr->mapping = CreateFileMappingA(ptr->file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (ptr->mapping == nullptr) return ptr;
+
+    ptr->data = static_cast<const char *>(MapViewOfFile(ptr->mapping, FILE_MAP_READ, 0, 0, 0));
+    if (ptr->data != nullptr) ptr->size = size_t(fileSize.QuadPart);
+
+    return ptr;
+}
+#else
+MappedFile::MappedFile() : data(nullptr), size(0) {}
+
+MappedFile::~MappedFile()
+{
+    if (data != nullptr) munmap(const_cast<char *>(data), size);
+}
+
+MappedFile::Ptr MappedFile::Open(const std::string &filename)
+{
+    Ptr ptr(new MappedFile());
+
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) return ptr;
+
+    struct stat info;
+    if (fstat(fd, &info) == 0 && info.st_size > 0)
+    {
+        void *mapped = mmap(nullptr, size_t(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped != MAP_FAILED)
+        {
+            ptr->data = static_cast<const char *>(mapped);
+            ptr->size = size_t(info.st_size);
+            // callers read all of it, often from several threads at once, start reading ahead right away
+            madvise(mapped, ptr->size, MADV_WILLNEED);
+        }
+    }
+    // the mapping keeps the file referenced
+    close(fd);
+
+    return ptr;
+}
+#endif
 } // namespace io
@@ -1,24 +1,125 @@
 #pragma once
 
+#include "../core/parallel.hpp"
+#include <algorithm>
+#include <cstdint>
 #include <fstream>
+#include <functional>
+#include <future>
 #include <memory>
+#include <string>
 #include <vector>
 
 namespace io
 {
 
+// Non owning view of bytes, what std::span<const char> is in C++20. Valid as long as the owner of the bytes lives.
+class ByteView
+{
+public:
+    ByteView() : data(nullptr), size(0) {}
+    ByteView(const char *data, size_t size) : data(data), size(size) {}
+
+    bool IsEmpty() const { return size == 0; }
+    const char *Data() const { return data; }
+    size_t Size() const { return size; }
+    const char *begin() const { return data; }
+    const char *end() const { return data + size; }
+    // clamped to the view, count past the end stops at the end
+    ByteView Sub(size_t offset, size_t count = SIZE_MAX) const
+    {
+        offset = std::min(offset, size);
+        return ByteView(data + offset, std::min(count, size - offset));
+    }
+    template <typename T> const T *As() const { return reinterpret_cast<const T *>(data); }
+
+private:
+    const char *data;
+    size_t size;
+};
+
 class BinaryFile
 {
 public:
     using Ptr = std::shared_ptr<BinaryFile>;
     static Ptr Load(const std::string &filename);
+    // written next to the target and renamed over it, readers never see a half written file
+    static bool Save(const std::string &filename, const void *data, size_t size);
 
     bool IsEmpty() const { return data.empty(); }
 
     const std::vector<char> &Bytes() const { return data; }
+    ByteView View() const { return ByteView(data.data(), data.size()); }
 
 private:
     std::vector<char> data;
 };
 
+// Read only mapping of a whole file, pages are read on first touch and shared with the OS file cache.
+// Nothing is copied, the view stays valid as long as the MappedFile lives.
+class MappedFile
+{
+public:
+    using Ptr = std::shared_ptr<MappedFile>;
+    // empty when the file is missing, empty or cannot be mapped
+    static Ptr Open(const std::string &filename);
+
+    MappedFile(const MappedFile &)            = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    ~MappedFile();
+
+    bool IsEmpty() const { return size == 0; }
+    const char *Data() const { return data; }
+    size_t Size() const { return size; }
+    ByteView View() const { return ByteView(data, size); }
+    ByteView View(size_t offset, size_t count) const { return View().Sub(offset, count); }
+
+private:
+    MappedFile();
+
+private:
+    const char *data;
+    size_t size;
+#ifdef _WIN32
+    void *file;
+    void *mapping;
+#endif
+};
+
+// Reads files in chunks on a background I/O thread, one file after another in submission order.
+// Only one chunk is in memory at a time, consumers stream it into its destination (e.g. a staging buffer).
+// Callbacks run on the I/O thread and the chunk view is only valid during its callback.
+class AsyncReader
+{
+public:
+    // return false to stop reading, the read then completes as failed
+    using ChunkFn = std::function<bool(ByteView chunk, size_t offset, size_t fileSize)>;
+    using DoneFn  = std::function<void(bool ok, size_t bytesRead)>;
+
+    static constexpr size_t DefaultChunkSize = size_t(4) << 20;
+
+    AsyncReader();
+    // queued reads still complete
+    ~AsyncReader();
+
+    std::future<bool> Read(
+        const std::string &filename,
+        ChunkFn onChunk,
+        DoneFn onDone    = nullptr,
+        size_t chunkSize = DefaultChunkSize
+    );
+    // whole file into memory on the I/O thread, the file is empty when it could not be read
+    std::future<BinaryFile::Ptr> Load(const std::string &filename);
+    // blocks until every queued read has completed
+    void Wait();
+
+private:
+    bool read(const std::string &filename, const ChunkFn &onChunk, const DoneFn &onDone, size_t chunkSize);
+
+private:
+    // chunk buffer reused across reads, only touched by the I/O thread
+    std::vector<char> buffer;
+    std::unique_ptr<Parallel::Pool> thread;
+};
+
 } // namespace io
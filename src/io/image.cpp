@@ -1,19 +1,173 @@
 #include "image.hpp"
 #include "../deps/fmt.hpp"
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define IMAGE_X86 1
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#define IMAGE_NEON 1
+#include <arm_neon.h>
+#endif
+
+// SSSE3 kernel is compiled for SSSE3 regardless of global flags, it only runs after CPU detection
+#if defined(__GNUC__) || defined(__clang__)
+#define IMAGE_TARGET_SSSE3 __attribute__((target("ssse3")))
+#else
+#define IMAGE_TARGET_SSSE3
+#endif
 
 namespace io
 {
+namespace
+{
+using Swizzle = void (*)(const uint8 *, uint8 *, size_t);
+
+void rgbToRGBAScalar(const uint8 *src, uint8 *dst, size_t pixels)
+{
+    for (size_t i = 0; i < pixels; ++i, src += 3, dst += 4)
+    {
+        dst[0] = src[0];
+        dst[1] = src[1];
+        dst[2] = src[2];
+        dst[3] = 255;
+    }
+}
+
+#ifdef IMAGE_X86
+// 16 pixels per iteration, 3 loads cover 48 bytes of RGB and 4 shuffles spread them over 64 bytes of RGBA
+IMAGE_TARGET_SSSE3 void rgbToRGBASSSE3(const uint8 *src, uint8 *dst, size_t pixels)
+{
+    const __m128i spread = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    const __m128i alpha  = _mm_set1_epi32(int32(0xFF000000));
+
+    size_t i = 0;
+    for (; i + 16 <= pixels; i += 16, src += 48, dst += 64)
+    {
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src));
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 16));
+        const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 32));
+
+        // each source register starts at the next group of 4 pixels, 12 bytes further
+        const __m128i p0 = a;
+        const __m128i p1 = _mm_alignr_epi8(b, a, 12);
+        const __m128i p2 = _mm_alignr_epi8(c, b, 8);
+        const __m128i p3 = _mm_srli_si128(c, 4);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst), _mm_or_si128(_mm_shuffle_epi8(p0, spread), alpha));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 16), _mm_or_si128(_mm_shuffle_epi8(p1, spread), alpha));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 32), _mm_or_si128(_mm_shuffle_epi8(p2, spread), alpha));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 48), _mm_or_si128(_mm_shuffle_epi8(p3, spread), alpha));
+    }
+    rgbToRGBAScalar(src, dst, pixels - i);
+}
+#endif
+
+#ifdef IMAGE_NEON
+void rgbToRGBANEON(const uint8 *src, uint8 *dst, size_t pixels)
+{
+    size_t i = 0;
+    for (; i + 16 <= pixels; i += 16, src += 48, dst += 64)
+    {
+        const uint8x16x3_t rgb = vld3q_u8(src);
+        uint8x16x4_t rgba;
+        rgba.val[0] = rgb.val[0];
+        rgba.val[1] = rgb.val[1];
+        rgba.val[2] = rgb.val[2];
+        rgba.val[3] = vdupq_n_u8(255);
+        vst4q_u8(dst, rgba);
+    }
+    rgbToRGBAScalar(src, dst, pixels - i);
+}
+#endif
+
+Swizzle selectSwizzle()
+{
+#ifdef IMAGE_X86
+    if (CPU::HasSSSE3()) return rgbToRGBASSSE3;
+#endif
+#ifdef IMAGE_NEON
+    return rgbToRGBANEON;
+#endif
+    return rgbToRGBAScalar;
+}
+} // namespace
 
 Image::Image() : Width(0), Height(0), Channels(0), data(nullptr), surface(nullptr) {}
 
 Image::~Image() { Unload(); }
 
+std::future<Image::Ptr> Image::LoadAsync(const std::string &filename, AsyncReader &reader, Parallel::Pool &pool)
+{
+    auto result  = std::make_shared<std::promise<Ptr>>();
+    auto encoded = std::make_shared<std::vector<char>>();
+    auto future  = result->get_future();
+
+    reader.Read(
+        filename,
+        [encoded](ByteView chunk, size_t offset, size_t fileSize)
+        {
+            if (offset == 0) encoded->resize(fileSize);
+            std::memcpy(encoded->data() + offset, chunk.Data(), chunk.Size());
+            return true;
+        },
+        [filename, result, encoded, &pool](bool ok, size_t)
+        {
+            // decoding goes to the pool, the I/O thread moves on to the next file meanwhile
+            pool.Submit(
+                [filename, result, encoded, ok]()
+                {
+                    auto image = std::make_shared<Image>();
+                    if (!ok)
+                        fmtx::Error(fmt::format("Failed to read image {}", filename));
+                    else
+                        image->Load(ByteView(encoded->data(), encoded->size()), filename);
+                    result->set_value(image);
+                }
+            );
+        }
+    );
+
+    return future;
+}
+
+void Image::RGBToRGBA(const uint8 *src, uint8 *dst, size_t pixels)
+{
+    static const Swizzle swizzle = selectSwizzle();
+    swizzle(src, dst, pixels);
+}
+
+const char *Image::RGBToRGBABackend()
+{
+#ifdef IMAGE_X86
+    if (CPU::HasSSSE3()) return "SSSE3";
+#endif
+#ifdef IMAGE_NEON
+    return "NEON";
+#endif
+    return "scalar";
+}
+
 bool Image::Load(const std::string &filename)
 {
-    surface = IMG_Load(filename.c_str());
+    Unload();
+    return adopt(IMG_Load(filename.c_str()), filename);
+}
+
+bool Image::Load(ByteView encoded, const std::string &name)
+{
+    Unload();
+    auto stream = SDL_RWFromConstMem(encoded.Data(), int(encoded.Size()));
+    return adopt(stream != nullptr ? IMG_Load_RW(stream, 1) : nullptr, name);
+}
+
+bool Image::Create(int32 width, int32 height)
+{
+    Unload();
+    surface = SDL_CreateRGBSurfaceWithFormat(0, width, height, 32, SDL_PIXELFORMAT_RGBA32);
     if (surface == nullptr)
     {
-        fmtx::Error(fmt::format("Failed to load image {}", filename));
+        fmtx::Error(fmt::format("Failed to create {}x{} image", width, height));
         return false;
     }
     Width    = surface->w;
@@ -25,6 +179,71 @@ bool Image::Load(const std::string &filename)
     return true;
 }
 
+bool Image::SavePNG(const std::string &filename) const
+{
+    if (surface == nullptr || IMG_SavePNG(surface, filename.c_str()) != 0)
+    {
+        fmtx::Error(fmt::format("Failed to save image {}", filename));
+        return false;
+    }
+
+    return true;
+}
+
+bool Image::adopt(SDL_Surface *decoded, const std::string &name)
+{
+    if (decoded == nullptr)
+    {
+        fmtx::Error(fmt::format("Failed to load image {}", name));
+        return false;
+    }
+
+    if (decoded->format->format == SDL_PIXELFORMAT_RGBA32 && decoded->pitch == decoded->w * 4)
+    {
+        surface = decoded;
+    }
+    else if (decoded->format->format == SDL_PIXELFORMAT_RGB24)
+    {
+        // the common case for photos and textures saved without alpha
+        surface = SDL_CreateRGBSurfaceWithFormat(0, decoded->w, decoded->h, 32, SDL_PIXELFORMAT_RGBA32);
+        if (surface != nullptr)
+        {
+            auto src = static_cast<const uint8 *>(decoded->pixels);
+            auto dst = static_cast<uint8 *>(surface->pixels);
+            // decoded rows are padded to 4 bytes, packed ones go in a single pass
+            if (decoded->pitch == decoded->w * 3)
+            {
+                RGBToRGBA(src, dst, size_t(decoded->w) * size_t(decoded->h));
+            }
+            else
+            {
+                for (int32 y = 0; y < decoded->h; ++y)
+                    RGBToRGBA(src + size_t(y) * decoded->pitch, dst + size_t(y) * surface->pitch, decoded->w);
+            }
+        }
+        SDL_FreeSurface(decoded);
+    }
+    else
+    {
+        // palettes, grayscale, 16 bit and BGR orders are rare enough for SDL's generic blitter
+        surface = SDL_ConvertSurfaceFormat(decoded, SDL_PIXELFORMAT_RGBA32, 0);
+        SDL_FreeSurface(decoded);
+    }
+    if (surface == nullptr)
+    {
+        fmtx::Error(fmt::format("Failed to convert image {} to RGBA", name));
+        return false;
+    }
+
+    Width    = surface->w;
+    Height   = surface->h;
+    Channels = 4;
+
+    data = static_cast<uint8 *>(surface->pixels);
+
+    return true;
+}
+
 void Image::Unload()
 {
     if (data != nullptr)
@@ -2,21 +2,43 @@
 
 #include "../core/all.hpp"
 #include "../deps/sdl.hpp"
+#include "binary.hpp"
 #include <vulkan/vulkan.h>
 #include <vulkan/vulkan_beta.h>
 
 namespace io
 {
 
+// Pixels are always tightly packed RGBA, 4 bytes per pixel and no row padding, so GetPixelData() and Size() can be
+// handed to a staging upload as they are. Decoding runs on any thread, images do not share state.
 class Image
 {
 public:
+    using Ptr = std::shared_ptr<Image>;
+
     Image();
     ~Image();
+    Image(const Image &)            = delete;
+    Image &operator=(const Image &) = delete;
+
+    // reads the file on reader's I/O thread and decodes it on pool, reading the next file overlaps decoding,
+    // the image is empty when it could not be loaded
+    static std::future<Ptr> LoadAsync(const std::string &filename, AsyncReader &reader, Parallel::Pool &pool);
+    // pixels tightly packed RGB to RGBA with opaque alpha, dst may be e.g. mapped staging memory
+    static void RGBToRGBA(const uint8 *src, uint8 *dst, size_t pixels);
+    // kernel RGBToRGBA picked for this CPU, "SSSE3", "NEON" or "scalar"
+    static const char *RGBToRGBABackend();
 
+    // any format SDL_image decodes, converted to RGBA
     bool Load(const std::string &filename);
+    // encoded file contents already in memory, name is only used in messages
+    bool Load(ByteView encoded, const std::string &name);
+    // blank RGBA image, e.g. a target for GPU readback
+    bool Create(int32 width, int32 height);
+    bool SavePNG(const std::string &filename) const;
     void Unload();
 
+    bool IsEmpty() const { return data == nullptr; }
     inline unsigned char *GetPixelData() const { return data; }
 
     VkDeviceSize Size() const { return Width * Height * Channels; }
@@ -31,6 +53,10 @@ public:
 public:
     int32 Width, Height, Channels;
 
+private:
+    // takes ownership of decoded, nullptr when decoding failed
+    bool adopt(SDL_Surface *decoded, const std::string &name);
+
 private:
     unsigned char *data  = nullptr;
     SDL_Surface *surface = nullptr;
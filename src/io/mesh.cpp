@@ -0,0 +1,187 @@
+#include "mesh.hpp"
+
+#include "../deps/sdl.hpp"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+
+namespace io
+{
+
+static size_t AlignUp(size_t value, size_t alignment) { return (value + alignment - 1) / alignment * alignment; }
+
+MeshFile::MeshFile() : vertexData(nullptr), indexData(nullptr), vertexCount(0), indexCount(0), bounds({ZERO, ZERO}) {}
+
+MeshFile::Ptr MeshFile::LoadCached(const std::string &source)
+{
+    sdl::Stopwatch stopwatch;
+    auto filename = source + ".mesh";
+
+    SourceKey key;
+    if (!QuerySource(source, key))
+    {
+        fmtx::Error(fmt::format("Mesh source {} not found", source));
+        return Ptr(new MeshFile());
+    }
+
+    auto file = Open(filename, key);
+    if (!file->IsEmpty())
+    {
+        fmtx::Info(fmt::format(
+            "Mesh cache {} loaded in {:.2f} ms, {} vertices, {} indices",
+            filename,
+            stopwatch.ElapsedMilliseconds(),
+            file->VertexCount(),
+            file->IndexCount()
+        ));
+        return file;
+    }
+
+    fmtx::Info(fmt::format("Mesh cache {} missing or stale, rebuilding from {}", filename, source));
+    OBJ obj;
+    if (!obj.Load(source)) return file;
+
+    // serve the serialized bytes directly, a failed write only costs the next launch a rebuild
+    auto bytes = serialize(obj.GetMesh(), key);
+    if (bytes.empty()) return file;
+    if (!BinaryFile::Save(filename, bytes.data(), bytes.size()))
+        fmtx::Warn(fmt::format("Failed to write mesh cache {}", filename));
+
+    file->owned = std::move(bytes);
+    if (!file->attach(file->owned.data(), file->owned.size(), key)) return Ptr(new MeshFile());
+
+    return file;
+}
+
+MeshFile::Ptr MeshFile::Open(const std::string &filename, const SourceKey &key)
+{
+    Ptr file(new MeshFile());
+
+    auto mapped = MappedFile::Open(filename);
+    if (mapped->IsEmpty() || !file->attach(mapped->Data(), mapped->Size(), key)) return Ptr(new MeshFile());
+    file->mapped = mapped;
+
+    return file;
+}
+
+bool MeshFile::Save(const std::string &filename, const OBJ::Mesh &mesh, const SourceKey &key)
+{
+    auto bytes = serialize(mesh, key);
+
+    return !bytes.empty() && BinaryFile::Save(filename, bytes.data(), bytes.size());
+}
+
+bool MeshFile::QuerySource(const std::string &source, SourceKey &key)
+{
+    std::error_code error;
+    auto size = std::filesystem::file_size(source, error);
+    if (error) return false;
+    auto time = std::filesystem::last_write_time(source, error);
+    if (error) return false;
+
+    key.size = uint64_t(size);
+    key.time = int64_t(time.time_since_epoch().count());
+
+    return true;
+}
+
+std::vector<MeshFile::Attribute> MeshFile::vertexLayout()
+{
+    return {
+        {Semantic::Position, 3, uint32_t(offsetof(OBJ::Vertex, pos)), 0},
+        {Semantic::Color, 3, uint32_t(offsetof(OBJ::Vertex, color)), 0},
+        {Semantic::TexCoord, 2, uint32_t(offsetof(OBJ::Vertex, texCoord)), 0},
+    };
+}
+
+std::vector<char> MeshFile::serialize(const OBJ::Mesh &mesh, const SourceKey &key)
+{
+    if (mesh.vertices.empty() || mesh.indices.empty() ||
+        mesh.vertices.size() > std::numeric_limits<uint32_t>::max() ||
+        mesh.indices.size() > std::numeric_limits<uint32_t>::max())
+    {
+        fmtx::Error("Mesh is empty or too large for a mesh file");
+        return {};
+    }
+
+    auto attributes = vertexLayout();
+
+    Header header{};
+    header.magic          = Magic;
+    header.version        = Version;
+    header.sourceSize     = key.size;
+    header.sourceTime     = key.time;
+    header.vertexStride   = uint32_t(sizeof(OBJ::Vertex));
+    header.attributeCount = uint32_t(attributes.size());
+    header.vertexCount    = mesh.vertices.size();
+    header.vertexOffset   = AlignUp(sizeof(Header) + attributes.size() * sizeof(Attribute), BlobAlignment);
+    header.indexCount     = mesh.indices.size();
+    header.indexOffset    = AlignUp(header.vertexOffset + mesh.vertices.size() * sizeof(OBJ::Vertex), BlobAlignment);
+
+    Vec3 min = mesh.vertices[0].pos;
+    Vec3 max = mesh.vertices[0].pos;
+    for (const auto &vertex : mesh.vertices)
+    {
+        min = glm::min(min, vertex.pos);
+        max = glm::max(max, vertex.pos);
+    }
+    for (int i = 0; i < 3; ++i)
+    {
+        header.boundsMin[i] = min[i];
+        header.boundsMax[i] = max[i];
+    }
+
+    std::vector<char> bytes(header.indexOffset + mesh.indices.size() * sizeof(uint32_t), 0);
+    std::memcpy(bytes.data(), &header, sizeof(Header));
+    std::memcpy(bytes.data() + sizeof(Header), attributes.data(), attributes.size() * sizeof(Attribute));
+    std::memcpy(bytes.data() + header.vertexOffset, mesh.vertices.data(), mesh.vertices.size() * sizeof(OBJ::Vertex));
+    std::memcpy(bytes.data() + header.indexOffset, mesh.indices.data(), mesh.indices.size() * sizeof(uint32_t));
+
+    return bytes;
+}
+
+bool MeshFile::attach(const char *data, size_t size, const SourceKey &key)
+{
+    if (size < sizeof(Header)) return false;
+
+    Header header;
+    std::memcpy(&header, data, sizeof(Header));
+    if (header.magic != Magic || header.version != Version) return false;
+    if (header.sourceSize != key.size || header.sourceTime != key.time) return false;
+
+    // the blobs are used in place as OBJ::Vertex, anything written with another layout is rebuilt
+    auto expected = vertexLayout();
+    if (header.vertexStride != sizeof(OBJ::Vertex) || header.attributeCount != expected.size()) return false;
+    if (size < sizeof(Header) + expected.size() * sizeof(Attribute)) return false;
+    layout.resize(expected.size());
+    std::memcpy(layout.data(), data + sizeof(Header), expected.size() * sizeof(Attribute));
+    if (std::memcmp(layout.data(), expected.data(), expected.size() * sizeof(Attribute)) != 0) return false;
+
+    if (header.vertexCount == 0 || header.vertexCount > std::numeric_limits<uint32_t>::max() ||
+        header.indexCount == 0 || header.indexCount > std::numeric_limits<uint32_t>::max())
+        return false;
+    if (header.vertexOffset % BlobAlignment != 0 || header.indexOffset % BlobAlignment != 0) return false;
+    if (header.vertexOffset > size || header.vertexCount * sizeof(OBJ::Vertex) > size - header.vertexOffset)
+        return false;
+    if (header.indexOffset > size || header.indexCount * sizeof(uint32_t) > size - header.indexOffset) return false;
+
+    // the key only covers the source, a cache corrupted since it was written must not hand bad indices to the GPU
+    const auto *indices = reinterpret_cast<const uint32_t *>(data + header.indexOffset);
+    if (*std::max_element(indices, indices + header.indexCount) >= header.vertexCount)
+    {
+        fmtx::Warn("Mesh cache has indices past its vertices");
+        return false;
+    }
+
+    vertexData  = data + header.vertexOffset;
+    indexData   = data + header.indexOffset;
+    vertexCount = uint32_t(header.vertexCount);
+    indexCount  = uint32_t(header.indexCount);
+    bounds.min  = Vec3(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+    bounds.max  = Vec3(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+
+    return true;
+}
+
+} // namespace io
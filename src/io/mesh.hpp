@@ -0,0 +1,107 @@
+#pragma once
+
+#include "binary.hpp"
+#include "obj.hpp"
+
+namespace io
+{
+
+// Binary container of a welded OBJ::Mesh, loaded by mapping the file without parsing or copying.
+// Layout: Header, Attribute table, then vertex and index blobs each aligned to BlobAlignment, so both can be handed
+// to a staging upload as they are. A file is only accepted when it was written from a source of the same size and
+// modification time, LoadCached regenerates it from the OBJ otherwise.
+class MeshFile
+{
+public:
+    using Ptr = std::shared_ptr<MeshFile>;
+
+    enum class Semantic : uint32_t
+    {
+        Position,
+        Color,
+        TexCoord,
+        Normal,
+    };
+
+    // float components of one vertex attribute
+    struct Attribute
+    {
+        Semantic semantic;
+        uint32_t components;
+        uint32_t offset;
+        uint32_t reserved;
+    };
+
+    struct Bounds
+    {
+        Vec3 min;
+        Vec3 max;
+    };
+
+    // identifies the source a cache was written from
+    struct SourceKey
+    {
+        uint64_t size = 0;
+        int64_t time  = 0;
+    };
+
+    static constexpr size_t BlobAlignment = 64;
+
+    // <source>.mesh when it matches the source, rebuilt from the OBJ and written back otherwise
+    static Ptr LoadCached(const std::string &source);
+    // empty when missing, written by another version or not matching key
+    static Ptr Open(const std::string &filename, const SourceKey &key);
+    static bool Save(const std::string &filename, const OBJ::Mesh &mesh, const SourceKey &key);
+    static bool QuerySource(const std::string &source, SourceKey &key);
+
+    bool IsEmpty() const { return vertexCount == 0; }
+    const OBJ::Vertex *Vertices() const { return reinterpret_cast<const OBJ::Vertex *>(vertexData); }
+    const uint32_t *Indices() const { return reinterpret_cast<const uint32_t *>(indexData); }
+    uint32_t VertexCount() const { return vertexCount; }
+    uint32_t IndexCount() const { return indexCount; }
+    size_t VertexDataSize() const { return size_t(vertexCount) * sizeof(OBJ::Vertex); }
+    size_t IndexDataSize() const { return size_t(indexCount) * sizeof(uint32_t); }
+    const std::vector<Attribute> &Layout() const { return layout; }
+    const Bounds &GetBounds() const { return bounds; }
+
+private:
+    struct Header
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t sourceSize;
+        int64_t sourceTime;
+        uint32_t vertexStride;
+        uint32_t attributeCount;
+        uint64_t vertexCount;
+        uint64_t vertexOffset;
+        uint64_t indexCount;
+        uint64_t indexOffset;
+        // reserved for meshlets, written as 0 until a meshlet builder exists
+        uint64_t meshletCount;
+        uint64_t meshletOffset;
+        float boundsMin[3];
+        float boundsMax[3];
+    };
+
+    static constexpr uint32_t Magic   = 0x48534D44; // "DMSH"
+    static constexpr uint32_t Version = 1;
+
+    MeshFile();
+    static std::vector<Attribute> vertexLayout();
+    static std::vector<char> serialize(const OBJ::Mesh &mesh, const SourceKey &key);
+    bool attach(const char *data, size_t size, const SourceKey &key);
+
+private:
+    // keeps the bytes alive, either the mapping or the freshly serialized file
+    MappedFile::Ptr mapped;
+    std::vector<char> owned;
+    const char *vertexData;
+    const char *indexData;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    std::vector<Attribute> layout;
+    Bounds bounds;
+};
+
+} // namespace io
@@ -1,8 +1,324 @@
 #include "obj.hpp"
 
+#include "../deps/sdl.hpp"
+#include "binary.hpp"
+#include <cstdlib>
+#include <cstring>
+#include <unordered_map>
+
 #define TINYOBJLOADER_IMPLEMENTATION
 #include <tiny_obj_loader.h>
 
+namespace
+{
+// Vertex has no normal, corners that differ only in their normal index produce the same vertex and weld
+struct CornerKey
+{
+    int position;
+    int texCoord;
+
+    bool operator==(const CornerKey &other) const { return position == other.position && texCoord == other.texCoord; }
+};
+
+struct CornerKeyHash
+{
+    size_t operator()(const CornerKey &key) const
+    {
+        return std::hash<uint64_t>()((uint64_t(uint32_t(key.position)) << 32) | uint32_t(key.texCoord));
+    }
+};
+
+io::OBJ::Vertex MakeVertex(const tinyobj::attrib_t &attrib, const CornerKey &key)
+{
+    io::OBJ::Vertex vertex{};
+    // X stays same, Y becomes Z, Z becomes -Y
+    vertex.pos = {
+        attrib.vertices[3 * key.position + 0],
+        attrib.vertices[3 * key.position + 2],
+        -attrib.vertices[3 * key.position + 1],
+    };
+
+    // vulkan fix: 1 - v, corners without texture coordinates map to the origin
+    if (key.texCoord >= 0)
+        vertex.texCoord = {attrib.texcoords[2 * key.texCoord + 0], 1.0f - attrib.texcoords[2 * key.texCoord + 1]};
+
+    vertex.color = {1.0f, 1.0f, 1.0f};
+
+    return vertex;
+}
+
+// chunks smaller than this are not worth a thread of their own
+constexpr size_t MinChunkBytes = size_t(1) << 20;
+
+// exactly representable as doubles, mantissa * or / these rounds once
+constexpr double Pow10[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                            1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+struct ShapeStart
+{
+    std::string name;
+    size_t firstCorner;
+};
+
+// a run of whole lines parsed by one thread, attributes go straight into the shared arrays at the chunk's base
+struct Chunk
+{
+    const char *begin;
+    const char *end;
+    size_t positions    = 0;
+    size_t texCoords    = 0;
+    size_t normals      = 0;
+    size_t positionBase = 0;
+    size_t texCoordBase = 0;
+    size_t normalBase   = 0;
+    // triangulated, 3 corners per face
+    std::vector<tinyobj::index_t> corners;
+    std::vector<ShapeStart> shapeStarts;
+    std::string error;
+};
+
+bool IsDigit(char c) { return c >= '0' && c <= '9'; }
+
+bool IsSpace(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+const char *SkipSpaces(const char *p, const char *end)
+{
+    while (p < end && IsSpace(*p)) ++p;
+    return p;
+}
+
+const char *NextLine(const char *p, const char *end)
+{
+    auto *newline = static_cast<const char *>(std::memchr(p, '\n', size_t(end - p)));
+    return newline != nullptr ? newline + 1 : end;
+}
+
+// keyword at p followed by whitespace, e.g. "vt" in "vt 0.5 0.5"
+bool IsKeyword(const char *p, const char *end, const char *keyword)
+{
+    for (; *keyword != '\0'; ++p, ++keyword)
+    {
+        if (p == end || *p != *keyword) return false;
+    }
+    return p < end && IsSpace(*p);
+}
+
+// inf, nan, hex floats and exponents beyond what Pow10 covers, the mapped file is not null terminated
+const char *ParseFloatSlow(const char *p, const char *end, float &value)
+{
+    char buffer[64];
+    size_t length = 0;
+    while (p + length < end && length + 1 < sizeof(buffer) && !IsSpace(p[length]) && p[length] != '\n')
+    {
+        buffer[length] = p[length];
+        ++length;
+    }
+    buffer[length] = '\0';
+
+    char *parsed = nullptr;
+    value        = std::strtof(buffer, &parsed);
+    return p + (parsed - buffer);
+}
+
+// decimal float without locale, allocation or null terminator, returns p when nothing was parsed
+const char *ParseFloat(const char *p, const char *end, float &value)
+{
+    auto *start   = p;
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) negative = *p++ == '-';
+
+    // up to 19 significant digits fit into 64 bits, later ones only move the exponent
+    uint64_t mantissa = 0;
+    int digits        = 0;
+    int exponent      = 0;
+    bool any          = false;
+    for (; p < end && IsDigit(*p); ++p)
+    {
+        any = true;
+        if (digits < 19)
+        {
+            mantissa = mantissa * 10 + uint64_t(*p - '0');
+            if (mantissa != 0) ++digits;
+        }
+        else
+            ++exponent;
+    }
+    if (p < end && *p == '.')
+    {
+        for (++p; p < end && IsDigit(*p); ++p)
+        {
+            any = true;
+            if (digits < 19)
+            {
+                mantissa = mantissa * 10 + uint64_t(*p - '0');
+                if (mantissa != 0) ++digits;
+                --exponent;
+            }
+        }
+    }
+    if (!any) return ParseFloatSlow(start, end, value);
+
+    if (p < end && (*p == 'e' || *p == 'E'))
+    {
+        auto *q          = p + 1;
+        bool negativeExp = false;
+        if (q < end && (*q == '-' || *q == '+')) negativeExp = *q++ == '-';
+        if (q < end && IsDigit(*q))
+        {
+            int e = 0;
+            for (; q < end && IsDigit(*q); ++q)
+            {
+                if (e < 10000) e = e * 10 + (*q - '0');
+            }
+            exponent += negativeExp ? -e : e;
+            p = q;
+        }
+    }
+    if (exponent < -22 || exponent > 22) return ParseFloatSlow(start, end, value);
+
+    double result = double(mantissa);
+    result        = exponent < 0 ? result / Pow10[-exponent] : result * Pow10[exponent];
+    value         = float(negative ? -result : result);
+
+    return p;
+}
+
+// 1 based and negative (relative) OBJ indices, 0 when missing
+const char *ParseIndex(const char *p, const char *end, int &value)
+{
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) negative = *p++ == '-';
+
+    int64_t result = 0;
+    for (; p < end && IsDigit(*p); ++p)
+    {
+        if (result < INT32_MAX) result = result * 10 + (*p - '0');
+    }
+    value = int(std::min<int64_t>(result, INT32_MAX)) * (negative ? -1 : 1);
+
+    return p;
+}
+
+// absolute, 0 based index or -1 when missing or out of range, defined is the number of attributes before the line
+int ResolveIndex(int index, size_t defined, size_t total)
+{
+    if (index == 0) return -1;
+
+    int64_t resolved = index > 0 ? int64_t(index) - 1 : int64_t(defined) + index;
+    return resolved >= 0 && size_t(resolved) < total ? int(resolved) : -1;
+}
+
+void CountAttributes(Chunk &chunk)
+{
+    for (auto *p = chunk.begin; p < chunk.end; p = NextLine(p, chunk.end))
+    {
+        p = SkipSpaces(p, chunk.end);
+        if (IsKeyword(p, chunk.end, "v"))
+            ++chunk.positions;
+        else if (IsKeyword(p, chunk.end, "vt"))
+            ++chunk.texCoords;
+        else if (IsKeyword(p, chunk.end, "vn"))
+            ++chunk.normals;
+    }
+}
+
+const char *ParseFloats(const char *p, const char *end, float *values, int required, int count)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        p        = SkipSpaces(p, end);
+        auto *at = p;
+        p        = ParseFloat(p, end, values[i]);
+        if (p == at)
+        {
+            if (i < required) return nullptr;
+            values[i] = 0;
+        }
+    }
+    return p;
+}
+
+void ParseChunk(Chunk &chunk, tinyobj::attrib_t &attrib)
+{
+    size_t positions = 0;
+    size_t texCoords = 0;
+    size_t normals   = 0;
+    std::vector<tinyobj::index_t> face;
+
+    auto totalPositions = attrib.vertices.size() / 3;
+    auto totalTexCoords = attrib.texcoords.size() / 2;
+    auto totalNormals   = attrib.normals.size() / 3;
+    auto *end           = chunk.end;
+    for (auto *line = chunk.begin; line < end; line = NextLine(line, end))
+    {
+        auto *p = SkipSpaces(line, end);
+        if (IsKeyword(p, end, "v"))
+        {
+            if (!ParseFloats(p + 1, end, &attrib.vertices[3 * (chunk.positionBase + positions)], 3, 3))
+                chunk.error = "malformed vertex";
+            ++positions;
+        }
+        else if (IsKeyword(p, end, "vt"))
+        {
+            if (!ParseFloats(p + 2, end, &attrib.texcoords[2 * (chunk.texCoordBase + texCoords)], 1, 2))
+                chunk.error = "malformed texture coordinate";
+            ++texCoords;
+        }
+        else if (IsKeyword(p, end, "vn"))
+        {
+            if (!ParseFloats(p + 2, end, &attrib.normals[3 * (chunk.normalBase + normals)], 3, 3))
+                chunk.error = "malformed normal";
+            ++normals;
+        }
+        else if (IsKeyword(p, end, "f"))
+        {
+            face.clear();
+            for (p = SkipSpaces(p + 1, end); p < end && *p != '\n' && *p != '#'; p = SkipSpaces(p, end))
+            {
+                int position = 0, texCoord = 0, normal = 0;
+                p = ParseIndex(p, end, position);
+                if (p < end && *p == '/')
+                {
+                    if (++p < end && *p != '/') p = ParseIndex(p, end, texCoord);
+                    if (p < end && *p == '/') p = ParseIndex(p + 1, end, normal);
+                }
+
+                tinyobj::index_t corner;
+                corner.vertex_index   = ResolveIndex(position, chunk.positionBase + positions, totalPositions);
+                corner.texcoord_index = ResolveIndex(texCoord, chunk.texCoordBase + texCoords, totalTexCoords);
+                corner.normal_index   = ResolveIndex(normal, chunk.normalBase + normals, totalNormals);
+                if (corner.vertex_index < 0 || (texCoord != 0 && corner.texcoord_index < 0) ||
+                    (normal != 0 && corner.normal_index < 0))
+                {
+                    chunk.error = "face index out of range";
+                    break;
+                }
+                face.push_back(corner);
+                // anything else than an index stops the face instead of spinning on it
+                if (p < end && !IsSpace(*p) && *p != '\n') break;
+            }
+
+            // fan triangulation, the same tinyobj does for convex polygons
+            for (size_t i = 1; i + 1 < face.size(); ++i)
+            {
+                chunk.corners.push_back(face[0]);
+                chunk.corners.push_back(face[i]);
+                chunk.corners.push_back(face[i + 1]);
+            }
+        }
+        else if (IsKeyword(p, end, "o") || IsKeyword(p, end, "g"))
+        {
+            auto *name    = SkipSpaces(p + 1, end);
+            auto *nameEnd = NextLine(name, end);
+            while (nameEnd > name && (IsSpace(nameEnd[-1]) || nameEnd[-1] == '\n')) --nameEnd;
+            chunk.shapeStarts.push_back({std::string(name, nameEnd), chunk.corners.size()});
+        }
+
+        if (!chunk.error.empty()) return;
+    }
+}
+} // namespace
+
 namespace io
 {
 
@@ -10,7 +326,26 @@ OBJ::OBJ() {}
 
 OBJ::~OBJ() { Unload(); }
 
-bool OBJ::Load(const std::string &filename)
+bool OBJ::Load(const std::string &filename, Parser parser)
+{
+    sdl::Stopwatch stopwatch;
+    attrib = tinyobj::attrib_t();
+    shapes.clear();
+    materials.clear();
+
+    bool ok = parser == Parser::TinyObj ? loadTinyObj(filename) : loadMapped(filename);
+    if (!ok) return false;
+
+    auto parsed = stopwatch.ElapsedMilliseconds();
+    LoadMesh();
+    fmtx::Info(fmt::format(
+        "Loaded {} in {:.2f} ms, {:.2f} ms parsing", filename, stopwatch.ElapsedMilliseconds(), parsed
+    ));
+
+    return true;
+}
+
+bool OBJ::loadTinyObj(const std::string &filename)
 {
     std::string warn, err;
 
@@ -19,38 +354,210 @@ bool OBJ::Load(const std::string &filename)
     if (!warn.empty()) fmtx::Warn(warn);
     if (!err.empty()) fmtx::Error(err);
 
-    if (ok) LoadMesh();
-
     return ok;
 }
 
+bool OBJ::loadMapped(const std::string &filename)
+{
+    auto file = MappedFile::Open(filename);
+    if (file->IsEmpty())
+    {
+        fmtx::Error(fmt::format("Failed to open {}", filename));
+        return false;
+    }
+
+    // split at line boundaries, one chunk per thread
+    auto *data       = file->Data();
+    auto chunkCount  = std::max<size_t>(1, std::min<size_t>(Parallel::ThreadCount(), file->Size() / MinChunkBytes));
+    auto chunkLength = file->Size() / chunkCount;
+    std::vector<Chunk> chunks(chunkCount);
+    for (size_t i = 0; i < chunkCount; ++i)
+    {
+        chunks[i].begin = i == 0 ? data : chunks[i - 1].end;
+        auto *split     = std::max(chunks[i].begin, data + (i + 1) * chunkLength - 1);
+        chunks[i].end   = i + 1 == chunkCount ? data + file->Size() : NextLine(split, data + file->Size());
+    }
+
+    // counting first gives every chunk its place in the shared arrays and resolves relative indices while parsing
+    Parallel::For(
+        uint32(chunkCount),
+        [&](uint32 begin, uint32 end)
+        {
+            for (auto i = begin; i < end; ++i) CountAttributes(chunks[i]);
+        },
+        1
+    );
+    size_t positions = 0, texCoords = 0, normals = 0;
+    for (auto &chunk : chunks)
+    {
+        chunk.positionBase = positions;
+        chunk.texCoordBase = texCoords;
+        chunk.normalBase   = normals;
+        positions += chunk.positions;
+        texCoords += chunk.texCoords;
+        normals += chunk.normals;
+    }
+    attrib.vertices.resize(3 * positions);
+    attrib.texcoords.resize(2 * texCoords);
+    attrib.normals.resize(3 * normals);
+
+    Parallel::For(
+        uint32(chunkCount),
+        [&](uint32 begin, uint32 end)
+        {
+            for (auto i = begin; i < end; ++i) ParseChunk(chunks[i], attrib);
+        },
+        1
+    );
+    for (const auto &chunk : chunks)
+    {
+        if (chunk.error.empty()) continue;
+        fmtx::Error(fmt::format("Failed to parse {}: {}", filename, chunk.error));
+        return false;
+    }
+
+    // faces before the first o/g line and shapes spanning chunk boundaries are stitched together here
+    tinyobj::shape_t shape;
+    auto flush = [&]()
+    {
+        if (!shape.mesh.indices.empty())
+        {
+            shape.mesh.num_face_vertices.assign(shape.mesh.indices.size() / 3, 3);
+            shape.mesh.material_ids.assign(shape.mesh.indices.size() / 3, -1);
+            shapes.push_back(std::move(shape));
+        }
+        shape = tinyobj::shape_t();
+    };
+    for (const auto &chunk : chunks)
+    {
+        size_t from = 0;
+        for (const auto &start : chunk.shapeStarts)
+        {
+            shape.mesh.indices.insert(
+                shape.mesh.indices.end(), chunk.corners.begin() + from, chunk.corners.begin() + start.firstCorner
+            );
+            flush();
+            shape.name = start.name;
+            from       = start.firstCorner;
+        }
+        shape.mesh.indices.insert(shape.mesh.indices.end(), chunk.corners.begin() + from, chunk.corners.end());
+    }
+    flush();
+
+    return true;
+}
+
 void OBJ::Unload() {}
 
-void OBJ::LoadMesh()
+OBJ::Polygons OBJ::GetPolygons() const
 {
+    Polygons polygons;
+
+    polygons.positions.reserve(attrib.vertices.size() / 3);
+    for (size_t i = 0; i + 2 < attrib.vertices.size(); i += 3)
+    {
+        // same axis swap as LoadMesh: Y becomes Z, Z becomes -Y
+        polygons.positions.emplace_back(attrib.vertices[i + 0], attrib.vertices[i + 2], -attrib.vertices[i + 1]);
+    }
+
     for (const auto &shape : shapes)
     {
-        for (const auto &index : shape.mesh.indices)
-        {
-            Vertex vertex{};
-            vertex.pos = {
-                attrib.vertices[3 * index.vertex_index + 0], // X stays same
-                // attrib.vertices[3 * index.vertex_index + 1],  // Y becomes Z
-                // attrib.vertices[3 * index.vertex_index + 2]}; // Z becomes -Y
-                attrib.vertices[3 * index.vertex_index + 2], // Y becomes Z
-                -attrib.vertices[3 * index.vertex_index + 1]
-            }; // Z becomes -Y
+        for (const auto &index : shape.mesh.indices) polygons.indices.emplace_back(index.vertex_index);
+        for (auto size : shape.mesh.num_face_vertices) polygons.faceSizes.emplace_back(size);
+    }
 
-            vertex.texCoord = {
-                attrib.texcoords[2 * index.texcoord_index + 0], 1.0f - attrib.texcoords[2 * index.texcoord_index + 1]
-            }; // vulkan fix: 1 - v
+    return polygons;
+}
 
-            vertex.color = {1.0f, 1.0f, 1.0f};
+void OBJ::LoadMesh()
+{
+    sdl::Stopwatch stopwatch;
+    mesh.vertices.clear();
+    mesh.indices.clear();
+
+    // corners are welded per shape in parallel, each shape keeps its unique keys in first use order
+    std::vector<std::vector<CornerKey>> shapeKeys(shapes.size());
+    std::vector<std::vector<uint32_t>> shapeIndices(shapes.size());
+    Parallel::For(
+        uint32(shapes.size()),
+        [&](uint32 begin, uint32 end)
+        {
+            for (auto s = begin; s < end; ++s)
+            {
+                const auto &corners = shapes[s].mesh.indices;
+                std::unordered_map<CornerKey, uint32_t, CornerKeyHash> unique;
+                unique.reserve(corners.size());
+                shapeIndices[s].reserve(corners.size());
+                for (const auto &corner : corners)
+                {
+                    CornerKey key{corner.vertex_index, corner.texcoord_index};
+                    auto [it, inserted] = unique.try_emplace(key, uint32_t(shapeKeys[s].size()));
+                    if (inserted) shapeKeys[s].push_back(key);
+                    shapeIndices[s].push_back(it->second);
+                }
+            }
+        },
+        1
+    );
 
-            mesh.vertices.emplace_back(vertex);
-            mesh.indices.emplace_back(mesh.indices.size());
+    // shapes sharing a corner (seams between objects) weld here, serially over unique keys only
+    size_t cornerCount = 0;
+    size_t uniqueCount = 0;
+    for (size_t s = 0; s < shapes.size(); ++s)
+    {
+        cornerCount += shapeIndices[s].size();
+        uniqueCount += shapeKeys[s].size();
+    }
+    std::vector<CornerKey> keys;
+    keys.reserve(uniqueCount);
+    std::unordered_map<CornerKey, uint32_t, CornerKeyHash> welded;
+    welded.reserve(uniqueCount);
+    std::vector<std::vector<uint32_t>> shapeRemap(shapes.size());
+    for (size_t s = 0; s < shapes.size(); ++s)
+    {
+        shapeRemap[s].reserve(shapeKeys[s].size());
+        for (const auto &key : shapeKeys[s])
+        {
+            auto [it, inserted] = welded.try_emplace(key, uint32_t(keys.size()));
+            if (inserted) keys.push_back(key);
+            shapeRemap[s].push_back(it->second);
         }
     }
+
+    std::vector<size_t> shapeOffsets(shapes.size() + 1, 0);
+    for (size_t s = 0; s < shapes.size(); ++s) shapeOffsets[s + 1] = shapeOffsets[s] + shapeIndices[s].size();
+    mesh.indices.resize(cornerCount);
+    mesh.vertices.resize(keys.size());
+    Parallel::For(
+        uint32(shapes.size()),
+        [&](uint32 begin, uint32 end)
+        {
+            for (auto s = begin; s < end; ++s)
+            {
+                auto *out = mesh.indices.data() + shapeOffsets[s];
+                for (auto local : shapeIndices[s]) *out++ = shapeRemap[s][local];
+            }
+        },
+        1
+    );
+    Parallel::For(
+        uint32(keys.size()),
+        [&](uint32 begin, uint32 end)
+        {
+            for (auto i = begin; i < end; ++i) mesh.vertices[i] = MakeVertex(attrib, keys[i]);
+        }
+    );
+
+    auto before = cornerCount * sizeof(Vertex);
+    auto after  = mesh.vertices.size() * sizeof(Vertex) + mesh.indices.size() * sizeof(uint32_t);
+    fmtx::Info(fmt::format(
+        "OBJ mesh welded in {:.2f} ms: {} corners to {} vertices, {} KB to {} KB of vertex and index data",
+        stopwatch.ElapsedMilliseconds(),
+        cornerCount,
+        mesh.vertices.size(),
+        (before + cornerCount * sizeof(uint32_t)) / 1024,
+        after / 1024
+    ));
 }
 
 } // namespace io
@@ -24,15 +24,35 @@ public:
         std::vector<uint32_t> indices;
     };
 
+    // positions shared by all shapes, face f uses faceSizes[f] consecutive entries of indices
+    struct Polygons
+    {
+        std::vector<Vec3> positions;
+        std::vector<uint32_t> indices;
+        std::vector<uint32_t> faceSizes;
+    };
+
+    enum class Parser
+    {
+        // file mapped into memory and parsed on all cores, triangles, quads and convex polygons only
+        Mapped,
+        // reference implementation, single threaded
+        TinyObj,
+    };
+
 public:
     OBJ();
     ~OBJ();
 
-    bool Load(const std::string &filename);
+    bool Load(const std::string &filename, Parser parser = Parser::Mapped);
     void Unload();
     const Mesh &GetMesh() const { return mesh; }
+    Polygons GetPolygons() const;
 
 private:
+    bool loadTinyObj(const std::string &filename);
+    bool loadMapped(const std::string &filename);
+    // face corners with the same position and texture coordinate share one vertex
     void LoadMesh();
 
 private:
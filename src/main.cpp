@@ -4,12 +4,138 @@
 #include "gl/app.hpp"
 #include "gl/debug_renderer.hpp"
 #include "ui/ui.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <string>
 
-int main()
+// fewer indices than this per scene chunk cost more in secondary buffer overhead than parallel recording saves
+static constexpr uint32_t MinIndicesPerChunk = 3 * 4096;
+
+// value following name on the command line, empty when missing
+static std::string Option(int argc, char **argv, const std::string &name)
+{
+    for (int i = 1; i + 1 < argc; ++i)
+    {
+        if (argv[i] == name) return argv[i + 1];
+    }
+    return "";
+}
+
+// --frames-in-flight <1-4> and --present-mode <fifo|fifo-relaxed|mailbox|immediate>, shared by both modes
+static void ConfigureFramePacing(gl::App &app, int argc, char **argv)
+{
+    auto framesInFlight = Option(argc, argv, "--frames-in-flight");
+    if (!framesInFlight.empty()) app.MaxFramesInFlight(std::atoi(framesInFlight.c_str()));
+
+    auto presentMode = Option(argc, argv, "--present-mode");
+    if (presentMode.empty()) return;
+    if (auto mode = gl::ParsePresentMode(presentMode))
+        app.PresentMode(*mode);
+    else
+        fmtx::Warn(fmt::format("Unknown present mode {}, using FIFO", presentMode));
+}
+
+// true when the image is empty or every pixel has the clear color, i.e. nothing was drawn
+static bool IsBlank(const io::Image &image)
 {
+    const auto *pixels = image.GetPixelData();
+    const auto bytes   = size_t(image.Size());
+    for (size_t i = 4; !image.IsEmpty() && i < bytes; i += 4)
+        if (std::memcmp(pixels, pixels + i, 4) != 0) return false;
+
+    fmtx::Error("Last frame is blank");
+    return true;
+}
+
+// renders a fixed number of frames without a window and saves the last one, for CI and machines without a display
+static int RunHeadless(int argc, char **argv, uint64_t frames, const std::string &output, const std::string &trace)
+{
+    Dimension size{1600, 1000};
+    gl::App app;
+    ConfigureFramePacing(app, argc, argv);
+    app.MaxFrames(frames);
+    if (!app.InitHeadless(size))
+    {
+        fmtx::Error("Failed to init headless Vulkan");
+        return 1;
+    }
+    fmtx::Success("Headless Vulkan initialized");
+
+    // every frame should show the finished scene, not placeholders
+    if (!app.pipelineCompiler.Wait())
+    {
+        app.Shutdown();
+        return 1;
+    }
+
+    Camera camera;
+    camera.SetPosition(Vec3(2.0f, 2.0f, 2.0f));
+    camera.LookAt(ZERO);
+    camera.UpdatePerspective(size);
+
+    Transform transform;
+    transform.Rotate(-90);
+
+    int result = 0;
+    sdl::Stopwatch stopwatch;
+    while (!app.Finished())
+    {
+        auto beginStatus = app.BeginFrame();
+        if (beginStatus == gl::App::State::Error || !app.Render(camera.MVP(transform.ModelMatrix())) ||
+            app.EndFrame() == gl::App::State::Error)
+        {
+            result = 1;
+            break;
+        }
+    }
+    app.device.WaitIdle();
+    app.profiler.Finish();
+
+    auto ms = stopwatch.ElapsedMilliseconds();
+    fmtx::Info(fmt::format(
+        "Rendered {} frames in {:.2f} ms, {:.3f} ms per frame",
+        app.FramesRendered(),
+        ms,
+        ms / std::max<uint64_t>(app.FramesRendered(), 1)
+    ));
+
+    if (!trace.empty() && !app.profiler.ExportChromeTrace(trace)) result = 1;
+
+    io::Image image;
+    if (result == 0 && !output.empty())
+    {
+        if (!app.ReadPixels(image) || IsBlank(image))
+            result = 1;
+        else if (image.SavePNG(output))
+            fmtx::Success(fmt::format("Saved last frame to {}", output));
+        else
+            result = 1;
+    }
+
+    app.Shutdown();
+
+    return result;
+}
+
+int main(int argc, char **argv)
+{
+    // --headless <frames> [--output <file.png>] [--trace <file.json>]
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::string(argv[i]) != "--headless") continue;
+
+        uint64_t frames = i + 1 < argc ? std::strtoull(argv[i + 1], nullptr, 10) : 0;
+        auto output     = Option(argc, argv, "--output");
+        auto trace      = Option(argc, argv, "--trace");
+
+        return RunHeadless(argc, argv, std::max<uint64_t>(frames, 1), output, trace);
+    }
+
     sdl::Window window;
     gl::App app;
     UI ui;
+    ConfigureFramePacing(app, argc, argv);
 
     if (!window.Init(1600, 1000, "app"))
     {
@@ -33,7 +159,7 @@ int main()
     fmtx::Success("UI initialized");
 
     gl::DebugRenderer debug;
-    if (!debug.Init(app.device, app.physicalDevice, app.renderPass))
+    if (!debug.Init(app.device, app.physicalDevice, app.renderPass, app.pipelineCompiler))
     {
         fmtx::Error("Failed to init debug renderer");
         return 1;
@@ -81,6 +207,10 @@ int main()
 
             currentOperation = ObjectOperation::Translate;
         }
+        else if (window.KeyJustReleased(SDLK_F2))
+        {
+            app.profiler.ExportChromeTrace("trace.json");
+        }
         else if (window.KeyJustReleased(SDLK_r))
         {
             currentOperation     = ObjectOperation::Rotate;
@@ -100,6 +230,15 @@ int main()
         camera.UpdatePerspective(size);
         // experiment->Update(dt);
 
+        // ---------- ui -----------
+        // built before BeginFrame so it overlaps with the GPU still working on earlier frames
+        ui.BeginFrame(size);
+        ui.TransformGizmo(camera, transform, currentOperation, currentTransformMode, currentTransformAxis);
+        ui.ProfilerPanel(app.profiler);
+        ui.FramePacingPanel(app);
+        // experiment->RenderUI(camera, ui);
+        ui.EndFrame();
+
         // ---------- render -----------
         app.RequestRecreateSwapChain(window.WasResized());
         auto beginStatus = app.BeginFrame();
@@ -120,11 +259,7 @@ int main()
             break;
         }
 
-        ui.BeginFrame(size);
-        ui.TransformGizmo(camera, transform, currentOperation, currentTransformMode, currentTransformAxis);
-        // experiment->RenderUI(camera, ui);
-        ui.EndFrame();
-
+        gl::Profiler::CpuScope record(app.profiler, "Record and submit");
         app.commandBuffers.Reset(app.Frame());
         app.commandBuffers.Begin(app.Frame());
         app.commandBuffers.ClearColor({0.1f, 0.1f, 0.1f, 1.0f});
@@ -135,33 +270,70 @@ int main()
         debug.End(app.commandBuffers.handles[app.Frame()]);
 
         {
-            app.commandBuffers.CmdBeginRenderPass(
-                app.Frame(), app.renderPass, app.swapChainFramebuffers[app.ImageIndex()], app.swapChain.extent
-            );
-            app.uniformBuffersMemory[app.Frame()].CopyRaw(
-                app.device, &app.ubos[app.Frame()], sizeof(app.ubos[app.Frame()])
-            );
-            app.commandBuffers.CmdBindGraphicsPipeline(app.Frame(), app.graphicsPipeline);
-            app.commandBuffers.CmdViewport(app.Frame(), {0, 0}, app.swapChain.extent);
-            app.commandBuffers.CmdScissor(app.Frame(), {0, 0}, app.swapChain.extent);
-            app.commandBuffers.CmdBindDescriptorSet(
-                app.Frame(), app.graphicsPipeline, app.descriptorPool.descriptorSets[app.Frame()].handle
+            // mesh triangle ranges are recorded in parallel into secondary buffers, debug shapes take the last chunk
+            auto *pipeline      = app.pipelineCompiler.Select(app.graphicsPipeline);
+            auto indexCount     = app.indexCount;
+            uint32_t meshChunks = 0;
+            if (pipeline != nullptr)
+                meshChunks = std::clamp(indexCount / MinIndicesPerChunk, 1u, app.recorder.Lanes());
+            uint32_t perChunk = meshChunks > 0 ? (indexCount / 3 + meshChunks - 1) / meshChunks * 3 : 0;
+
+            app.uniformBuffers[app.Frame()].Write(app.allocator, &app.ubos[app.Frame()], sizeof(app.ubos[app.Frame()]));
+            const auto &framebuffer = app.swapChainFramebuffers[app.ImageIndex()];
+            auto secondaries        = app.recorder.Record(
+                meshChunks + 1,
+                app.renderPass,
+                framebuffer,
+                [&](uint32_t chunk, gl::CommandBuffer &commands, uint32_t i)
+                {
+                    // dynamic state is not inherited from the primary buffer
+                    commands.CmdViewport(i, {0, 0}, app.swapChain.extent);
+                    commands.CmdScissor(i, {0, 0}, app.swapChain.extent);
+                    if (chunk == meshChunks)
+                    {
+                        commands.CmdBeginDebugLabel(i, "Debug shapes", glm::value_ptr(ORANGE));
+                        debug.CmdDraw(camera, commands.handles[i]);
+                        commands.CmdEndDebugLabel(i);
+                        return;
+                    }
+
+                    auto first = chunk * perChunk;
+                    if (first >= indexCount) return;
+                    commands.CmdBindGraphicsPipeline(i, *pipeline);
+                    commands.CmdBindDescriptorSet(i, *pipeline, app.descriptorPool.descriptorSets[app.Frame()].handle);
+                    commands.CmdBindVertexBuffer(i, app.vertexBuffer);
+                    commands.CmdBindIndexBuffer(i, app.indexBuffer);
+                    commands.CmdDrawIndexed(i, std::min(perChunk, indexCount - first), first);
+                }
             );
-            app.commandBuffers.CmdBindVertexBuffer(app.Frame(), app.vertexBuffer);
-            app.commandBuffers.CmdBindIndexBuffer(app.Frame(), app.indexBuffer);
-            app.commandBuffers.CmdDrawIndexed(app.Frame(), static_cast<uint32_t>(app.indices.size()));
+            if (secondaries.empty())
+            {
+                window.Close();
+                break;
+            }
 
-            debug.CmdDraw(camera, app.commandBuffers.handles[app.Frame()]);
+            app.commandBuffers.CmdBeginDebugLabel(app.Frame(), "Scene", glm::value_ptr(CYAN));
+            app.commandBuffers.CmdBeginRenderPass(
+                app.Frame(),
+                app.renderPass,
+                framebuffer,
+                app.swapChain.extent,
+                VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS
+            );
+            app.commandBuffers.CmdExecuteCommands(app.Frame(), secondaries);
             app.commandBuffers.CmdEndRenderPass(app.Frame());
+            app.commandBuffers.CmdEndDebugLabel(app.Frame());
         }
 
         {
+            app.commandBuffers.CmdBeginDebugLabel(app.Frame(), "UI", glm::value_ptr(GREEN));
             app.commandBuffers.CmdBeginRenderingKHR(
                 app.Frame(), app.swapChain.extent, app.imageViews[app.ImageIndex()].handle
             );
 
             ui.CmdDraw(app.commandBuffers.handles[app.Frame()]);
             app.commandBuffers.CmdEndRenderingKHR(app.Frame());
+            app.commandBuffers.CmdEndDebugLabel(app.Frame());
             vk::ImageTransitionLayout(
                 app.device.handle,
                 app.commandBuffers.handles[app.Frame()],
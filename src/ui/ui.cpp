@@ -56,9 +56,11 @@ bool UI::Init(SDL_Window *wnd, const gl::App &app)
     init_info.PhysicalDevice              = app.physicalDevice.handle;
     init_info.Device                      = app.device.handle;
     init_info.Queue                       = app.device.graphicsQueue.handle;
+    init_info.PipelineCache               = app.pipelineCache.handle;
     init_info.DescriptorPool              = descriptorPool.handle;
-    init_info.MinImageCount               = app.MaxFramesInFlight();
-    init_info.ImageCount                  = app.MaxFramesInFlight();
+    // ImGui asserts on fewer than 2, its vertex buffers are rotated per image so extra ones are harmless
+    init_info.MinImageCount               = std::max(2, app.MaxFramesInFlight());
+    init_info.ImageCount                  = std::max(2, app.MaxFramesInFlight());
     init_info.MSAASamples                 = VK_SAMPLE_COUNT_1_BIT;
     init_info.UseDynamicRendering         = true;
     init_info.RenderPass                  = nullptr;
@@ -141,6 +143,113 @@ void UI::Grid(const Camera &camera)
 
 void UI::Demo() { ImGui::ShowDemoWindow(); }
 
+void UI::ProfilerPanel(const gl::Profiler &profiler)
+{
+    if (!ImGui::Begin("Profiler"))
+    {
+        ImGui::End();
+        return;
+    }
+
+    std::vector<float> cpu;
+    std::vector<float> gpu;
+    for (const auto *frame : profiler.History())
+    {
+        cpu.push_back(float(frame->cpu));
+        if (frame->gpuResolved) gpu.push_back(float(frame->gpu));
+    }
+    ImGui::PlotLines("CPU ms", cpu.data(), int(cpu.size()), 0, nullptr, 0, FLT_MAX, ImVec2(0, 60));
+    if (profiler.HasGpuTimestamps())
+        ImGui::PlotLines("GPU ms", gpu.data(), int(gpu.size()), 0, nullptr, 0, FLT_MAX, ImVec2(0, 60));
+
+    auto flags = ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingFixedFit;
+    if (ImGui::BeginTable("ProfilerScopes", 7, flags))
+    {
+        for (auto header : {"Scope", "", "avg", "p50", "p95", "p99", "max"}) ImGui::TableSetupColumn(header);
+        ImGui::TableHeadersRow();
+        for (const auto &stats : profiler.Summarize())
+        {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(stats.name.c_str());
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(stats.gpu ? "GPU" : "CPU");
+            for (auto ms : {stats.average, stats.p50, stats.p95, stats.p99, stats.max})
+            {
+                ImGui::TableNextColumn();
+                ImGui::Text("%.3f", ms);
+            }
+        }
+        ImGui::EndTable();
+    }
+
+    if (ImGui::Button("Export Chrome trace")) profiler.ExportChromeTrace("trace.json");
+    ImGui::End();
+}
+
+void UI::FramePacingPanel(gl::App &app)
+{
+    if (!ImGui::Begin("Frame pacing"))
+    {
+        ImGui::End();
+        return;
+    }
+
+    ImGui::Text("Frames in flight: %d", app.MaxFramesInFlight());
+    if (!app.IsHeadless() && ImGui::BeginCombo("Present mode", gl::PresentModeName(app.PresentMode())))
+    {
+        for (auto mode : app.physicalDevice.swapChainSupport.presentModes)
+        {
+            if (ImGui::Selectable(gl::PresentModeName(mode), mode == app.PresentMode())) app.PresentMode(mode);
+        }
+        ImGui::EndCombo();
+    }
+
+    const auto &pacing = app.Pacing();
+    auto flags         = ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingFixedFit;
+    if (ImGui::BeginTable("FramePacing", 2, flags))
+    {
+        std::pair<const char *, double> rows[] = {
+            {"Wait for frame", pacing.fenceWait},
+            {"Acquire image", pacing.acquire},
+            {"Wait for image", pacing.imageWait},
+            {"Present", pacing.present},
+            {"Frame", pacing.frame},
+        };
+        for (const auto &[name, ms] : rows)
+        {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(name);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f ms", ms);
+        }
+        ImGui::EndTable();
+    }
+
+    // over the profiler history: a busy GPU with a stalled CPU is GPU bound, an idle GPU waits on the CPU
+    double cpu     = 0;
+    double gpu     = 0;
+    double stalled = 0;
+    for (const auto *frame : app.profiler.History())
+    {
+        if (app.profiler.HasGpuTimestamps() && !frame->gpuResolved) continue;
+        cpu += frame->cpu;
+        gpu += frame->gpu;
+        for (const auto &scope : frame->cpuScopes)
+        {
+            if (scope.name == "Wait for frame" || scope.name == "Acquire image" || scope.name == "Wait for image")
+                stalled += scope.duration;
+        }
+    }
+    if (cpu > 0)
+    {
+        ImGui::Text("CPU stalled: %.1f%%", 100.0 * stalled / cpu);
+        if (app.profiler.HasGpuTimestamps()) ImGui::Text("GPU busy: %.1f%%", 100.0 * gpu / cpu);
+    }
+    ImGui::End();
+}
+
 void UI::PushFont(uint size) { ImGui::PushFont(ImGui::GetIO().Fonts->Fonts[fonts[size]]); }
 
 void UI::PopFont() { ImGui::PopFont(); }
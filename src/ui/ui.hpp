@@ -74,6 +74,10 @@ public:
     void CmdDraw(VkCommandBuffer cmd);
     void Grid(const Camera &camera);
     void Demo();
+    // frame time graphs and per scope percentiles over the profiler history
+    void ProfilerPanel(const gl::Profiler &profiler);
+    // waits of the last frame, CPU/GPU overlap and the present mode switch
+    void FramePacingPanel(gl::App &app);
     void PushFont(uint size);
     void PopFont();
     std::string ContextMenu(const std::vector<std::string> &items);